@@ -0,0 +1,167 @@
+#include "AdaptiveGridIntegrate.hpp"
+#include "BatchIntegrand.hpp"
+#include "ThreadPool.hpp"
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+    //the largest dimension we'll split cells in; each split makes 2^dim children.
+    constexpr int kAdaptiveGridMaxDim = 20;
+
+    //what we've found so far. cells are counted by depth, as integers, so that adding up the
+    // results of different threads gives the same answer in any order.
+    struct Tally_t {
+        vector<unsigned long int> n_inside;         //n_inside[k] is the number of cells of depth k counted as inside
+        unsigned long int n_straddling{0};          //number of cells of depth max_depth which straddle the boundary
+
+        explicit Tally_t(const int max_depth) : n_inside(max_depth+1, 0) {}
+
+        void Add(const Tally_t& other)
+        {
+            for (size_t k=0; k<n_inside.size(); k++) n_inside[k] += other.n_inside[k];
+            n_straddling += other.n_straddling;
+        }
+    };
+
+    //a stack of cells still waiting to be looked at. cell number c has bounds [c*dim, (c+1)*dim) and depth depth[c].
+    struct CellStack_t {
+        vector<IntegrationBound_t> bounds;
+        vector<int> depth;
+    };
+
+    //classifies one cell. if it is inside, it is counted; if it straddles the boundary, it is either split
+    // (and its children are pushed onto 'stack'), or, if it is already max_depth deep, counted according
+    // to the fcn at its center.
+    void process_cell(
+        const IntegrationBound_t* cell,
+        const int depth,
+        const int dim,
+        const int max_depth,
+        const function<bool(const double*)>& fcn,
+        const CellClassifier_t& classifier,
+        Tally_t& tally,
+        CellStack_t& stack,
+        vector<double>& center
+    )
+    {
+        const CellClass_t cell_class = classifier ? classifier(cell) : kCellStraddles;
+
+        if (cell_class == kCellInside)  { tally.n_inside[depth]++; return; }
+        if (cell_class == kCellOutside) { return; }
+
+        if (depth == max_depth) {
+            for (int i=0; i<dim; i++) center[i] = 0.5*(cell[i].xmin + cell[i].xmax);
+            if (fcn(center.data())) tally.n_inside[depth]++;
+            tally.n_straddling++;
+            return;
+        }
+
+        //split the cell in half along every axis. bit i of 'child' says which half along axis i.
+        const unsigned long int n_children = 1ul << dim;
+        for (unsigned long int child=0; child<n_children; child++) {
+            for (int i=0; i<dim; i++) {
+                const double mid = 0.5*(cell[i].xmin + cell[i].xmax);
+                stack.bounds.push_back( ((child >> i) & 1) ? IntegrationBound_t{mid, cell[i].xmax} : IntegrationBound_t{cell[i].xmin, mid} );
+            }
+            stack.depth.push_back(depth+1);
+        }
+    }
+}
+
+ValueWithError_t<double> AdaptiveGridIntegrate(
+    const int max_depth,                            //max. number of times a cell is split
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.
+    std::function<bool(const double*)> fcn,         //fcn to integrate. returns TRUE if inside region, FALSE if not.
+    CellClassifier_t classifier,                    //conservative cell classifier (may be empty)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    //dimension of the space we're integrating in
+    const int dim = (int)bounds.size();
+
+    if (dim < 1 || dim > kAdaptiveGridMaxDim) {
+        throw invalid_argument("in <AdaptiveGridIntegrate>: dimension must be between 1 and "+to_string(kAdaptiveGridMaxDim)+", not "+to_string(dim)+".");
+    }
+    if (max_depth < 0) {
+        throw invalid_argument("in <AdaptiveGridIntegrate>: max_depth must not be negative.");
+    }
+
+    auto& pool = ThreadPool::Global();
+
+    vector<double> center(dim);
+
+    //first, go through the top few levels of cells here, breadth-first, until there are enough cells
+    // left over to keep all the threads busy.
+    const unsigned long int n_cells_wanted = 8 * (unsigned long int)pool.NumThreads();
+
+    Tally_t tally(max_depth);
+
+    CellStack_t frontier{ bounds, {0} };
+    int frontier_depth = 0;
+
+    while (frontier_depth < max_depth && !frontier.depth.empty() && frontier.depth.size() < n_cells_wanted) {
+
+        CellStack_t next;
+        for (size_t c=0; c<frontier.depth.size(); c++) {
+            process_cell(frontier.bounds.data() + c*dim, frontier_depth, dim, max_depth, fcn, classifier, tally, next, center);
+        }
+        frontier = move(next);
+        frontier_depth++;
+    }
+
+    //then, each of those cells (and everything inside it) is one chunk of work, done depth-first.
+    const unsigned long int n_chunks = frontier.depth.size();
+
+    vector<Tally_t> chunk_tallies(n_chunks, Tally_t(max_depth));
+
+    //(a rough guess of the cost of one chunk; most of it is in the cells which straddle the boundary.)
+    const double work_per_chunk = min<double>( (double)kChunkSize, pow(2., dim*(max_depth - frontier_depth)) ) * dim;
+
+    pool.ParallelFor(n_chunks, [&](unsigned long int i_chunk, unsigned int)
+    {
+        auto chunk_fcn        = fcn;
+        auto chunk_classifier = classifier;
+
+        Tally_t& chunk_tally = chunk_tallies[i_chunk];
+
+        vector<double> chunk_center(dim);
+        vector<IntegrationBound_t> cell(frontier.bounds.begin() + i_chunk*dim, frontier.bounds.begin() + (i_chunk+1)*dim);
+
+        CellStack_t stack;
+        process_cell(cell.data(), frontier_depth, dim, max_depth, chunk_fcn, chunk_classifier, chunk_tally, stack, chunk_center);
+
+        while (!stack.depth.empty()) {
+
+            const int depth = stack.depth.back();
+            copy(stack.bounds.end() - dim, stack.bounds.end(), cell.begin());
+
+            stack.depth.pop_back();
+            stack.bounds.resize(stack.bounds.size() - dim);
+
+            process_cell(cell.data(), depth, dim, max_depth, chunk_fcn, chunk_classifier, chunk_tally, stack, chunk_center);
+        }
+
+    }, policy, work_per_chunk);
+
+    for (const auto& chunk_tally : chunk_tallies) tally.Add(chunk_tally);
+
+    //compute the volume of our 'box' we're integrating in. a cell of depth k has 2^-(dim*k) of it.
+    long double total_vol{1.};
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    long double inside_vol{0.};
+    for (int k=0; k<=max_depth; k++) inside_vol += ldexpl((long double)tally.n_inside[k], -dim*k);
+
+    //every smallest cell which straddles the boundary was counted as all-in or all-out, so each is off by
+    // up to its own volume. the error is that hard bound: n_straddling whole cells. (taking the cells' errors to
+    // be independent, which gives sqrt(n_straddling) half-cells, was often 10x too small from 4d up; they
+    // don't cancel out nearly as well as that.)
+    const long double straddling_err = (long double)tally.n_straddling * ldexpl(1.L, -dim*max_depth);
+
+    return ValueWithError_t<double>{ (double)(total_vol * inside_vol), (double)(total_vol * straddling_err) };
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef AdaptiveGridIntegrate_H
+#define AdaptiveGridIntegrate_H
+
+#include <functional>
+#include <vector>
+#include "ValueWithError.hpp"
+#include "IntegrationBound.hpp"
+#include "ExecutionPolicy.hpp"
+
+// An adaptive grid integrator for indicator functions (fcns which are either 'inside' or 'outside').
+//
+// The box given by the bounds is split in half along every axis (into 2^dim cells), and so on,
+// recursively. A cell which the classifier says is entirely inside the region counts for its whole
+// volume, and one which is entirely outside counts for nothing; only the cells which straddle the
+// boundary are split again. Once a straddling cell is 'max_depth' splits deep, the fcn is evaluated
+// at its center, and the cell counts as inside or outside depending on that. So the work scales with
+// the surface of the region, rather than with its volume.
+//
+// The error it gives is a hard bound, rather than a standard deviation: the total volume of the smallest
+// cells which straddle the boundary (each of which may be counted wrongly, as a whole).
+
+//what a classifier says about a cell
+enum CellClass_t {
+    kCellOutside    = 0,    //every point of the cell is outside the region
+    kCellInside     = 1,    //every point of the cell is inside the region
+    kCellStraddles  = 2     //the cell might contain points both inside and outside the region
+};
+
+//a cell classifier is handed the bounds of a cell (cell[i] is the extent along the i-th axis), and
+// must be conservative: it may only say 'inside' or 'outside' if that is true of every point in
+// the cell. (when it isn't sure, it should say kCellStraddles.)
+using CellClassifier_t = std::function<CellClass_t(const IntegrationBound_t* cell)>;
+
+ValueWithError_t<double> AdaptiveGridIntegrate(
+    const int max_depth,                            //max. number of times a cell is split; the smallest cells have sides (xmax-xmin)/2^max_depth.
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.
+    std::function<bool(const double*)> fcn,         //fcn to integrate; only evaluated at the centers of the smallest straddling cells.
+    CellClassifier_t classifier=nullptr,            //conservative cell classifier. if none is given, every cell straddles, so this is just a
+                                                    // (midpoint) grid with 2^max_depth points per side.
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include "AxisymmetricIntegrate.hpp"
+#include "BallIntegrate.hpp"
+#include "ThreadPool.hpp"
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+    //gauss-legendre nodes and weights on [-1,1] (4 points)
+    constexpr double kGauss4Nodes[4]   = { -0.8611363115940526, -0.3399810435848563, 0.3399810435848563, 0.8611363115940526 };
+    constexpr double kGauss4Weights[4] = {  0.3478548451374538,  0.6521451548625461, 0.6521451548625461, 0.3478548451374538 };
+
+    //fcn evaluations it takes to integrate one cell: the 4x4 gauss-legendre points, and the 4 corners
+    constexpr unsigned long int kEvalsPerCell = 4*4 + 4;
+
+    //the (x0, u) box is first split into this many cells along each side
+    constexpr int kInitialCellsPerSide = 8;
+
+    //at most this many of the worst cells are split at once (so that their children can be done in parallel)
+    constexpr unsigned long int kMaxSplitsPerRound = 256;
+
+    struct Cell_t {
+        double x0_lo, x0_hi, u_lo, u_hi;
+        double val{0.}, err{0.};
+        unsigned long int id{0};                    //order the cell was made in (breaks ties between equal errors)
+    };
+
+    //orders cells so that the one with the largest error is at the top of the heap
+    bool less_urgent(const Cell_t& a, const Cell_t& b)
+    {
+        if (a.err != b.err) return a.err < b.err;
+        return a.id > b.id;
+    }
+
+    void integrate_cell(Cell_t& cell, const AxisymmetricFcn_t& fcn, const double inv_dim_perp)
+    {
+        const double x0_mid = 0.5*(cell.x0_lo + cell.x0_hi), x0_half = 0.5*(cell.x0_hi - cell.x0_lo);
+        const double u_mid  = 0.5*(cell.u_lo  + cell.u_hi),  u_half  = 0.5*(cell.u_hi  - cell.u_lo);
+
+        auto inside = [&](const double s, const double t)
+        {
+            const double u = max<double>( 0., u_mid + u_half*t );
+            return fcn( x0_mid + x0_half*s, pow(u, inv_dim_perp) ) ? 1. : 0.;
+        };
+
+        double q4=0.;
+        for (int a=0; a<4; a++) {
+            for (int b=0; b<4; b++) q4 += kGauss4Weights[a]*kGauss4Weights[b]*inside(kGauss4Nodes[a], kGauss4Nodes[b]);
+        }
+
+        //the corners tell us if the boundary crosses the cell: unless it goes in and out through the same edge,
+        // it separates two of them. (the gauss points alone can all agree on a cell which is partly inside.)
+        double qc=0.;
+        for (const double s : {-1., 1.}) {
+            for (const double t : {-1., 1.}) qc += 0.25*inside(s, t);
+        }
+
+        const double area = 4.*x0_half*u_half;
+        cell.val = 0.25*area*q4;
+        cell.err = area*max<double>( fabs(0.25*q4 - qc), min<double>(0.25*q4, 1. - 0.25*q4) );
+    }
+}
+
+ValueWithError_t<double> AxisymmetricIntegrate(
+    const unsigned long int n_evals,                //max. number of fcn evaluations to use
+    const int dim,                                  //dimension of the space the region lives in (at least 2)
+    const IntegrationBound_t x0_bound,              //range of x0 the region lies in
+    const double r_max,                             //largest distance from the X[0]-axis of any point in the region
+    AxisymmetricFcn_t fcn,                          //fcn to integrate. returns TRUE if inside region, FALSE if not.
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    if (dim < 2) {
+        throw invalid_argument("in <AxisymmetricIntegrate>: dimension must be at least 2.");
+    }
+    if (!(r_max > 0.) || !(x0_bound.xmax > x0_bound.xmin)) {
+        throw invalid_argument("in <AxisymmetricIntegrate>: r_max must be positive, and the x0 range must not be empty.");
+    }
+
+    const int    dim_perp     = dim - 1;
+    const double inv_dim_perp = 1./((double)dim_perp);
+    const double u_max        = pow(r_max, (double)dim_perp);
+
+    auto& pool = ThreadPool::Global();
+
+    //the cells which haven't been split (yet), as a heap with the largest error on top
+    vector<Cell_t> cells;
+    unsigned long int n_made=0;
+
+    const double dx0 = (x0_bound.xmax - x0_bound.xmin)/kInitialCellsPerSide;
+    const double du  = u_max/kInitialCellsPerSide;
+    for (int a=0; a<kInitialCellsPerSide; a++) {
+        for (int b=0; b<kInitialCellsPerSide; b++) {
+            Cell_t cell{ x0_bound.xmin + a*dx0, x0_bound.xmin + (a+1)*dx0, b*du, (b+1)*du };
+            cell.id = n_made++;
+            cells.push_back(cell);
+        }
+    }
+
+    pool.ParallelFor(cells.size(), [&](unsigned long int i_cell, unsigned int)
+    {
+        auto chunk_fcn = fcn;
+        integrate_cell(cells[i_cell], chunk_fcn, inv_dim_perp);
+
+    }, policy, (double)kEvalsPerCell);
+
+    unsigned long int n_used = cells.size()*kEvalsPerCell;
+
+    make_heap(cells.begin(), cells.end(), less_urgent);
+
+    //now, keep splitting the worst cells into 4, while we can afford to.
+    vector<Cell_t> parents, children;
+    while (n_used + 4*kEvalsPerCell <= n_evals && cells.front().err > 0.) {
+
+        const unsigned long int n_split = min<unsigned long int>({
+            kMaxSplitsPerRound,
+            (n_evals - n_used)/(4*kEvalsPerCell),
+            max<unsigned long int>(1, cells.size()/8)
+        });
+
+        parents.clear();
+        for (unsigned long int k=0; k<n_split && cells.front().err > 0.; k++) {
+            pop_heap(cells.begin(), cells.end(), less_urgent);
+            parents.push_back(cells.back());
+            cells.pop_back();
+        }
+
+        children.resize(4*parents.size());
+        for (size_t p=0; p<parents.size(); p++) {
+
+            const Cell_t& par = parents[p];
+            const double x0_mid = 0.5*(par.x0_lo + par.x0_hi);
+            const double u_mid  = 0.5*(par.u_lo  + par.u_hi);
+
+            children[4*p + 0] = Cell_t{ par.x0_lo, x0_mid,    par.u_lo, u_mid    };
+            children[4*p + 1] = Cell_t{ x0_mid,    par.x0_hi, par.u_lo, u_mid    };
+            children[4*p + 2] = Cell_t{ par.x0_lo, x0_mid,    u_mid,    par.u_hi };
+            children[4*p + 3] = Cell_t{ x0_mid,    par.x0_hi, u_mid,    par.u_hi };
+            for (int c=0; c<4; c++) children[4*p + c].id = n_made++;
+        }
+
+        pool.ParallelFor(parents.size(), [&](unsigned long int p, unsigned int)
+        {
+            auto chunk_fcn = fcn;
+            for (int c=0; c<4; c++) integrate_cell(children[4*p + c], chunk_fcn, inv_dim_perp);
+
+        }, policy, (double)(4*kEvalsPerCell));
+
+        n_used += children.size()*kEvalsPerCell;
+
+        for (const auto& child : children) {
+            cells.push_back(child);
+            push_heap(cells.begin(), cells.end(), less_urgent);
+        }
+    }
+
+    //add up the cells, in the order they were made (so the sum is always done the same way)
+    sort(cells.begin(), cells.end(), [](const Cell_t& a, const Cell_t& b){ return a.id < b.id; });
+
+    double val=0., err=0.;
+    for (const auto& cell : cells) { val += cell.val; err += cell.err; }
+
+    //the (dim-1)-ball volume turns area in (x0, u) into volume: a shell of radius r, and thickness dr, has a
+    // cross-section of (dim-1) V_{dim-1}(1) r^(dim-2) dr = V_{dim-1}(1) du.
+    const double jacobian = ball_volume(dim_perp, 1.);
+
+    return ValueWithError_t<double>{ jacobian*val, jacobian*err };
+}
\ No newline at end of file
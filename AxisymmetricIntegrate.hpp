@@ -0,0 +1,34 @@
+#ifndef AxisymmetricIntegrate_H
+#define AxisymmetricIntegrate_H
+
+#include <functional>
+#include "ValueWithError.hpp"
+#include "IntegrationBound.hpp"
+#include "ExecutionPolicy.hpp"
+
+// An integrator for regions which are symmetric under rotations around the X[0]-axis (a ball, or the
+// overlap of two balls centered on that axis, for example).
+//
+// Such a region is described by an inside/outside fcn of just two numbers: x0, and the distance r from the
+// X[0]-axis. Its volume in 'dim' dimensions is the 2-d integral of the fcn, weighted by the surface of the
+// (dim-2)-sphere of radius r. Writing u = r^(dim-1) turns that weight into a constant, V_{dim-1}(1), the volume
+// of the unit (dim-1)-ball, so we integrate the fcn itself over (x0, u), with an adaptive 2-d quadrature:
+// each cell is integrated with a 4x4 gauss-legendre rule, checked against its corners, and the cell which
+// looks the least certain is split into 4, until the budget of fcn evaluations is spent. The cost doesn't
+// depend on 'dim' at all. (the error given is a rough upper bound: it is the part of the area of the cells the
+// boundary passes through which might be counted wrong.)
+
+// an axisymmetric inside/outside fcn: returns TRUE if points at x0, a distance r from the X[0]-axis, are
+// inside the region.
+using AxisymmetricFcn_t = std::function<bool(const double x0, const double r)>;
+
+ValueWithError_t<double> AxisymmetricIntegrate(
+    const unsigned long int n_evals,                //max. number of fcn evaluations to use
+    const int dim,                                  //dimension of the space the region lives in (at least 2)
+    const IntegrationBound_t x0_bound,              //range of x0 the region lies in
+    const double r_max,                             //largest distance from the X[0]-axis of any point in the region
+    AxisymmetricFcn_t fcn,                          //fcn to integrate. returns TRUE if inside region, FALSE if not.
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "BallIntegrate.hpp"
+#include "ThreadPool.hpp"
+#include "PhiloxRandom.hpp"
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+double ball_volume(const int dim, const double R)
+{
+    //(done with logs, so that large dimensions don't overflow the gamma fcn)
+    const double d = (double)dim;
+    return exp( 0.5*d*log(M_PI) - lgamma(0.5*d + 1.) + d*log(R) );
+}
+
+ValueWithError_t<double> BallIntegrate(
+    const unsigned long int n_pts,                  //number of points to use in the integration
+    const std::vector<double> center,               //center of the ball. number of dimensions is given by its size.
+    const double radius,                            //radius of the ball
+    std::function<bool(const double*)> fcn,         //fcn to integrate. returns TRUE if inside region, FALSE if not.
+    const std::optional<uint64_t> seed,             //seed of the random stream (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    return BallIntegrate(n_pts, center, radius, make_batch_integrand((int)center.size(), fcn), seed, policy);
+}
+
+ValueWithError_t<double> BallIntegrate(
+    const unsigned long int n_pts,                  //number of points to use in the integration
+    const std::vector<double> center,               //center of the ball. number of dimensions is given by its size.
+    const double radius,                            //radius of the ball
+    BatchIntegrand_t fcn,                           //fcn to integrate, a whole (SoA) block of points at a time. returns the number inside the region.
+    const std::optional<uint64_t> seed,             //seed of the random stream (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    //dimension of the space we're integrating in
+    const int dim = (int)center.size();
+
+    if (dim < 1) {
+        throw invalid_argument("in <BallIntegrate>: the center of the ball must have at least one coordinate.");
+    }
+    if (!(radius > 0.)) {
+        throw invalid_argument("in <BallIntegrate>: the radius of the ball must be positive.");
+    }
+    if (n_pts < 1) {
+        throw invalid_argument("in <BallIntegrate>: need at least 1 point.");
+    }
+
+    const uint64_t stream_seed = Philox::ResolveSeed(seed);
+
+    //the uniform numbers each point is made from: the gaussians of the direction are made in pairs (box-muller),
+    // so we take an even number of them, followed by one for the radius.
+    const int n_gauss   = 2*((dim + 1)/2);
+    const int n_uniform = n_gauss + 1;
+
+    const vector<IntegrationBound_t> unit_bounds(n_uniform, IntegrationBound_t{0., 1.});
+
+    const double inv_dim = 1./((double)dim);
+
+    const unsigned long int n_chunks = (n_pts + kChunkSize - 1) / kChunkSize;
+
+    vector<unsigned long int> chunk_counts(n_chunks, 0);
+
+    ThreadPool::Global().ParallelFor(n_chunks, [&](unsigned long int i_chunk, unsigned int)
+    {
+        const unsigned long int n_chunk_pts = min<unsigned long int>( kChunkSize, n_pts - i_chunk*kChunkSize );
+
+        BatchIntegrand_t chunk_fcn = fcn;
+
+        //the uniform numbers (SoA), which are turned (in place) into gaussians; the first 'dim' rows are
+        // then scaled onto the ball, and are the block of points handed to the fcn.
+        vector<double> block(n_uniform * kBatchSize);
+        vector<double*> U(n_uniform);
+        for (int i=0; i<n_uniform; i++) U[i] = block.data() + i*kBatchSize;
+
+        vector<double> r2(kBatchSize), scale(kBatchSize);
+
+        unsigned long int count=0, n_done=0;
+        while (n_done < n_chunk_pts) {
+
+            const unsigned long int n_block = min<unsigned long int>( kBatchSize, n_chunk_pts - n_done );
+
+            philox_fill_block(stream_seed, i_chunk*kChunkSize + n_done, n_block, unit_bounds, U.data());
+
+            //box-muller: each pair of uniforms becomes a pair of independent gaussians. (1-u is in (0,1], so the log is finite.)
+            fill_n(r2.begin(), n_block, 0.);
+            for (int i=0; i<n_gauss; i+=2) {
+
+                double* u0 = U[i];
+                double* u1 = U[i+1];
+
+                for (unsigned long int j=0; j<n_block; j++) {
+
+                    const double rho = sqrt( -2.*log(1. - u0[j]) );
+                    const double phi = 2.*M_PI*u1[j];
+
+                    u0[j] = rho*cos(phi);
+                    u1[j] = rho*sin(phi);
+
+                    r2[j] += u0[j]*u0[j];
+                    if (i+1 < dim) r2[j] += u1[j]*u1[j];
+                }
+            }
+
+            //the gaussian direction, normalized, times a radius which puts the same number of points in
+            // every shell of equal volume.
+            const double* u_radius = U[n_gauss];
+            for (unsigned long int j=0; j<n_block; j++) {
+                scale[j] = (r2[j] > 0.) ? radius * pow(u_radius[j], inv_dim) / sqrt(r2[j]) : 0.;
+            }
+            for (int i=0; i<dim; i++) {
+                double* x = U[i];
+                for (unsigned long int j=0; j<n_block; j++) x[j] = center[i] + scale[j]*x[j];
+            }
+
+            count  += chunk_fcn(n_block, U.data());
+            n_done += n_block;
+        }
+
+        chunk_counts[i_chunk] = count;
+
+    }, policy, (double)(kChunkSize * n_uniform));
+
+    unsigned long int count = 0;
+    for (auto chunk_count : chunk_counts) count += chunk_count;
+
+    const double vol = ball_volume(dim, radius);
+    const double p   = ((double)count) / ((double)n_pts);
+
+    //(the fraction inside can be close to 1 here, so we use the binomial error, rather than sqrt(count).)
+    return ValueWithError_t<double>{ vol * p, vol * sqrt( p*(1. - p) / ((double)n_pts) ) };
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef BallIntegrate_H
+#define BallIntegrate_H
+
+#include <optional>
+#include <functional>
+#include <vector>
+#include <cstdint>
+#include "ValueWithError.hpp"
+#include "BatchIntegrand.hpp"
+#include "ExecutionPolicy.hpp"
+
+// A monte-carlo integrator which draws its points uniformly from inside a ball, rather than a box.
+//
+// If the region we're after is known to lie inside some ball, this wastes far fewer points than
+// sampling the box around it: in 10 dimensions a ball only fills ~0.25% of the box around it, and in
+// 15 dimensions ~0.001%. Each point is a gaussian direction (which is uniform on the sphere), times a
+// radius R*u^(1/dim), so that the points are uniform in volume. The result is the analytic volume of
+// the ball, times the fraction of the points which are inside the region.
+//
+// the random numbers come from the same counter-based stream as MontecarloIntegrate() (point i uses
+// point i of the stream, in dim+1 or dim+2 coordinates), so the same seed always gives the same result,
+// no matter how many threads are used.
+
+// the volume of a ball of radius R in 'dim' dimensions (pi^(dim/2) / Gamma(dim/2 + 1) * R^dim)
+double ball_volume(const int dim, const double R);
+
+ValueWithError_t<double> BallIntegrate(
+    const unsigned long int n_pts,                  //number of points to use in the integration
+    const std::vector<double> center,               //center of the ball. number of dimensions is given by its size.
+    const double radius,                            //radius of the ball
+    std::function<bool(const double*)> fcn,         //fcn to integrate. must accept (CONST) ptr to doubles.
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the random stream. the same seed always gives the same result.
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+);
+
+// same as above, but the fcn is evaluated on a whole block of points at a time (see BatchIntegrand.hpp).
+ValueWithError_t<double> BallIntegrate(
+    const unsigned long int n_pts,                  //number of points to use in the integration
+    const std::vector<double> center,               //center of the ball. number of dimensions is given by its size.
+    const double radius,                            //radius of the ball
+    BatchIntegrand_t fcn,                           //fcn to integrate. returns the number of points in the block inside the region.
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the random stream (see above)
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,215 @@
+#ifndef BatchIntegrand_H
+#define BatchIntegrand_H
+
+#include <functional>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "ValueWithError.hpp"
+
+// A 'batch' integrand evaluates a whole block of points with a single call, instead of
+// being called once per point. The points are handed over in structure-of-arrays layout:
+// X[i] is a contiguous array which holds the i-th coordinate of every point in the block,
+// so the j-th point of the block is {X[0][j], X[1][j], ..., X[dim-1][j]}.
+//
+// it must return the number of points in the block which are inside the region.
+using BatchIntegrand_t = std::function<unsigned long int(
+    const unsigned long int n_pts,                  //number of points in this block
+    const double* const* X                          //X[i][j] is the i-th coordinate of the j-th point
+)>;
+
+// A real-valued batch integrand: rather than counting the points inside a region, it writes the value
+// of the fcn at each point of the block, f[j] for the j-th point. (the integral of an inside/outside fcn
+// is the same as that of its 0/1 'indicator', but a smooth fcn is much kinder to the error.)
+using BatchValueIntegrand_t = std::function<void(
+    const unsigned long int n_pts,                  //number of points in this block
+    const double* const* X,                         //X[i][j] is the i-th coordinate of the j-th point
+    double* f                                       //(output) f[j] is the value of the fcn at the j-th point
+)>;
+
+// A 'multi-region' batch integrand: it tests each point of the block against several regions at once
+// (which all fit in the same bounding box), and adds the number of points inside region k to counts[k].
+// so the points are only made once, however many regions there are.
+using BatchMultiIntegrand_t = std::function<void(
+    const unsigned long int n_pts,                  //number of points in this block
+    const double* const* X,                         //X[i][j] is the i-th coordinate of the j-th point
+    unsigned long int* counts                       //(output) counts[k] is increased by the number inside region k
+)>;
+
+// A vector-valued batch integrand: a fcn with 'n_components' outputs (the fcn itself, and its products
+// with the coordinates, for example), which are all integrated over the same points at once. F is laid
+// out like X: F[k] is a contiguous array of the k-th output, for every point of the block.
+using BatchVectorIntegrand_t = std::function<void(
+    const unsigned long int n_pts,                  //number of points in this block
+    const double* const* X,                         //X[i][j] is the i-th coordinate of the j-th point
+    double* const* F                                //(output) F[k][j] is the k-th output of the fcn at the j-th point
+)>;
+
+// the (maximum) number of points the integrators hand to a batch integrand at once
+constexpr unsigned long int kBatchSize = 256;
+
+// the number of points in one unit of work ('chunk') which the integrators hand to the thread pool
+constexpr unsigned long int kChunkSize = 64 * kBatchSize;
+
+// adds x to the sum (sum + c), keeping what the addition loses to rounding in 'c' (Neumaier's version of
+// Kahan summation, which also copes with x being larger than the sum). the sum is (sum + c).
+inline void neumaier_add(double& sum, double& c, const double x)
+{
+    const double t = sum + x;
+    c  += (std::fabs(sum) >= std::fabs(x)) ? (sum - t) + x : (x - t) + sum;
+    sum = t;
+}
+
+// the running mean and variance of a real-valued integrand over a set of points. each chunk of work keeps
+// its own, and they are merged in a fixed order, so the result doesn't depend on the threads. this keeps
+// the mean, and the sum of squared differences from it (Welford / Chan et al.), rather than sum(f) and
+// sum(f^2), which lose all their precision when the spread is small next to the mean. every sum is also
+// compensated (see neumaier_add), so that merging thousands of chunks doesn't pile up rounding errors.
+struct RunningStats_t {
+    unsigned long int n{0};                         //number of points
+    double mean{0.}, mean_c{0.};                    //mean of f (it is mean + mean_c; see neumaier_add)
+    double m2{0.}, m2_c{0.};                        //sum of (f - mean)^2 (likewise, m2 + m2_c)
+
+    double Mean() const { return mean + mean_c; }
+    double M2()   const { return m2 + m2_c; }
+
+    //merges in the stats of another set of points
+    void Add(const RunningStats_t& other)
+    {
+        if (other.n == 0) return;
+
+        const double n_a = (double)n, n_b = (double)other.n, n_ab = n_a + n_b;
+        const double delta = other.Mean() - Mean();
+
+        neumaier_add(mean, mean_c, delta * (n_b / n_ab));
+        neumaier_add(m2,   m2_c,   other.M2());
+        neumaier_add(m2,   m2_c,   delta*delta * (n_a * n_b / n_ab));
+        n += other.n;
+    }
+
+    //adds a block of values (the block's own mean and spread are found first, then merged in)
+    void Add(const unsigned long int n_pts, const double* f)
+    {
+        if (n_pts == 0) return;
+
+        RunningStats_t block;
+        block.n = n_pts;
+        double sum=0., sum_c=0.;
+        for (unsigned long int j=0; j<n_pts; j++) neumaier_add(sum, sum_c, f[j]);
+        block.mean = (sum + sum_c) / (double)n_pts;
+        for (unsigned long int j=0; j<n_pts; j++) neumaier_add(block.m2, block.m2_c, (f[j] - block.mean)*(f[j] - block.mean));
+
+        Add(block);
+    }
+
+    //the integral over a region of volume 'vol', with the usual monte-carlo error
+    ValueWithError_t<double> Estimate(const double vol) const
+    {
+        return ValueWithError_t<double>{ vol * Mean(), vol * std::sqrt( M2() / ((double)n * (double)n) ) };
+    }
+};
+
+// for integrators which give the running result at several 'checkpoints' (numbers of points) along one
+// stream of points: the stream [0, checkpoints.back()) is cut at every chunk boundary, and at every
+// checkpoint, into 'segments' which are each tallied on their own. segment i is [ends[i-1], ends[i]), so
+// adding the segments up in order gives the tally at each checkpoint in turn.
+inline std::vector<unsigned long int> checkpoint_segment_ends(const std::vector<unsigned long int>& checkpoints)
+{
+    if (checkpoints.empty() || checkpoints.front() == 0) {
+        throw std::invalid_argument("in <checkpoint_segment_ends>: need at least one checkpoint, and they must all be positive.");
+    }
+    if (!std::is_sorted(checkpoints.begin(), checkpoints.end()) ||
+        std::adjacent_find(checkpoints.begin(), checkpoints.end()) != checkpoints.end()) {
+        throw std::invalid_argument("in <checkpoint_segment_ends>: checkpoints must be in (strictly) increasing order.");
+    }
+
+    std::vector<unsigned long int> ends;
+    unsigned long int next_chunk = kChunkSize;
+    for (const unsigned long int checkpoint : checkpoints) {
+        for (; next_chunk < checkpoint; next_chunk += kChunkSize) ends.push_back(next_chunk);
+        ends.push_back(checkpoint);
+        if (next_chunk == checkpoint) next_chunk += kChunkSize;
+    }
+    return ends;
+}
+
+// wraps an ordinary, one-point-at-a-time integrand so it can be used where a batch integrand
+// is expected. each point is gathered into a (dim)-long array before 'fcn' is called on it.
+inline BatchIntegrand_t make_batch_integrand(const int dim, std::function<bool(const double*)> fcn)
+{
+    return [dim, fcn](const unsigned long int n_pts, const double* const* X)
+    {
+        std::vector<double> point(dim);
+
+        unsigned long int count=0;
+        for (unsigned long int j=0; j<n_pts; j++) {
+
+            for (int i=0; i<dim; i++) point[i] = X[i][j];
+
+            if (fcn(point.data())) count++;
+        }
+        return count;
+    };
+}
+
+// the same, for a real-valued fcn (see BatchValueIntegrand_t)
+inline BatchValueIntegrand_t make_batch_value_integrand(const int dim, std::function<double(const double*)> fcn)
+{
+    return [dim, fcn](const unsigned long int n_pts, const double* const* X, double* f)
+    {
+        std::vector<double> point(dim);
+
+        for (unsigned long int j=0; j<n_pts; j++) {
+            for (int i=0; i<dim; i++) point[i] = X[i][j];
+            f[j] = fcn(point.data());
+        }
+    };
+}
+
+// the same, for a vector-valued fcn, which writes its n_components outputs at a point to out[0 ... n_components-1]
+inline BatchVectorIntegrand_t make_batch_vector_integrand(
+    const int dim,
+    const unsigned long int n_components,
+    std::function<void(const double*, double*)> fcn
+)
+{
+    return [dim, n_components, fcn](const unsigned long int n_pts, const double* const* X, double* const* F)
+    {
+        std::vector<double> point(dim), out(n_components);
+
+        for (unsigned long int j=0; j<n_pts; j++) {
+            for (int i=0; i<dim; i++) point[i] = X[i][j];
+            fcn(point.data(), out.data());
+            for (unsigned long int k=0; k<n_components; k++) F[k][j] = out[k];
+        }
+    };
+}
+
+// the largest dimension make_point_integrand() handles without touching the heap
+constexpr int kPointIntegrandStackDim = 64;
+
+// the other way around: wraps a batch integrand so it can be called on one point at a time, for
+// integrators which need to know which points are inside (rather than just how many). the point is
+// handed over as a block of one point, whose coordinate pointers are kept on the stack, so a call
+// doesn't allocate (unless dim > kPointIntegrandStackDim). a fcn called on every point is still much
+// slower than a whole block at a time, so the integrators which can take a block should be given one.
+inline std::function<bool(const double*)> make_point_integrand(const int dim, BatchIntegrand_t fcn)
+{
+    return [dim, fcn](const double* point)
+    {
+        std::array<const double*, kPointIntegrandStackDim> X_stack;
+        std::vector<const double*> X_heap;
+
+        const double** X = X_stack.data();
+        if (dim > kPointIntegrandStackDim) {
+            X_heap.resize(dim);
+            X = X_heap.data();
+        }
+        for (int i=0; i<dim; i++) X[i] = point + i;
+        return fcn(1, X) == 1;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,191 @@
+#ifndef ControlVariate_H
+#define ControlVariate_H
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "ValueWithError.hpp"
+#include "IntegrationBound.hpp"
+#include "BatchIntegrand.hpp"
+
+// Control variates: alongside the fcn, one or more 'reference' fcns, whose exact integrals we know, are
+// evaluated at the same points (the indicator of a ball or a box inside the bounds, for example). whatever
+// error the points make on the references, they (mostly) make on the fcn too, so it can be taken back out.
+// with f the fcn, and g_m the references (whose means over the bounds should be mu_m):
+//
+//  estimate = mean(f) - sum_m beta_m * ( mean(g_m) - mu_m )
+//
+// beta is fit from the same points (it's the least-squares fit of f on the g's), and the error is that of
+// what's left of f after the fit: it shrinks by sqrt(1 - R^2), where R^2 is the fraction of the variance of
+// f which the references explain (though 1 - R^2 is never taken to be less than about 1 over the number of
+// points f is nonzero at; see Estimate()). (fitting beta from the same points biases the estimate, by O(1/n).)
+
+// a reference fcn, and its exact integral over the bounds of the integration
+struct ControlVariate_t {
+    BatchValueIntegrand_t fcn;                      //writes the value of the reference at each point of the block
+    double integral;                                //its exact integral over the bounds
+};
+
+// the indicator of a ball, as a reference. the ball must lie entirely inside the bounds (otherwise, the
+// integral has to be corrected for the part which sticks out).
+inline ControlVariate_t ball_control_variate(const std::vector<double>& center, const double radius)
+{
+    const int dim = (int)center.size();
+    const double R_R = radius*radius;
+
+    auto inside_ball = [center, dim, R_R](const unsigned long int n_pts, const double* const* X, double* f)
+    {
+        std::fill_n(f, n_pts, 0.);
+        for (int i=0; i<dim; i++) {
+            for (unsigned long int j=0; j<n_pts; j++) f[j] += (X[i][j] - center[i])*(X[i][j] - center[i]);
+        }
+        for (unsigned long int j=0; j<n_pts; j++) f[j] = (f[j] > R_R) ? 0. : 1.;
+    };
+
+    //V = pi^(dim/2) / gamma(dim/2 + 1) * R^dim (in logs, so it doesn't overflow in high dimensions)
+    const double volume = std::exp( 0.5*dim*std::log(M_PI) - std::lgamma(0.5*dim + 1.) + dim*std::log(radius) );
+
+    return ControlVariate_t{ inside_ball, volume };
+}
+
+// the indicator of a box, as a reference. (it must lie inside the bounds, too.)
+inline ControlVariate_t box_control_variate(const std::vector<IntegrationBound_t>& box)
+{
+    auto inside_box = [box](const unsigned long int n_pts, const double* const* X, double* f)
+    {
+        std::fill_n(f, n_pts, 1.);
+        for (size_t i=0; i<box.size(); i++) {
+            for (unsigned long int j=0; j<n_pts; j++) if (X[i][j] < box[i].xmin || X[i][j] > box[i].xmax) f[j] = 0.;
+        }
+    };
+
+    double volume = 1.;
+    for (const auto& bound : box) volume *= (bound.xmax - bound.xmin);
+
+    return ControlVariate_t{ inside_box, volume };
+}
+
+// the running means, and co-moments, of several fcns (the fcn, and then each reference) over a set of points.
+// like RunningStats_t, each chunk of work keeps its own, and they are merged in a fixed order.
+struct RunningCovariance_t {
+    unsigned long int n{0};                         //number of points
+    std::vector<double> mean;                       //mean[a] is the mean of fcn a
+    std::vector<double> c;                          //c[a*K + b] is the sum of (f_a - mean_a)*(f_b - mean_b), for K fcns
+
+    //merges in the co-moments of another set of points
+    void Add(const RunningCovariance_t& other)
+    {
+        if (other.n == 0) return;
+        if (n == 0) { *this = other; return; }
+
+        const unsigned long int K = mean.size();
+        const double n_a = (double)n, n_b = (double)other.n, n_ab = n_a + n_b;
+
+        std::vector<double> delta(K);
+        for (unsigned long int a=0; a<K; a++) delta[a] = other.mean[a] - mean[a];
+
+        for (unsigned long int a=0; a<K; a++) {
+            for (unsigned long int b=0; b<K; b++) c[a*K + b] += other.c[a*K + b] + delta[a]*delta[b] * (n_a * n_b / n_ab);
+        }
+        for (unsigned long int a=0; a<K; a++) mean[a] += delta[a] * (n_b / n_ab);
+        n += other.n;
+    }
+
+    //adds a block of values of K fcns: F[a][j] is the value of fcn a at point j
+    void Add(const unsigned long int n_pts, const unsigned long int K, const double* const* F)
+    {
+        if (n_pts == 0) return;
+
+        RunningCovariance_t block;
+        block.n = n_pts;
+        block.mean.assign(K, 0.);
+        block.c.assign(K*K, 0.);
+
+        for (unsigned long int a=0; a<K; a++) {
+            for (unsigned long int j=0; j<n_pts; j++) block.mean[a] += F[a][j];
+            block.mean[a] /= (double)n_pts;
+        }
+        for (unsigned long int a=0; a<K; a++) {
+            for (unsigned long int b=a; b<K; b++) {
+                double sum=0.;
+                for (unsigned long int j=0; j<n_pts; j++) sum += (F[a][j] - block.mean[a])*(F[b][j] - block.mean[b]);
+                block.c[a*K + b] = block.c[b*K + a] = sum;
+            }
+        }
+
+        Add(block);
+    }
+
+    //the control-variate estimate of the integral of fcn 0, over a region of volume 'vol', given the exact
+    // means of the others (mu[m] is that of fcn m+1). a reference which is (next to) constant over the
+    // points, or which adds nothing to the ones before it, is left out of the fit.
+    ValueWithError_t<double> Estimate(const double vol, const std::vector<double>& mu) const
+    {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        if (n == 0) return ValueWithError_t<double>{ nan, nan };
+
+        const unsigned long int K = mean.size(), M = K - 1;
+
+        //solve C_gg beta = C_gf, by cholesky (L L^T = C_gg), skipping any reference whose pivot vanishes
+        std::vector<double> L(M*M, 0.);
+        std::vector<bool> used(M, false);
+        unsigned long int n_used=0;
+
+        for (unsigned long int j=0; j<M; j++) {
+
+            const double c_jj = c[(1+j)*K + (1+j)];
+
+            double d = c_jj;
+            for (unsigned long int k=0; k<j; k++) if (used[k]) d -= L[j*M + k]*L[j*M + k];
+            if (!(d > 1e-12 * c_jj)) continue;
+
+            used[j] = true;
+            n_used++;
+            L[j*M + j] = std::sqrt(d);
+
+            for (unsigned long int i=j+1; i<M; i++) {
+                double s = c[(1+i)*K + (1+j)];
+                for (unsigned long int k=0; k<j; k++) if (used[k]) s -= L[i*M + k]*L[j*M + k];
+                L[i*M + j] = s / L[j*M + j];
+            }
+        }
+
+        std::vector<double> beta(M, 0.);
+        for (unsigned long int i=0; i<M; i++) {
+            if (!used[i]) continue;
+            double s = c[(1+i)*K];
+            for (unsigned long int k=0; k<i; k++) if (used[k]) s -= L[i*M + k]*beta[k];
+            beta[i] = s / L[i*M + i];
+        }
+        for (unsigned long int i=M; i-- > 0; ) {
+            if (!used[i]) continue;
+            double s = beta[i];
+            for (unsigned long int k=i+1; k<M; k++) if (used[k]) s -= L[k*M + i]*beta[k];
+            beta[i] = s / L[i*M + i];
+        }
+
+        //the corrected mean, and what's left of the spread of f once the fit is taken out
+        double value = mean[0], c_resid = c[0];
+        for (unsigned long int m=0; m<M; m++) {
+            value   -= beta[m] * (mean[1+m] - mu[m]);
+            c_resid -= beta[m] * c[(1+m)*K];
+        }
+
+        //however well the references seem to do, the fit can't take out more of f's spread than its points can 
+        // show: at least 1/(n_f + 2) of it is left, where n_f = n mean(f)^2 / mean(f^2) is the effective number 
+        // of points f is nonzero at (the number inside, for an indicator). without this, references which match 
+        // f at the few points which hit it give an error of 0. (the same idea as the (k+1)/(n+2) of a binomial 
+        // error; with many points inside, it makes no difference.) 
+        const double mean_f2 = c[0]/(double)n + mean[0]*mean[0];
+        const double n_f = (mean_f2 > 0.) ? (double)n * mean[0]*mean[0] / mean_f2 : 0.;
+        c_resid = std::max<double>( c_resid, c[0] / (n_f + 2.) );
+
+        const double dof = (double)n - 1. - (double)n_used;
+        const double error = (dof > 0.) ? std::sqrt( std::max<double>(0., c_resid) / dof / (double)n ) : nan;
+
+        return ValueWithError_t<double>{ vol * value, vol * error };
+    }
+};
+
+#endif
\ No newline at end of file
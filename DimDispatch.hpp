@@ -0,0 +1,51 @@
+#ifndef DimDispatch_H
+#define DimDispatch_H
+
+#include <type_traits>
+#include <utility>
+
+// Turns a runtime dimension into a compile-time one, so that code which is templated on the
+// dimension (and whose coordinate loops can therefore be fully unrolled) can be picked from
+// the runtime 'bounds.size()'. Each dimension in [kDispatchDimMin, kDispatchDimMax] gets its
+// own entry in a table of function pointers.
+//
+// for example:
+//
+//  bool ok = dispatch_dim(dim, [&](auto dim_c) {
+//      constexpr int Dim = decltype(dim_c)::value;
+//      result = MontecarloIntegrate<Dim>(N, bounds, fcn);
+//  });
+//  if (!ok) result = MontecarloIntegrate(N, bounds, fcn);  //fall back on the runtime-dim version
+//
+
+constexpr int kDispatchDimMin = 2;
+constexpr int kDispatchDimMax = 16;
+
+namespace DimDispatch {
+
+    template<int Dim, typename Fcn> void call_with_dim(Fcn& fcn) { fcn(std::integral_constant<int, Dim>{}); }
+
+    template<typename Fcn, int... Is> bool dispatch(const int dim, Fcn& fcn, std::integer_sequence<int, Is...>)
+    {
+        using Entry_t = void(*)(Fcn&);
+        static constexpr Entry_t table[] = { &call_with_dim<kDispatchDimMin + Is, Fcn>... };
+
+        if (dim < kDispatchDimMin || dim > kDispatchDimMax) return false;
+
+        table[dim - kDispatchDimMin](fcn);
+        return true;
+    }
+}
+
+// calls fcn(std::integral_constant<int, dim>{}), and returns true, if 'dim' is one of the dimensions
+// we have a table entry for. otherwise, does nothing and returns false.
+template<typename Fcn> bool dispatch_dim(const int dim, Fcn&& fcn)
+{
+    return DimDispatch::dispatch(
+        dim,
+        fcn,
+        std::make_integer_sequence<int, kDispatchDimMax - kDispatchDimMin + 1>{}
+    );
+}
+
+#endif
\ No newline at end of file
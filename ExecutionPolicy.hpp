@@ -0,0 +1,38 @@
+#ifndef ExecutionPolicy_H
+#define ExecutionPolicy_H
+
+// How an integrator should run on the thread pool (see ThreadPool.hpp): how many threads to use, and
+// whether (and how) the pool's worker threads should be pinned to cpus.
+//
+// Pinning matters on machines with more than one NUMA node (multi-socket nodes, for example). Every chunk
+// of work allocates its buffers on the thread which runs it, so they're placed ('first touch') on that
+// thread's node; but unless the thread is pinned, the OS is free to move it to another node afterwards,
+// and its memory doesn't follow it.
+//
+// Every integrator takes one as its 'policy' argument (the one commented '//threads' in their headers):
+// how many of the pool's threads the call may use (0, the default, is all of them), and where they run.
+//
+// A plain number of threads converts to a policy, so anything that used to take 'n_threads' still does:
+//
+//  MontecarloIntegrate(n_pts, bounds, fcn, seed, 8);                                      //8 threads
+//  MontecarloIntegrate(n_pts, bounds, fcn, seed, ExecutionPolicy_t(0, kAffinityCompact)); //all, pinned
+//
+
+enum ThreadAffinity_t {
+    kAffinityKeep,          //leave the pool's threads as they are (pinned or not). this is the default.
+    kAffinityNone,          //unpin them, and let the OS move them around freely
+    kAffinityCompact,       //pin them to one cpu each, filling up one NUMA node before moving on to the next
+    kAffinitySpread         //pin them to one cpu each, taking turns between the NUMA nodes
+};
+
+struct ExecutionPolicy_t {
+    unsigned int n_threads{0};                      //max. number of threads to use (0 = all of the pool's threads)
+    ThreadAffinity_t affinity{kAffinityKeep};       //how to pin the pool's threads (see above)
+
+    ExecutionPolicy_t() = default;
+
+    ExecutionPolicy_t(const unsigned int n_threads_, const ThreadAffinity_t affinity_=kAffinityKeep)
+        : n_threads(n_threads_), affinity(affinity_) {}
+};
+
+#endif
\ No newline at end of file
@@ -2,7 +2,9 @@
 #include <random> 
 #include <chrono> 
 #include <iostream> 
-#include <thread>
+#include <algorithm> 
+#include "ThreadPool.hpp"
+#include "RunTelemetry.hpp"
 
 using namespace std; 
 
@@ -10,68 +12,222 @@ ValueWithError_t<double> GridIntegrate(
     const unsigned long int n_pts,                  //number of points to use in the integration PER SIDE. 
                                                     // for example, if you choose npts=100 and dim=5, then total points is 100^5. 
     const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
-    std::function<bool(const double*)> fcn          //fcn to integrate. must accept (CONST) ptr to doubles. returns TRUE if inside region, FALSE if not.               
+    std::function<bool(const double*)> fcn,         //fcn to integrate. must accept (CONST) ptr to doubles. returns TRUE if inside region, FALSE if not.               
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
 )
-{ 
-    //dimension of the space we're integrating in 
-    const int dim = (int)bounds.size(); 
+{
+    return GridIntegrate(n_pts, bounds, make_batch_integrand((int)bounds.size(), fcn), policy); 
+}
 
-    //get the number of threads we have to work with
-    const int n_threads = std::thread::hardware_concurrency(); 
+namespace {
+
+    //walks through all the points of the grid, a block at a time, and hands each block to 
+    // 'on_block(tally, n_block, X)', which adds it to the tally of its chunk. returns the tally of each chunk. 
+    // (if 'telemetry' isn't null, the time each chunk takes is recorded.)
+    template<typename Tally_t, typename OnBlock> vector<Tally_t> grid_blocks(
+        const unsigned long int n_pts, 
+        const vector<IntegrationBound_t>& bounds, 
+        const ExecutionPolicy_t& policy, 
+        const OnBlock& on_block, 
+        TelemetryRecorder_t* telemetry=nullptr
+    )
+    {
+        //dimension of the space we're integrating in 
+        const int dim = (int)bounds.size(); 
 
-    //create an array of ints, which represents the 'point' in space we're using. 
-    vector<int> point_id(dim, 0); 
-    vector<double> point;
-    vector<double> dx; 
+        //grid spacing
+        vector<double> dx; 
+        for (int i=0; i<dim; i++) dx.push_back( (bounds[i].xmax - bounds[i].xmin)/((double)n_pts-1) ); 
 
-    //start at one 'corner' of our hypercube. 
-    for (int i=0; i<dim; i++) {
+        //the grid is a set of 'rows' along the X[0]-axis. the rows are numbered odometer-style by the 
+        // indices of their other coordinates (X[1] moving fastest), and split up into contiguous ranges 
+        // of rows, each of which is one chunk of work for the thread pool. 
+        const unsigned long int n_rows         = GridRows::CountRows(n_pts, dim); 
+        const unsigned long int rows_per_chunk = GridRows::RowsPerChunk(n_pts); 
+        const unsigned long int n_chunks       = (n_rows + rows_per_chunk - 1) / rows_per_chunk; 
 
-        //starting point
-        point.push_back(bounds[i].xmin);  
+        //the X[0] coordinates of a row are the same for every row
+        vector<double> row_x0(n_pts); 
+        for (unsigned long int j=0; j<n_pts; j++) row_x0[j] = bounds[0].xmin + ( dx[0] * ((double)j) ); 
 
-        //grid spacing
-        dx.push_back( (bounds[i].xmax - bounds[i].xmin)/((double)n_pts-1) ); 
+        vector<Tally_t> chunk_tallies(n_chunks); 
+
+        ThreadPool::Global().ParallelFor(n_chunks, [&](unsigned long int i_chunk, unsigned int i_thread)
+        {
+            const double t_start = telemetry ? telemetry->Now() : 0.; 
+            double t_evaluate = 0.; 
+
+            OnBlock on_block_copy = on_block; 
+
+            //(the time spent in the fcn is only measured if the telemetry is on)
+            auto chunk_on_block = [&](Tally_t& tally, const unsigned long int n_block, const double* const* X) 
+            {
+                if (!telemetry) { on_block_copy(tally, n_block, X); return; }
+
+                const double t = telemetry->Now(); 
+                on_block_copy(tally, n_block, X); 
+                t_evaluate += telemetry->Now() - t; 
+            }; 
+
+            //(written back to chunk_tallies at the end, so that the threads aren't all writing to the same few cache lines)
+            Tally_t tally{}; 
+
+            const unsigned long int first_row = i_chunk * rows_per_chunk; 
+            const unsigned long int last_row  = min<unsigned long int>( n_rows, first_row + rows_per_chunk ); 
+
+            //start directly at the first row of this chunk 
+            vector<unsigned long int> point_id(dim, 0); 
+            GridRows::RowToIndex(first_row, n_pts, point_id.data(), dim); 
+
+            vector<double> point(dim); 
+            for (int i=1; i<dim; i++) point[i] = bounds[i].xmin + ( dx[i] * ((double)point_id[i]) ); 
+
+            //block of grid points waiting to be evaluated, stored coordinate-by-coordinate (SoA): 
+            // block[i*kBatchSize + j] is the i-th coordinate of point j. 
+            vector<double> block(dim * kBatchSize); 
+            vector<const double*> X(dim); 
+            for (int i=0; i<dim; i++) X[i] = block.data() + i*kBatchSize; 
+
+            unsigned long int n_block=0; 
+
+            for (unsigned long int i_row=first_row; i_row<last_row; i_row++) {
+
+                //add this row to the block a segment at a time: X[0] comes from the row, and the 
+                // other coordinates are the same all along it. 
+                for (unsigned long int j=0; j<n_pts; ) {
+
+                    const unsigned long int n_seg = min<unsigned long int>( kBatchSize - n_block, n_pts - j ); 
+
+                    copy(row_x0.begin() + j, row_x0.begin() + j + n_seg, block.begin() + n_block); 
+                    for (int i=1; i<dim; i++) fill_n(block.begin() + i*kBatchSize + n_block, n_seg, point[i]); 
+
+                    n_block += n_seg; 
+                    j       += n_seg; 
+
+                    if (n_block == kBatchSize) { chunk_on_block(tally, n_block, X.data()); n_block=0; }
+                }
+
+                //now, move on to the next row, odometer-style
+                for (int i=1; i<dim; i++) {
+
+                    point_id[i]++; 
+                    point[i] = bounds[i].xmin + ( dx[i] * ((double)point_id[i]) );
+
+                    if (point_id[i] < n_pts) break; 
+
+                    point_id[i] = 0; 
+                    point[i]    = bounds[i].xmin;
+                }
+            }
+
+            //evaluate whatever is left over in the last block
+            if (n_block > 0) chunk_on_block(tally, n_block, X.data()); 
+
+            chunk_tallies[i_chunk] = move(tally); 
+
+            if (telemetry) telemetry->AddChunk(i_thread, t_start, telemetry->Now(), (last_row - first_row)*n_pts, t_evaluate); 
+
+        }, policy, (double)(rows_per_chunk * n_pts * dim)); 
+
+        return chunk_tallies; 
     }
+}
+
+ValueWithError_t<double> GridIntegrate(
+    const unsigned long int n_pts,                  //number of points to use in the integration PER SIDE. 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    BatchIntegrand_t fcn,                           //fcn to integrate, a whole (SoA) block of points at a time. returns the number inside the region.               
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{ 
+    auto count_block = [fcn](unsigned long int& count, const unsigned long int n_block, const double* const* X)
+    {
+        count += fcn(n_block, X); 
+    }; 
+    TelemetryRecorder_t telemetry("GridIntegrate"); 
+    const auto chunk_counts = grid_blocks<unsigned long int>(n_pts, bounds, policy, count_block, telemetry.Get()); 
+
+    unsigned long int count =0; 
+    for (auto chunk_count : chunk_counts) count += chunk_count; 
+
+    auto result = GridRows::Normalize(count, n_pts, bounds); 
+    result.telemetry = telemetry.Finish((long int)count); 
+    return result; 
+}
+
+ValueWithError_t<double> GridIntegrate(
+    const unsigned long int n_pts,                  //number of points to use in the integration PER SIDE. 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    BatchValueIntegrand_t fcn,                      //real-valued fcn to integrate, a whole (SoA) block of points at a time
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{ 
+    auto stats_block = [fcn, f = vector<double>(kBatchSize)](RunningStats_t& stats, const unsigned long int n_block, const double* const* X) mutable
+    {
+        fcn(n_block, X, f.data()); 
+        stats.Add(n_block, f.data()); 
+    }; 
+    TelemetryRecorder_t telemetry("GridIntegrate"); 
+    const auto chunk_stats = grid_blocks<RunningStats_t>(n_pts, bounds, policy, stats_block, telemetry.Get()); 
 
-    unsigned long long count =0; 
-    
-    while (1) {
-
-        //check the fcn at our current grid point
-        if (fcn(point.data())) count++;
-        
-        //now, update our point
-        bool at_end=true; 
-        for (int i=0; i<dim; i++) {
-
-            point_id[i]++; 
-            point[i]    = bounds[i].xmin + ( dx[i] * ((double)point_id[i]) );
-
-            //check if this point is out-of-bounds. if not, then we're ok to increment it and move on. 
-            if (point_id[i] < n_pts) { at_end=false; break; }
-
-            //if we got here, that means that we've reached the end of the hyper-grid
-            // w/r/t this coordinate. we need to increment the next one...
-            
-            // reset this coordinate, and continue by iterating the next one. 
-            point_id[i] = 0; 
-            point[i]    = bounds[i].xmin;
-            
-        }
-        if (at_end) break; 
-        
-       //printf("point: %+.2f %+.2f %+.2f\n", point[0], point[1], point[2]);
+    RunningStats_t stats; 
+    for (const auto& chunk : chunk_stats) stats.Add(chunk); 
+
+    double total_vol{1.}; 
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    //(as for the counting version, the error is only a rough guess: it's the error random points would have.)
+    auto result = stats.Estimate(total_vol); 
+    result.telemetry = telemetry.Finish(); 
+    return result; 
+}
+
+std::vector<ValueWithError_t<double>> GridIntegrateVector(
+    const unsigned long int n_pts,                  //number of points to use in the integration PER SIDE. 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    const unsigned long int n_components,           //number of outputs of the fcn
+    BatchVectorIntegrand_t fcn,                     //fcn to integrate, a whole (SoA) block of points at a time
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{ 
+    //(F is pointed at this copy's own buffer on every call, since each chunk runs its own copy of the lambda)
+    auto stats_block = [fcn, n_components, f = vector<double>(n_components * kBatchSize), F = vector<double*>(n_components)]
+        (vector<RunningStats_t>& stats, const unsigned long int n_block, const double* const* X) mutable
+    {
+        if (stats.empty()) stats.resize(n_components); 
+        for (unsigned long int k=0; k<n_components; k++) F[k] = f.data() + k*kBatchSize; 
+
+        fcn(n_block, X, F.data()); 
+        for (unsigned long int k=0; k<n_components; k++) stats[k].Add(n_block, F[k]); 
+    }; 
+    TelemetryRecorder_t telemetry("GridIntegrateVector"); 
+    const auto chunk_stats = grid_blocks<vector<RunningStats_t>>(n_pts, bounds, policy, stats_block, telemetry.Get()); 
+
+    vector<RunningStats_t> stats(n_components); 
+    for (const auto& chunk : chunk_stats) {
+        for (unsigned long int k=0; k<chunk.size(); k++) stats[k].Add(chunk[k]); 
     }
 
-    //compute the volume of our 'box' we're integrating in 
     double total_vol{1.}; 
     for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
 
-    double result = total_vol * (((double)count) / pow( n_pts, dim )); 
-    //very rudimentary error estimate
-    double error  = total_vol * (sqrt((double)count) / pow( n_pts, dim )); 
+    const auto record = telemetry.Finish(); 
 
-    return ValueWithError_t<double>{ result, error }; 
+    vector<ValueWithError_t<double>> results; 
+    for (const auto& component : stats) {
+        results.push_back( component.Estimate(total_vol) ); 
+        results.back().telemetry = record; 
+    }
+    return results; 
 }
 
+std::vector<ValueWithError_t<double>> GridIntegrateVector(
+    const unsigned long int n_pts,                  //number of points to use in the integration PER SIDE. 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    const unsigned long int n_components,           //number of outputs of the fcn
+    std::function<void(const double*, double*)> fcn,//fcn to integrate. writes its outputs at the point X to out[0 ... n_components-1]
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    return GridIntegrateVector(n_pts, bounds, n_components, make_batch_vector_integrand((int)bounds.size(), n_components, fcn), policy); 
+}
\ No newline at end of file
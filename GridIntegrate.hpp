@@ -6,15 +6,205 @@
 #include <limits> 
 #include <functional> 
 #include <vector> 
+#include <cmath> 
+#include <stdexcept> 
+#include <algorithm> 
 #include "ValueWithError.hpp"
 #include "IntegrationBound.hpp"
+#include "BatchIntegrand.hpp"
+#include "ThreadPool.hpp"
+#include "RunTelemetry.hpp"
+#include "ExecutionPolicy.hpp"
 
 // A generalized monte-carlo integration tool 
 
+// the grid integrators walk the grid one 'row' (a line of points along the X[0]-axis) at a time. the 
+// n^(dim-1) rows are numbered odometer-style by the indices of their other coordinates (X[1] moving 
+// fastest), and handed to the thread pool as contiguous ranges of rows. 
+namespace GridRows {
+
+    //number of rows in a grid with n_pts_per_side points per side. throws std::invalid_argument if 
+    // the grid has more points than fit in 64 bits. 
+    inline unsigned long int CountRows(const unsigned long int n_pts_per_side, const int dim)
+    {
+        unsigned __int128 n_total = n_pts_per_side; 
+        unsigned __int128 n_rows  = 1; 
+        for (int i=1; i<dim; i++) {
+            n_rows  *= n_pts_per_side; 
+            n_total *= n_pts_per_side; 
+            if (n_total > std::numeric_limits<unsigned long int>::max()) {
+                throw std::invalid_argument("in <GridRows::CountRows>: grid has more than 2^64 points."); 
+            }
+        }
+        return (unsigned long int)n_rows; 
+    }
+
+    //number of rows in each chunk of work (about kChunkSize points' worth)
+    inline unsigned long int RowsPerChunk(const unsigned long int n_pts_per_side)
+    {
+        return std::max<unsigned long int>(1, kChunkSize / std::max<unsigned long int>(1, n_pts_per_side)); 
+    }
+
+    //the grid indices of the first point of row number 'i_row': index[0] = 0, and index[1 ... dim-1] 
+    // are the digits of i_row in base n_pts_per_side. 
+    inline void RowToIndex(unsigned long int i_row, const unsigned long int n_pts_per_side, unsigned long int* index, const int dim)
+    {
+        index[0] = 0; 
+        for (int i=1; i<dim; i++) {
+            index[i] = i_row % n_pts_per_side; 
+            i_row   /= n_pts_per_side; 
+        }
+    }
+
+    //turns the number of grid points inside the region into the integral. the division is done in long 
+    // double, on the exact number of grid points (rather than pow(n, dim)). 
+    inline ValueWithError_t<double> Normalize(
+        const unsigned long int count, 
+        const unsigned long int n_pts_per_side, 
+        const std::vector<IntegrationBound_t>& bounds
+    )
+    {
+        long double n_total = 1.; 
+        long double total_vol = 1.; 
+        for (const auto& bound : bounds) {
+            n_total   *= (long double)n_pts_per_side; 
+            total_vol *= (long double)(bound.xmax - bound.xmin); 
+        }
+
+        return ValueWithError_t<double>{ 
+            (double)(total_vol * ((long double)count / n_total)), 
+            (double)(total_vol * (std::sqrt((long double)count) / n_total))     //very rudimentary error estimate
+        }; 
+    }
+}
+
+ValueWithError_t<double> GridIntegrate(
+    const long unsigned int n_pts_per_side,         //number of points PER SIDE of the n-hypercube to use 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
+    std::function<bool(const double*)> fcn,         //fcn to integrate. must accept (CONST) ptr to doubles.  
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// same as above, but the fcn is evaluated on a whole block of points at a time (see BatchIntegrand.hpp).
+ValueWithError_t<double> GridIntegrate(
+    const long unsigned int n_pts_per_side,         //number of points PER SIDE of the n-hypercube to use 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
+    BatchIntegrand_t fcn,                           //fcn to integrate. returns the number of points in the block inside the region. 
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// same as above, for a real-valued fcn (see BatchIntegrand.hpp). 
 ValueWithError_t<double> GridIntegrate(
     const long unsigned int n_pts_per_side,         //number of points PER SIDE of the n-hypercube to use 
     const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
-    std::function<bool(const double*)> fcn          //fcn to integrate. must accept (CONST) ptr to doubles.  
+    BatchValueIntegrand_t fcn,                      //fcn to integrate. writes the value of the fcn at each point of the block. 
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// same as above, for a vector-valued fcn (see BatchVectorIntegrand_t): result k is the integral of output k. 
+std::vector<ValueWithError_t<double>> GridIntegrateVector(
+    const long unsigned int n_pts_per_side,         //number of points PER SIDE of the n-hypercube to use 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
+    const unsigned long int n_components,           //number of outputs of the fcn
+    BatchVectorIntegrand_t fcn,                     //fcn to integrate. writes each output of the fcn at each point of the block.
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// ...and for one called a point at a time: fcn(X, out) writes its outputs to out[0 ... n_components-1]
+std::vector<ValueWithError_t<double>> GridIntegrateVector(
+    const long unsigned int n_pts_per_side,         //number of points PER SIDE of the n-hypercube to use 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
+    const unsigned long int n_components,           //number of outputs of the fcn
+    std::function<void(const double*, double*)> fcn,//fcn to integrate
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
 ); 
 
+// same as above, but with the dimension and the type of the fcn known at compile time, so that 
+// the fcn can be inlined, and the loops over coordinates unrolled. 'fcn' must be callable as 
+// bool(const double*), and bounds.size() must equal 'Dim'. see DimDispatch.hpp for how to get 
+// here from a runtime dimension. 
+template<int Dim, typename F> ValueWithError_t<double> GridIntegrate(
+    const long unsigned int n_pts_per_side,         //number of points PER SIDE of the n-hypercube to use 
+    const std::vector<IntegrationBound_t>& bounds,  //must have exactly 'Dim' bounds
+    F&& fcn,                                        //fcn to integrate. returns TRUE if inside region, FALSE if not.
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+)
+{
+    static_assert(Dim > 0, "in <GridIntegrate<Dim>>: Dim must be positive"); 
+
+    if (bounds.size() != Dim) {
+        throw std::invalid_argument("in <GridIntegrate<Dim>>: number of bounds given does not match 'Dim'."); 
+    }
+
+    const long unsigned int n_pts = n_pts_per_side; 
+
+    std::array<double, Dim> dx; 
+    for (int i=0; i<Dim; i++) dx[i] = (bounds[i].xmax - bounds[i].xmin)/((double)n_pts-1); 
+
+    const unsigned long int n_rows         = GridRows::CountRows(n_pts, Dim); 
+    const unsigned long int rows_per_chunk = GridRows::RowsPerChunk(n_pts); 
+    const unsigned long int n_chunks       = (n_rows + rows_per_chunk - 1) / rows_per_chunk; 
+
+    std::vector<unsigned long int> chunk_counts(n_chunks, 0); 
+
+    //(the fcn is inlined into the walk over the grid, so its time can't be told apart from the time spent 
+    // making the points; for the telemetry, all of a chunk counts as evaluating the fcn.)
+    TelemetryRecorder_t telemetry_recorder("GridIntegrate<Dim>"); 
+    TelemetryRecorder_t* const telemetry = telemetry_recorder.Get(); 
+
+    ThreadPool::Global().ParallelFor(n_chunks, [&](unsigned long int i_chunk, unsigned int i_thread)
+    {
+        const double t_start = telemetry ? telemetry->Now() : 0.; 
+
+        auto chunk_fcn = fcn; 
+
+        const unsigned long int first_row = i_chunk * rows_per_chunk; 
+        const unsigned long int last_row  = std::min<unsigned long int>( n_rows, first_row + rows_per_chunk ); 
+
+        //start directly at the first row of this chunk 
+        std::array<long unsigned int, Dim> point_id; 
+        GridRows::RowToIndex(first_row, n_pts, point_id.data(), Dim); 
+
+        std::array<double, Dim> point; 
+        for (int i=0; i<Dim; i++) point[i] = bounds[i].xmin + ( dx[i] * ((double)point_id[i]) ); 
+
+        unsigned long int count =0; 
+
+        for (unsigned long int i_row=first_row; i_row<last_row; i_row++) {
+
+            //walk along the X[0]-axis (the one which moves fastest) all at once 
+            for (long unsigned int j=0; j<n_pts; j++) {
+                point[0] = bounds[0].xmin + ( dx[0] * ((double)j) ); 
+                if (chunk_fcn(point.data())) count++; 
+            }
+
+            //now, move on to the next row, odometer-style
+            for (int i=1; i<Dim; i++) {
+
+                point_id[i]++; 
+                point[i] = bounds[i].xmin + ( dx[i] * ((double)point_id[i]) );
+
+                if (point_id[i] < n_pts) break; 
+
+                point_id[i] = 0; 
+                point[i]    = bounds[i].xmin;
+            }
+        }
+        chunk_counts[i_chunk] = count; 
+
+        if (telemetry) {
+            const double t_end = telemetry->Now(); 
+            telemetry->AddChunk(i_thread, t_start, t_end, (last_row - first_row) * n_pts, t_end - t_start); 
+        }
+
+    }, policy, (double)(rows_per_chunk * n_pts * Dim)); 
+
+    unsigned long int count =0; 
+    for (auto chunk_count : chunk_counts) count += chunk_count; 
+
+    auto result = GridRows::Normalize(count, n_pts, bounds); 
+    result.telemetry = telemetry_recorder.Finish((long int)count); 
+    return result; 
+}
+
 #endif
\ No newline at end of file
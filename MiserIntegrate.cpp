@@ -0,0 +1,368 @@
+#include "MiserIntegrate.hpp"
+#include "ThreadPool.hpp"
+#include "PhiloxRandom.hpp"
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+    //fraction of a region's points spent exploring it, before it is split. (the exploring points aren't
+    // used in the result, and this is paid again at every level; Press & Farrar use 0.1, but for our
+    // inside/outside fcns, a smaller fraction does better.)
+    constexpr double kMiserExploreFraction = 0.02;
+
+    //regions are never given fewer than this many points (per dimension)
+    constexpr unsigned long int kMiserMinPtsPerDim = 16;
+
+    //regions with fewer than this many times the minimum aren't split any more
+    constexpr unsigned long int kMiserMinSplitFactor = 32;
+
+    //the points are shared between the two halves in proportion to sigma^(2/(1+alpha)); alpha=2 is
+    // what Press & Farrar found worked best.
+    constexpr double kMiserAlpha = 2.;
+
+    //number of regions the top of the tree is split into, before the rest is handed to the threads. (this is
+    // fixed, rather than depending on the number of threads, so that the sums are always done in the same order.)
+    constexpr unsigned long int kMiserTopRegions = 64;
+
+    //regions are numbered like a binary heap (the root is 1, the halves of region k are 2k and 2k+1),
+    // so a region can't be split more than this many times.
+    constexpr int kMiserMaxDepth = 62;
+
+    struct Region_t {
+        vector<IntegrationBound_t> bounds;
+        unsigned long int n_pts{0};                 //number of points this region (and its sub-regions) may use
+        uint64_t id{1};
+        int depth{0};
+    };
+
+    struct Estimate_t {
+        double val{0.}, var{0.};
+    };
+
+    //everything which stays the same for all regions
+    struct MiserContext_t {
+        int dim;
+        uint64_t seed;
+        unsigned long int min_pts, min_split_pts;
+        ExecutionPolicy_t policy;
+        const BatchIntegrand_t* batch_fcn;          //number of points of a block inside the region (for the regions which aren't split)
+        const BatchValueIntegrand_t* indicator_fcn; //1 at each point of a block inside the region, 0 outside (for exploring a region)
+    };
+
+    //the seed of region 'id''s own random stream
+    uint64_t region_seed(const uint64_t seed, const uint64_t id)
+    {
+        const auto r = Philox::Block(
+            { (uint32_t)id, (uint32_t)(id >> 32), 0xFFFFFFFFu, 0xFFFFFFFFu },
+            { (uint32_t)seed, (uint32_t)(seed >> 32) }
+        );
+        return ( ((uint64_t)r[1]) << 32 ) | r[0];
+    }
+
+    double region_volume(const Region_t& region)
+    {
+        double vol{1.};
+        for (const auto& bound : region.bounds) vol *= (bound.xmax - bound.xmin);
+        return vol;
+    }
+
+    //plain (hit-or-miss) monte-carlo in the region, with points [first, first + n) of the region's stream
+    Estimate_t leaf_estimate(const Region_t& region, const uint64_t first, const unsigned long int n, const MiserContext_t& ctx)
+    {
+        const uint64_t seed = region_seed(ctx.seed, region.id);
+
+        const unsigned long int n_chunks = (n + kChunkSize - 1) / kChunkSize;
+        vector<unsigned long int> chunk_counts(n_chunks, 0);
+
+        ThreadPool::Global().ParallelFor(n_chunks, [&](unsigned long int i_chunk, unsigned int)
+        {
+            const unsigned long int n_chunk_pts = min<unsigned long int>( kChunkSize, n - i_chunk*kChunkSize );
+
+            BatchIntegrand_t chunk_fcn = *ctx.batch_fcn;
+
+            vector<double> block(ctx.dim * kBatchSize);
+            vector<double*> X(ctx.dim);
+            for (int i=0; i<ctx.dim; i++) X[i] = block.data() + i*kBatchSize;
+
+            unsigned long int count=0, n_done=0;
+            while (n_done < n_chunk_pts) {
+                const unsigned long int n_block = min<unsigned long int>( kBatchSize, n_chunk_pts - n_done );
+                philox_fill_block(seed, first + i_chunk*kChunkSize + n_done, n_block, region.bounds, X.data());
+                count  += chunk_fcn(n_block, X.data());
+                n_done += n_block;
+            }
+            chunk_counts[i_chunk] = count;
+
+        }, ctx.policy, (double)(kChunkSize * ctx.dim));
+
+        unsigned long int count=0;
+        for (auto chunk_count : chunk_counts) count += chunk_count;
+
+        const double vol = region_volume(region);
+        const double p   = ((double)count)/((double)n);
+
+        return Estimate_t{ vol*p, vol*vol*p*(1.-p)/((double)n) };
+    }
+
+    //explores the region, and, if it's worth it, splits it into two halves (and returns true). if the
+    // region isn't split, 'estimate' is filled with its plain monte-carlo estimate instead.
+    bool split_region(const Region_t& region, const MiserContext_t& ctx, Region_t& left, Region_t& right, Estimate_t& estimate)
+    {
+        const int dim = ctx.dim;
+
+        if (region.n_pts < ctx.min_split_pts || region.depth >= kMiserMaxDepth) {
+            estimate = leaf_estimate(region, 0, region.n_pts, ctx);
+            return false;
+        }
+
+        const unsigned long int n_explore = max<unsigned long int>( ctx.min_pts, (unsigned long int)(kMiserExploreFraction * region.n_pts) );
+
+        const uint64_t seed = region_seed(ctx.seed, region.id);
+
+        //for each axis, and each half of the region along that axis: number of points, and number inside.
+        // tally[4*i + 0/1] is the lower half of axis i, tally[4*i + 2/3] the upper half.
+        const unsigned long int n_chunks = (n_explore + kChunkSize - 1) / kChunkSize;
+        vector<vector<unsigned long int>> chunk_tallies(n_chunks);
+
+        ThreadPool::Global().ParallelFor(n_chunks, [&](unsigned long int i_chunk, unsigned int)
+        {
+            const unsigned long int n_chunk_pts = min<unsigned long int>( kChunkSize, n_explore - i_chunk*kChunkSize );
+
+            BatchValueIntegrand_t chunk_fcn = *ctx.indicator_fcn;
+
+            vector<unsigned long int>& tally = chunk_tallies[i_chunk];
+            tally.assign(4*dim, 0);
+
+            vector<double> block(dim * kBatchSize);
+            vector<double*> X(dim);
+            for (int i=0; i<dim; i++) X[i] = block.data() + i*kBatchSize;
+            vector<double> inside(kBatchSize);
+
+            unsigned long int n_done=0;
+            while (n_done < n_chunk_pts) {
+
+                const unsigned long int n_block = min<unsigned long int>( kBatchSize, n_chunk_pts - n_done );
+                philox_fill_block(seed, i_chunk*kChunkSize + n_done, n_block, region.bounds, X.data());
+
+                //which of the block's points are inside (all with one call), then which half of each axis they're in
+                chunk_fcn(n_block, X.data(), inside.data());
+
+                for (int i=0; i<dim; i++) {
+                    const double  mid = 0.5*(region.bounds[i].xmin + region.bounds[i].xmax);
+                    const double* x   = X[i];
+                    for (unsigned long int j=0; j<n_block; j++) {
+                        const int half = (x[j] < mid) ? 0 : 2;
+                        tally[4*i + half]     += 1;
+                        tally[4*i + half + 1] += (inside[j] != 0.) ? 1 : 0;
+                    }
+                }
+                n_done += n_block;
+            }
+
+        }, ctx.policy, (double)(kChunkSize * dim));
+
+        vector<unsigned long int> tally(4*dim, 0);
+        for (const auto& chunk_tally : chunk_tallies) for (int k=0; k<4*dim; k++) tally[k] += chunk_tally[k];
+
+        //pick the axis which, once split, leaves the least variance
+        const double power = 2./(1. + kMiserAlpha);
+
+        int best_axis=-1;
+        double best_score=0., best_w_lo=0., best_w_hi=0.;
+        for (int i=0; i<dim; i++) {
+
+            const double n_lo = (double)tally[4*i + 0], in_lo = (double)tally[4*i + 1];
+            const double n_hi = (double)tally[4*i + 2], in_hi = (double)tally[4*i + 3];
+
+            if (n_lo < 2. || n_hi < 2.) continue;
+
+            //(the fraction inside is estimated as (k+1)/(n+2), rather than k/n, so that a half in which no
+            // exploring point happened to land inside isn't starved of points.)
+            const double p_lo = (in_lo + 1.)/(n_lo + 2.);
+            const double p_hi = (in_hi + 1.)/(n_hi + 2.);
+
+            const double w_lo = pow( sqrt( p_lo*(1. - p_lo) ), power );
+            const double w_hi = pow( sqrt( p_hi*(1. - p_hi) ), power );
+
+            if (best_axis < 0 || w_lo + w_hi < best_score) {
+                best_axis  = i;
+                best_score = w_lo + w_hi;
+                best_w_lo  = w_lo;
+                best_w_hi  = w_hi;
+            }
+        }
+
+        const unsigned long int n_left = region.n_pts - n_explore;
+
+        //(this can only happen if the exploration was very unlucky)
+        if (best_axis < 0) {
+            estimate = leaf_estimate(region, n_explore, n_left, ctx);
+            return false;
+        }
+
+        //share the points that are left between the halves
+        const double frac_lo = (best_w_lo + best_w_hi > 0.) ? best_w_lo/(best_w_lo + best_w_hi) : 0.5;
+
+        unsigned long int n_lo = (unsigned long int)llround( frac_lo * (double)n_left );
+        n_lo = min<unsigned long int>( max<unsigned long int>( n_lo, ctx.min_pts ), n_left - ctx.min_pts );
+
+        const double mid = 0.5*(region.bounds[best_axis].xmin + region.bounds[best_axis].xmax);
+
+        left  = Region_t{ region.bounds, n_lo,          2*region.id,     region.depth+1 };
+        right = Region_t{ region.bounds, n_left - n_lo, 2*region.id + 1, region.depth+1 };
+        left.bounds[best_axis].xmax  = mid;
+        right.bounds[best_axis].xmin = mid;
+
+        return true;
+    }
+
+    //the whole recursion, for one region
+    Estimate_t integrate_region(const Region_t& region, const MiserContext_t& ctx)
+    {
+        Region_t left, right;
+        Estimate_t estimate;
+
+        if (!split_region(region, ctx, left, right, estimate)) return estimate;
+
+        const Estimate_t est_lo = integrate_region(left,  ctx);
+        const Estimate_t est_hi = integrate_region(right, ctx);
+
+        return Estimate_t{ est_lo.val + est_hi.val, est_lo.var + est_hi.var };
+    }
+
+    ValueWithError_t<double> miser_integrate(
+        const unsigned long int n_pts,
+        const vector<IntegrationBound_t>& bounds,
+        const BatchIntegrand_t& batch_fcn,
+        const BatchValueIntegrand_t& indicator_fcn,
+        const optional<uint64_t> seed,
+        const ExecutionPolicy_t& policy
+    )
+    {
+        const int dim = (int)bounds.size();
+
+        MiserContext_t ctx;
+        ctx.dim           = dim;
+        ctx.seed          = Philox::ResolveSeed(seed);
+        ctx.min_pts       = kMiserMinPtsPerDim * (unsigned long int)dim;
+        ctx.min_split_pts = kMiserMinSplitFactor * ctx.min_pts;
+        ctx.policy        = policy;
+        ctx.batch_fcn     = &batch_fcn;
+        ctx.indicator_fcn = &indicator_fcn;
+
+        if (n_pts < ctx.min_pts) {
+            throw invalid_argument("in <MiserIntegrate>: need at least 16*dim points.");
+        }
+
+        //the top few levels of regions are split here, one at a time (each exploration is spread over the
+        // pool), until there are enough regions to keep every thread busy. then, each of those regions
+        // (and all of its sub-regions) is one chunk of work.
+        const unsigned long int n_regions_wanted = kMiserTopRegions;
+
+        vector<Estimate_t> estimates;
+        vector<Region_t> frontier{ Region_t{ bounds, n_pts, 1, 0 } };
+
+        while (!frontier.empty() && frontier.size() < n_regions_wanted) {
+
+            vector<Region_t> next;
+            for (const auto& region : frontier) {
+
+                Region_t left, right;
+                Estimate_t estimate;
+
+                if (split_region(region, ctx, left, right, estimate)) {
+                    next.push_back(move(left));
+                    next.push_back(move(right));
+                } else {
+                    estimates.push_back(estimate);
+                }
+            }
+            frontier = move(next);
+        }
+
+        vector<Estimate_t> frontier_estimates(frontier.size());
+
+        double max_region_pts=0.;
+        for (const auto& region : frontier) max_region_pts = max<double>( max_region_pts, (double)region.n_pts );
+
+        ThreadPool::Global().ParallelFor(frontier.size(), [&](unsigned long int i_region, unsigned int)
+        {
+            frontier_estimates[i_region] = integrate_region(frontier[i_region], ctx);
+
+        }, policy, max_region_pts * dim);
+
+        //add up all of the regions, in a fixed order
+        double val{0.}, var{0.};
+        for (const auto& est : estimates)          { val += est.val; var += est.var; }
+        for (const auto& est : frontier_estimates) { val += est.val; var += est.var; }
+
+        return ValueWithError_t<double>{ val, sqrt(var) };
+    }
+}
+
+ValueWithError_t<double> MiserIntegrate(
+    const unsigned long int n_pts,                  //total number of points to use
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.
+    std::function<bool(const double*)> fcn,         //fcn to integrate. returns TRUE if inside region, FALSE if not.
+    const std::optional<uint64_t> seed,             //seed of the random stream (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    const int dim = (int)bounds.size();
+
+    //(each chunk of points gets its own copy of the fcn, and of the point)
+    BatchValueIntegrand_t indicator_fcn = [dim, fcn, point = vector<double>(dim)](const unsigned long int n_block, const double* const* X, double* inside) mutable
+    {
+        for (unsigned long int j=0; j<n_block; j++) {
+            for (int i=0; i<dim; i++) point[i] = X[i][j];
+            inside[j] = fcn(point.data()) ? 1. : 0.;
+        }
+    };
+    return miser_integrate(n_pts, bounds, make_batch_integrand(dim, fcn), indicator_fcn, seed, policy);
+}
+
+ValueWithError_t<double> MiserIntegrate(
+    const unsigned long int n_pts,                  //total number of points to use
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.
+    BatchIntegrand_t fcn,                           //fcn to integrate, a whole (SoA) block of points at a time. returns the number inside the region.
+    const std::optional<uint64_t> seed,             //seed of the random stream (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    const int dim = (int)bounds.size();
+
+    //a count can't tell which of the points are inside, so while exploring, each point of the block is handed
+    // over as a block of its own (X1 points into X, so nothing is copied, or allocated, per point)
+    BatchValueIntegrand_t indicator_fcn = [dim, fcn, X1 = vector<const double*>(dim)](const unsigned long int n_block, const double* const* X, double* inside) mutable
+    {
+        for (unsigned long int j=0; j<n_block; j++) {
+            for (int i=0; i<dim; i++) X1[i] = X[i] + j;
+            inside[j] = (fcn(1, X1.data()) == 1) ? 1. : 0.;
+        }
+    };
+    return miser_integrate(n_pts, bounds, fcn, indicator_fcn, seed, policy);
+}
+
+ValueWithError_t<double> MiserIntegrate(
+    const unsigned long int n_pts,                  //total number of points to use
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.
+    BatchValueIntegrand_t fcn,                      //indicator of the region, a whole (SoA) block of points at a time: 1 inside, 0 outside.
+    const std::optional<uint64_t> seed,             //seed of the random stream (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    //(the regions which aren't split just count the points inside; each chunk gets its own copy of 'inside')
+    BatchIntegrand_t count_fcn = [fcn, inside = vector<double>(kBatchSize)](const unsigned long int n_block, const double* const* X) mutable
+    {
+        fcn(n_block, X, inside.data());
+
+        unsigned long int count=0;
+        for (unsigned long int j=0; j<n_block; j++) count += (inside[j] != 0.) ? 1 : 0;
+        return count;
+    };
+    return miser_integrate(n_pts, bounds, count_fcn, fcn, seed, policy);
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#ifndef MiserIntegrate_H
+#define MiserIntegrate_H
+
+#include <optional>
+#include <functional>
+#include <vector>
+#include <cstdint>
+#include "ValueWithError.hpp"
+#include "IntegrationBound.hpp"
+#include "BatchIntegrand.hpp"
+#include "ExecutionPolicy.hpp"
+
+// A recursive stratified-sampling monte-carlo integrator (MISER; W.H. Press & G.R. Farrar, Computers
+// in Physics 4, 190 (1990)).
+//
+// A small fraction of a region's points are spent 'exploring' it. They tell us, for each axis, how
+// much the fcn varies in each half of the region, if it were cut in two along that axis. The region is
+// cut along the axis which leaves the least variance, and the rest of its points are shared between the
+// two halves in proportion to how much the fcn varies in each, and so on, recursively. Regions with too
+// few points left are integrated with plain monte-carlo. For inside/outside fcns, this puts most of the
+// points near the boundary of the region, where all of the variance is.
+//
+// every region draws its points from its own Philox stream (see PhiloxRandom.hpp), so the same seed
+// always gives the same result, no matter how many threads are used.
+
+ValueWithError_t<double> MiserIntegrate(
+    const unsigned long int n_pts,                  //total number of points to use
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.
+    std::function<bool(const double*)> fcn,         //fcn to integrate. must accept (CONST) ptr to doubles.
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the random stream. the same seed always gives the same result.
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+);
+
+// same as above, for a batch integrand. it is handed whole blocks of points in the regions which aren't split
+// any further, but exploring a region needs to know which of the points are inside, so there, each point of
+// a block is handed over as a block of its own. (prefer the indicator version below, if there is one.)
+ValueWithError_t<double> MiserIntegrate(
+    const unsigned long int n_pts,                  //total number of points to use
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.
+    BatchIntegrand_t fcn,                           //fcn to integrate. returns the number of points in the block inside the region.
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the random stream (see above)
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+);
+
+// same as above, for the 'indicator' of the region: a real-valued batch integrand (see BatchIntegrand.hpp)
+// which is 1 at each point inside the region, and 0 outside. every block of points, while exploring or
+// not, is handed to it with a single call. (MISER's split rule assumes an inside/outside fcn, so it must
+// only ever be 0 or 1; see inside_both_spheres_indicator() in SphereKernels.hpp.)
+ValueWithError_t<double> MiserIntegrate(
+    const unsigned long int n_pts,                  //total number of points to use
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.
+    BatchValueIntegrand_t fcn,                      //indicator of the region. writes 1 for each point of the block inside, 0 for each outside.
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the random stream (see above)
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+);
+
+#endif
\ No newline at end of file
@@ -2,7 +2,10 @@
 #include <random> 
 #include <chrono> 
 #include <iostream> 
-#include <thread>
+#include "ThreadPool.hpp"
+#include "PhiloxRandom.hpp"
+#include "RunTelemetry.hpp"
+#include <algorithm>
 #include "ValueWithError.hpp"
 
 using namespace std; 
@@ -10,76 +13,575 @@ using namespace std;
 ValueWithError_t<double> MontecarloIntegrate(
     const unsigned long int n_pts,                  //number of points to use in the integration 
     const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
-    std::function<bool(const double*)> fcn          //fcn to integrate. must accept (CONST) ptr to doubles. returns TRUE if inside region, FALSE if not.               
+    std::function<bool(const double*)> fcn,         //fcn to integrate. must accept (CONST) ptr to doubles. returns TRUE if inside region, FALSE if not.               
+    const std::optional<uint64_t> seed,             //seed of the random stream (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
 )
-{   
-    //dimension of the space we're integrating in 
-    const int dim = (int)bounds.size(); 
-
-    //get the number of threads we have to work with
-    const long unsigned int n_threads = std::thread::hardware_concurrency(); 
+{
+    return MontecarloIntegrate(n_pts, bounds, make_batch_integrand((int)bounds.size(), fcn), seed, policy); 
+}
 
-    //initialize the vector of sub-results
-    vector<unsigned long int> sub_counts(n_threads, 0); 
+namespace {
 
-    //this way, we will have **just over** n_pts pts total
-    const long unsigned int n_pts_per_thread = (n_pts / n_threads) + 1;
+    //walks through the points [first, ends.back()) of the random stream, a block at a time, and hands each 
+    // block to 'on_block(tally, n_block, X)', which adds it to the tally of its segment. segment i is the 
+    // points [ends[i-1], ends[i]) (the first starts at 'first'), and should be at most kChunkSize long. 
+    // returns the tally of each segment. (if 'telemetry' isn't null, the time each segment takes is recorded.)
+    template<typename Tally_t, typename OnBlock> vector<Tally_t> montecarlo_segments(
+        const unsigned long int first, 
+        const vector<unsigned long int>& ends, 
+        const vector<IntegrationBound_t>& bounds, 
+        const uint64_t stream_seed, 
+        const ExecutionPolicy_t& policy, 
+        const OnBlock& on_block, 
+        TelemetryRecorder_t* telemetry=nullptr
+    )
+    {
+        //dimension of the space we're integrating in 
+        const int dim = (int)bounds.size(); 
 
-    //make the vector of threads
-    vector<thread> threads; 
+        vector<Tally_t> segment_tallies(ends.size()); 
 
-    for (int t=0; t<n_threads; t++) {
+        ThreadPool::Global().ParallelFor(ends.size(), [&](unsigned long int i_segment, unsigned int i_thread)
+        {
+            const unsigned long int segment_first = (i_segment == 0) ? first : ends[i_segment-1]; 
 
-        //now, with each thread, actually compute the result
-        threads.emplace_back([dim, n_pts_per_thread, t, &sub_counts, fcn, bounds]{
+            const double t_start = telemetry ? telemetry->Now() : 0.; 
+            double t_evaluate = 0.; 
 
-            //grab a reference to this specific sub-count
-            unsigned long int& sub_count = sub_counts[t];  
+            //each segment works with its own copy of the fcn, and its own tally (which is only written 
+            // back at the end, so that threads don't keep writing to neighbouring slots of segment_tallies)
+            OnBlock segment_on_block = on_block; 
+            Tally_t tally{}; 
 
-            //this is done here just for readability, even though the u.l.I type should
-            // by default be initialized to 0. 
-            sub_count = 0; 
+            //this is our block of random points in our rectangular sub-space, stored 
+            // coordinate-by-coordinate (SoA): block[i*kBatchSize + j] is the i-th coordinate of point j. 
+            vector<double> block(dim * kBatchSize); 
+            vector<double*> X(dim); 
+            for (int i=0; i<dim; i++) X[i] = block.data() + i*kBatchSize; 
             
-            // --- now, actually compute the volume by picking random points --- 
-            //this will seed our random-number generators 
-            random_device rd; 
+            for (unsigned long int i_pt=segment_first; i_pt < ends[i_segment]; ) {
 
-            mt19937 mtengine(rd());  
+                const unsigned long int n_block = min<unsigned long int>( kBatchSize, ends[i_segment] - i_pt ); 
 
-            auto dist = uniform_real_distribution<double>(0., 1.); 
-            auto get_uniform = [&dist, &mtengine](const IntegrationBound_t& bound) {
-                return bound.xmin + (bound.xmax - bound.xmin)*dist(mtengine);
-            };
+                // --- now, actually compute the volume by picking random points --- 
+                //these are points [i_pt, i_pt + n_block) of our random stream
+                philox_fill_block(stream_seed, i_pt, n_block, bounds, X.data()); 
 
-            //this is our vector which is a random point in our rectangular sub-space 
-            vector<double> space_point(dim); 
-            
-            unsigned long int i=0; 
-            while (i++ < n_pts_per_thread) {
+                if (telemetry) {
+                    const double t = telemetry->Now(); 
+                    segment_on_block(tally, n_block, X.data());
+                    t_evaluate += telemetry->Now() - t; 
+                } else {
+                    segment_on_block(tally, n_block, X.data());
+                }
+                i_pt += n_block; 
+            }
+            segment_tallies[i_segment] = move(tally); 
 
-                int j=0; 
-                for (const auto& bound : bounds) space_point[j++] = get_uniform(bound);
+            if (telemetry) telemetry->AddChunk(i_thread, t_start, telemetry->Now(), ends[i_segment] - segment_first, t_evaluate); 
 
-                if (fcn(space_point.data())) sub_count++;
-            }
-        });
+        }, policy, (double)(kChunkSize * dim)); 
+
+        return segment_tallies; 
     }
 
-    //this tells the program to wait until all threads are done executing. 
-    for (auto& thread : threads) thread.join(); 
+    //the same, for the points [0, n_pts), split into chunks of (at most) kChunkSize points each, which are 
+    // handed out to the threads of the pool. returns the tally of each chunk. (if first_chunk is given, the 
+    // chunks before it are skipped, and left out of what is returned.)
+    template<typename Tally_t, typename OnBlock> vector<Tally_t> montecarlo_blocks(
+        const unsigned long int n_pts, 
+        const vector<IntegrationBound_t>& bounds, 
+        const uint64_t stream_seed, 
+        const ExecutionPolicy_t& policy, 
+        const OnBlock& on_block, 
+        const unsigned long int first_chunk=0, 
+        TelemetryRecorder_t* telemetry=nullptr
+    )
+    {
+        vector<unsigned long int> ends; 
+        for (unsigned long int i_chunk=first_chunk; i_chunk*kChunkSize < n_pts; i_chunk++) {
+            ends.push_back( min<unsigned long int>( n_pts, (i_chunk + 1)*kChunkSize ) ); 
+        }
+        return montecarlo_segments<Tally_t>(first_chunk*kChunkSize, ends, bounds, stream_seed, policy, on_block, telemetry); 
+    }
+}
+
+ValueWithError_t<double> MontecarloIntegrate(
+    const unsigned long int n_pts,                  //number of points to use in the integration 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    BatchIntegrand_t fcn,                           //fcn to integrate, a whole (SoA) block of points at a time. returns the number inside the region.               
+    const std::optional<uint64_t> seed,             //seed of the random stream (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{   
+    //every point has a fixed place in the (counter-based) random stream of this seed, so the result 
+    // only depends on the seed; not on the number of threads, or the order the chunks are run in. 
+    const uint64_t stream_seed = Philox::ResolveSeed(seed); 
+
+    //the number of points inside the region, for each chunk
+    auto count_block = [fcn](unsigned long int& count, const unsigned long int n_block, double* const* X)
+    {
+        count += fcn(n_block, X); 
+    }; 
+    TelemetryRecorder_t telemetry("MontecarloIntegrate"); 
+    const auto chunk_counts = montecarlo_blocks<unsigned long int>(n_pts, bounds, stream_seed, policy, count_block, 0, telemetry.Get()); 
 
     //add all the sub-results together
     unsigned long int count = 0; 
-    for (auto sub_count : sub_counts) count += sub_count;
+    for (auto chunk_count : chunk_counts) count += chunk_count;
 
     //compute the volume of our 'box' we're integrating in 
     double total_vol{1.}; 
     for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
 
-    double result = total_vol * ((double)count) / ((double)(n_pts + n_threads)); 
+    double result = total_vol * ((double)count) / ((double)n_pts); 
     //very rudimentary error estimate
-    double error  = total_vol * (sqrt((double)count) / ((double)(n_pts + n_threads))); 
+    double error  = total_vol * (sqrt((double)count) / ((double)n_pts)); 
+
+    return ValueWithError_t<double>{ result, error, telemetry.Finish((long int)count) }; 
+}
+
+ValueWithError_t<double> MontecarloIntegrate(
+    const unsigned long int n_pts,                  //number of points to use in the integration 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    BatchValueIntegrand_t fcn,                      //real-valued fcn to integrate, a whole (SoA) block of points at a time
+    const std::optional<uint64_t> seed,             //seed of the random stream (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{   
+    const uint64_t stream_seed = Philox::ResolveSeed(seed); 
+
+    //(the lambda is copied for each chunk, so each has its own buffer for the values)
+    auto stats_block = [fcn, f = vector<double>(kBatchSize)](RunningStats_t& stats, const unsigned long int n_block, double* const* X) mutable
+    {
+        fcn(n_block, X, f.data()); 
+        stats.Add(n_block, f.data()); 
+    }; 
+    TelemetryRecorder_t telemetry("MontecarloIntegrate"); 
+    const auto chunk_stats = montecarlo_blocks<RunningStats_t>(n_pts, bounds, stream_seed, policy, stats_block, 0, telemetry.Get()); 
+
+    RunningStats_t stats; 
+    for (const auto& chunk : chunk_stats) stats.Add(chunk); 
+
+    double total_vol{1.}; 
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    auto result = stats.Estimate(total_vol); 
+    result.telemetry = telemetry.Finish(); 
+    return result; 
+}
+
+namespace {
+
+    void add_tally(unsigned long int& total, const unsigned long int chunk) { total += chunk; }
+    void add_tally(RunningStats_t& total, const RunningStats_t& chunk)      { total.Add(chunk); }
+
+    //the number of points inside the region, for the telemetry (-1 if the fcn doesn't count them)
+    long int tally_hits(const unsigned long int count) { return (long int)count; }
+    long int tally_hits(const RunningStats_t&)         { return -1; }
+
+    //runs the random stream in rounds, until 'estimate(tally, n_used)' (which gives the result so far) 
+    // reaches the target. each round carries on from where the last one left off, so the points used are 
+    // always the first n_used of the stream, no matter how many rounds it took to get there. (all the 
+    // rounds go into the one record of 'telemetry', which is finished, and handed back on the result.)
+    template<typename Tally_t, typename OnBlock, typename Estimate> TargetResult_t montecarlo_to_target(
+        const PrecisionTarget_t& target, 
+        const vector<IntegrationBound_t>& bounds, 
+        const uint64_t stream_seed, 
+        const ExecutionPolicy_t& policy, 
+        const OnBlock& on_block, 
+        const Estimate& estimate, 
+        TelemetryRecorder_t& telemetry
+    )
+    {
+        target.Check(); 
+
+        const unsigned long int max_pts = max<unsigned long int>( 1, target.max_pts ); 
+
+        //every round ends on a whole chunk (unless it runs into max_pts), so the next one can start at a chunk
+        auto round_end = [max_pts](const double n)
+        {
+            const double n_chunks = ceil( n / ((double)kChunkSize) ); 
+            return (unsigned long int)min<double>( (double)max_pts, n_chunks * (double)kChunkSize ); 
+        }; 
+
+        Tally_t total{}; 
+        unsigned long int n_used=0; 
+        unsigned long int n_end = round_end( (double)max<unsigned long int>(1, target.min_pts) ); 
+
+        while (true) {
+
+            for (const auto& chunk : montecarlo_blocks<Tally_t>(n_end, bounds, stream_seed, policy, on_block, n_used/kChunkSize, telemetry.Get())) {
+                add_tally(total, chunk); 
+            }
+            n_used = n_end; 
+
+            const ValueWithError_t<double> result = estimate(total, n_used); 
+            const double tol = target.Tolerance(result.val); 
+
+            TargetResult_t target_result; 
+            target_result.val            = result.val; 
+            target_result.error          = result.error; 
+            target_result.n_pts          = n_used; 
+            target_result.reached_target = (tol > 0. && result.error <= tol); 
+
+            if (target_result.reached_target || n_used >= max_pts) {
+                target_result.telemetry = telemetry.Finish(tally_hits(total)); 
+                return target_result; 
+            }
+
+            //the error goes as 1/sqrt(n), so guess how many points it will take (with a little to spare), but 
+            // don't more than quadruple the points in one round, in case the guess is off. 
+            const double n_guess = (tol > 0.) ? 1.2 * ((double)n_used) * pow( result.error/tol, 2 ) : 4.*((double)n_used); 
+
+            n_end = round_end( min<double>( max<double>( n_guess, (double)(n_used + kChunkSize) ), 4.*((double)n_used) ) ); 
+        }
+    }
+}
+
+TargetResult_t MontecarloIntegrateToTarget(
+    const PrecisionTarget_t target,                 //error to reach, and the most points to use
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    BatchIntegrand_t fcn,                           //fcn to integrate, a whole (SoA) block of points at a time. returns the number inside the region.               
+    const std::optional<uint64_t> seed,             //seed of the random stream (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    double total_vol{1.}; 
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    auto count_block = [fcn](unsigned long int& count, const unsigned long int n_block, double* const* X)
+    {
+        count += fcn(n_block, X); 
+    }; 
+
+    //the binomial error of the fraction of points inside. (for the error, the fraction is taken to be 
+    // (count+1)/(n+2), so that a run which hasn't found any points inside yet doesn't think it's done.)
+    auto estimate = [total_vol](const unsigned long int count, const unsigned long int n_used)
+    {
+        const double n = (double)n_used; 
+        const double p = ((double)count + 1.)/(n + 2.); 
+        return ValueWithError_t<double>{ total_vol * ((double)count) / n, total_vol * sqrt( p*(1. - p) / n ) }; 
+    }; 
+
+    TelemetryRecorder_t telemetry("MontecarloIntegrateToTarget"); 
+    return montecarlo_to_target<unsigned long int>(target, bounds, Philox::ResolveSeed(seed), policy, count_block, estimate, telemetry); 
+}
+
+TargetResult_t MontecarloIntegrateToTarget(
+    const PrecisionTarget_t target,                 //error to reach, and the most points to use
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    BatchValueIntegrand_t fcn,                      //real-valued fcn to integrate, a whole (SoA) block of points at a time
+    const std::optional<uint64_t> seed,             //seed of the random stream (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    double total_vol{1.}; 
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    auto stats_block = [fcn, f = vector<double>(kBatchSize)](RunningStats_t& stats, const unsigned long int n_block, double* const* X) mutable
+    {
+        fcn(n_block, X, f.data()); 
+        stats.Add(n_block, f.data()); 
+    }; 
+
+    auto estimate = [total_vol](const RunningStats_t& stats, const unsigned long int) { return stats.Estimate(total_vol); }; 
+
+    TelemetryRecorder_t telemetry("MontecarloIntegrateToTarget"); 
+    return montecarlo_to_target<RunningStats_t>(target, bounds, Philox::ResolveSeed(seed), policy, stats_block, estimate, telemetry); 
+}
+
+
+namespace {
+
+    //tallies the segments of the stream up to the last checkpoint (in parallel), then adds them up in 
+    // order, and gives 'estimate(tally, n)' each time the sum reaches a checkpoint. (the whole run is one 
+    // record of 'telemetry', which every checkpoint's result shares.)
+    template<typename Tally_t, typename OnBlock, typename Estimate> vector<ValueWithError_t<double>> montecarlo_checkpoints(
+        const vector<unsigned long int>& checkpoints, 
+        const vector<IntegrationBound_t>& bounds, 
+        const uint64_t stream_seed, 
+        const ExecutionPolicy_t& policy, 
+        const OnBlock& on_block, 
+        const Estimate& estimate, 
+        TelemetryRecorder_t& telemetry
+    )
+    {
+        const auto ends = checkpoint_segment_ends(checkpoints); 
+
+        const auto segment_tallies = montecarlo_segments<Tally_t>(0, ends, bounds, stream_seed, policy, on_block, telemetry.Get()); 
+
+        vector<ValueWithError_t<double>> results; 
+        results.reserve(checkpoints.size()); 
+
+        Tally_t total{}; 
+        for (size_t i=0, i_checkpoint=0; i<ends.size(); i++) {
+            add_tally(total, segment_tallies[i]); 
+            if (ends[i] == checkpoints[i_checkpoint]) results.push_back( estimate(total, checkpoints[i_checkpoint++]) ); 
+        }
+
+        const auto record = telemetry.Finish(tally_hits(total)); 
+        for (auto& result : results) result.telemetry = record; 
+        return results; 
+    }
+}
+
+std::vector<ValueWithError_t<double>> MontecarloIntegrateCheckpoints(
+    const std::vector<unsigned long int> checkpoints,   //numbers of points to give the result at (increasing)
+    const std::vector<IntegrationBound_t> bounds,       //number of dimensions is given by the number of bounds given. 
+    BatchIntegrand_t fcn,                               //fcn to integrate, a whole (SoA) block of points at a time. returns the number inside the region.               
+    const std::optional<uint64_t> seed,                 //seed of the random stream (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                     //threads (see ExecutionPolicy.hpp)
+)
+{
+    double total_vol{1.}; 
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    auto count_block = [fcn](unsigned long int& count, const unsigned long int n_block, double* const* X)
+    {
+        count += fcn(n_block, X); 
+    }; 
+
+    //(the same estimate, and error, as the fixed-size version)
+    auto estimate = [total_vol](const unsigned long int count, const unsigned long int n_pts)
+    {
+        return ValueWithError_t<double>{ total_vol * ((double)count) / ((double)n_pts), total_vol * (sqrt((double)count) / ((double)n_pts)) }; 
+    }; 
+
+    TelemetryRecorder_t telemetry("MontecarloIntegrateCheckpoints"); 
+    return montecarlo_checkpoints<unsigned long int>(checkpoints, bounds, Philox::ResolveSeed(seed), policy, count_block, estimate, telemetry); 
+}
+
+std::vector<ValueWithError_t<double>> MontecarloIntegrateCheckpoints(
+    const std::vector<unsigned long int> checkpoints,   //numbers of points to give the result at (increasing)
+    const std::vector<IntegrationBound_t> bounds,       //number of dimensions is given by the number of bounds given. 
+    BatchValueIntegrand_t fcn,                          //real-valued fcn to integrate, a whole (SoA) block of points at a time
+    const std::optional<uint64_t> seed,                 //seed of the random stream (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                     //threads (see ExecutionPolicy.hpp)
+)
+{
+    double total_vol{1.}; 
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    auto stats_block = [fcn, f = vector<double>(kBatchSize)](RunningStats_t& stats, const unsigned long int n_block, double* const* X) mutable
+    {
+        fcn(n_block, X, f.data()); 
+        stats.Add(n_block, f.data()); 
+    }; 
+
+    auto estimate = [total_vol](const RunningStats_t& stats, const unsigned long int) { return stats.Estimate(total_vol); }; 
+
+    TelemetryRecorder_t telemetry("MontecarloIntegrateCheckpoints"); 
+    return montecarlo_checkpoints<RunningStats_t>(checkpoints, bounds, Philox::ResolveSeed(seed), policy, stats_block, estimate, telemetry); 
+}
+
+std::vector<ValueWithError_t<double>> MontecarloIntegrateMulti(
+    const unsigned long int n_pts,                  //number of points to use in the integration 
+    const std::vector<IntegrationBound_t> bounds,   //bounding box shared by all of the regions
+    const unsigned long int n_regions,              //number of regions the fcn tests the points against
+    BatchMultiIntegrand_t fcn,                      //fcn to integrate. adds the number of points of the block inside each region to counts[k].
+    const std::optional<uint64_t> seed,             //seed of the random stream (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    //the number of points inside each region, for each chunk
+    auto count_block = [fcn, n_regions](vector<unsigned long int>& counts, const unsigned long int n_block, double* const* X)
+    {
+        if (counts.empty()) counts.assign(n_regions, 0); 
+        fcn(n_block, X, counts.data()); 
+    }; 
+    TelemetryRecorder_t telemetry("MontecarloIntegrateMulti"); 
+    const auto chunk_counts = montecarlo_blocks<vector<unsigned long int>>(n_pts, bounds, Philox::ResolveSeed(seed), policy, count_block, 0, telemetry.Get()); 
+
+    vector<unsigned long int> counts(n_regions, 0); 
+    for (const auto& chunk : chunk_counts) {
+        for (unsigned long int k=0; k<chunk.size(); k++) counts[k] += chunk[k]; 
+    }
+
+    double total_vol{1.}; 
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    //(the same estimate, and error, as the single-region version. there is no one hit ratio for all the 
+    // regions, so the record doesn't have one.)
+    const auto record = telemetry.Finish(); 
 
-    return ValueWithError_t<double>{ result, error }; 
+    vector<ValueWithError_t<double>> results; 
+    for (const unsigned long int count : counts) {
+        results.push_back({ total_vol * ((double)count) / ((double)n_pts), total_vol * (sqrt((double)count) / ((double)n_pts)), record }); 
+    }
+    return results; 
 }
 
+std::vector<ValueWithError_t<double>> MontecarloIntegrateVector(
+    const unsigned long int n_pts,                  //number of points to use in the integration 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    const unsigned long int n_components,           //number of outputs of the fcn
+    BatchVectorIntegrand_t fcn,                     //fcn to integrate, a whole (SoA) block of points at a time
+    const std::optional<uint64_t> seed,             //seed of the random stream (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    //the running stats of each output, for each chunk. (each chunk gets its own copy of the lambda, and so its 
+    // own buffer for the outputs; F is pointed at it on every call, since a copy's buffer is somewhere else.)
+    auto stats_block = [fcn, n_components, f = vector<double>(n_components * kBatchSize), F = vector<double*>(n_components)]
+        (vector<RunningStats_t>& stats, const unsigned long int n_block, double* const* X) mutable
+    {
+        if (stats.empty()) stats.resize(n_components); 
+        for (unsigned long int k=0; k<n_components; k++) F[k] = f.data() + k*kBatchSize; 
+
+        fcn(n_block, X, F.data()); 
+        for (unsigned long int k=0; k<n_components; k++) stats[k].Add(n_block, F[k]); 
+    }; 
+    TelemetryRecorder_t telemetry("MontecarloIntegrateVector"); 
+    const auto chunk_stats = montecarlo_blocks<vector<RunningStats_t>>(n_pts, bounds, Philox::ResolveSeed(seed), policy, stats_block, 0, telemetry.Get()); 
+
+    vector<RunningStats_t> stats(n_components); 
+    for (const auto& chunk : chunk_stats) {
+        for (unsigned long int k=0; k<chunk.size(); k++) stats[k].Add(chunk[k]); 
+    }
+
+    double total_vol{1.}; 
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    const auto record = telemetry.Finish(); 
+
+    vector<ValueWithError_t<double>> results; 
+    for (const auto& component : stats) {
+        results.push_back( component.Estimate(total_vol) ); 
+        results.back().telemetry = record; 
+    }
+    return results; 
+}
+
+std::vector<ValueWithError_t<double>> MontecarloIntegrateVector(
+    const unsigned long int n_pts,                  //number of points to use in the integration 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    const unsigned long int n_components,           //number of outputs of the fcn
+    std::function<void(const double*, double*)> fcn,//fcn to integrate. writes its outputs at the point X to out[0 ... n_components-1]
+    const std::optional<uint64_t> seed,             //seed of the random stream (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    return MontecarloIntegrateVector(n_pts, bounds, n_components, make_batch_vector_integrand((int)bounds.size(), n_components, fcn), seed, policy); 
+}
+
+ValueWithError_t<double> MontecarloIntegrateControlVariates(
+    const unsigned long int n_pts,                  //number of points to use in the integration 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    BatchValueIntegrand_t fcn,                      //real-valued fcn to integrate, a whole (SoA) block of points at a time
+    const std::vector<ControlVariate_t> controls,   //references, with their exact integrals over the bounds
+    const std::optional<uint64_t> seed,             //seed of the random stream (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    //the fcn, then each of the references
+    const unsigned long int n_fcns = 1 + controls.size(); 
+
+    //(F is pointed at this copy's own buffer on every call, since each chunk runs its own copy of the lambda)
+    auto covariance_block = [fcn, controls, n_fcns, f = vector<double>(n_fcns * kBatchSize), F = vector<double*>(n_fcns)]
+        (RunningCovariance_t& covariance, const unsigned long int n_block, double* const* X) mutable
+    {
+        for (unsigned long int k=0; k<n_fcns; k++) F[k] = f.data() + k*kBatchSize; 
+
+        fcn(n_block, X, F[0]); 
+        for (unsigned long int m=0; m<controls.size(); m++) controls[m].fcn(n_block, X, F[1+m]); 
+
+        covariance.Add(n_block, n_fcns, F.data()); 
+    }; 
+    TelemetryRecorder_t telemetry("MontecarloIntegrateControlVariates"); 
+    const auto chunk_covariances = montecarlo_blocks<RunningCovariance_t>(n_pts, bounds, Philox::ResolveSeed(seed), policy, covariance_block, 0, telemetry.Get()); 
+
+    RunningCovariance_t covariance; 
+    for (const auto& chunk : chunk_covariances) covariance.Add(chunk); 
+
+    double total_vol{1.}; 
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    //the mean each reference should have over the bounds
+    vector<double> mu; 
+    for (const auto& control : controls) mu.push_back( control.integral / total_vol ); 
+
+    auto result = covariance.Estimate(total_vol, mu); 
+    result.telemetry = telemetry.Finish(); 
+    return result; 
+}
+
+namespace {
+
+    //the (empty) record of shard 'i_shard' of a run, and the ends of the chunks of its points
+    ShardRecord_t montecarlo_shard_record(
+        const unsigned int i_shard, 
+        const unsigned int n_shards, 
+        const unsigned long int n_pts, 
+        const vector<IntegrationBound_t>& bounds, 
+        const uint64_t seed, 
+        vector<unsigned long int>& ends
+    )
+    {
+        ShardRecord_t record; 
+        record.integrator = "MontecarloIntegrate"; 
+        record.seed       = seed; 
+        record.bounds     = bounds; 
+        record.n_pts      = n_pts; 
+        shard_point_range(i_shard, n_shards, n_pts, record.first, record.end); 
+
+        //(the shard starts on a chunk boundary, so these are the same chunks a single run would use)
+        for (unsigned long int i_pt=record.first; i_pt < record.end; i_pt += kChunkSize) ends.push_back( min<unsigned long int>( record.end, i_pt + kChunkSize ) ); 
+        return record; 
+    }
+}
+
+ShardRecord_t MontecarloIntegrateShard(
+    const unsigned int i_shard,                     //which shard this is (0 ... n_shards-1)
+    const unsigned int n_shards,                    //number of shards the run is split into
+    const unsigned long int n_pts,                  //number of points of the whole run
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    BatchIntegrand_t fcn,                           //fcn to integrate, a whole (SoA) block of points at a time. returns the number inside the region.               
+    const uint64_t seed,                            //seed of the random stream
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    vector<unsigned long int> ends; 
+    ShardRecord_t record = montecarlo_shard_record(i_shard, n_shards, n_pts, bounds, seed, ends); 
+
+    auto count_block = [fcn](unsigned long int& count, const unsigned long int n_block, double* const* X)
+    {
+        count += fcn(n_block, X); 
+    }; 
+    //(a shard record has nowhere to keep the telemetry, so it only goes into the log)
+    TelemetryRecorder_t telemetry("MontecarloIntegrateShard"); 
+    const auto chunk_counts = montecarlo_segments<unsigned long int>(record.first, ends, bounds, Philox::ResolveSeed(seed), policy, count_block, telemetry.Get()); 
+
+    record.counting = true; 
+    for (auto chunk_count : chunk_counts) record.count += chunk_count; 
+    telemetry.Finish((long int)record.count); 
+    return record; 
+}
+
+ShardRecord_t MontecarloIntegrateShard(
+    const unsigned int i_shard,                     //which shard this is (0 ... n_shards-1)
+    const unsigned int n_shards,                    //number of shards the run is split into
+    const unsigned long int n_pts,                  //number of points of the whole run
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    BatchValueIntegrand_t fcn,                      //real-valued fcn to integrate, a whole (SoA) block of points at a time
+    const uint64_t seed,                            //seed of the random stream
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    vector<unsigned long int> ends; 
+    ShardRecord_t record = montecarlo_shard_record(i_shard, n_shards, n_pts, bounds, seed, ends); 
+
+    auto stats_block = [fcn, f = vector<double>(kBatchSize)](RunningStats_t& stats, const unsigned long int n_block, double* const* X) mutable
+    {
+        fcn(n_block, X, f.data()); 
+        stats.Add(n_block, f.data()); 
+    }; 
+
+    //(each chunk's stats are kept apart, so that the merge can add them up in the same order a single run does)
+    TelemetryRecorder_t telemetry("MontecarloIntegrateShard"); 
+    record.counting    = false; 
+    record.chunk_stats = montecarlo_segments<RunningStats_t>(record.first, ends, bounds, Philox::ResolveSeed(seed), policy, stats_block, telemetry.Get()); 
+    telemetry.Finish(); 
+    return record; 
+}
\ No newline at end of file
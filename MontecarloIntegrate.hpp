@@ -6,15 +6,236 @@
 #include <limits> 
 #include <functional> 
 #include <vector> 
+#include <cstdint> 
+#include <cmath> 
+#include <algorithm> 
+#include <stdexcept> 
 #include "ValueWithError.hpp"
 #include "IntegrationBound.hpp"
+#include "BatchIntegrand.hpp"
+#include "ThreadPool.hpp"
+#include "PhiloxRandom.hpp"
+#include "RunTelemetry.hpp"
+#include "PrecisionTarget.hpp"
+#include "ControlVariate.hpp"
+#include "ExecutionPolicy.hpp"
+#include "ShardRecord.hpp"
 
 // A generalized monte-carlo integration tool 
 
 ValueWithError_t<double> MontecarloIntegrate(
     const unsigned long int n_pts,                  //number of points to use in the integration 
     const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
-    std::function<bool(const double*)> fcn          //fcn to integrate. must accept (CONST) ptr to doubles.  
+    std::function<bool(const double*)> fcn,         //fcn to integrate. must accept (CONST) ptr to doubles.  
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the random stream. the same seed always gives the same result. 
+                                                    // (if none is given, a random one is drawn from std::random_device.)
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
 ); 
 
+// same as above, but the fcn is evaluated on a whole block of points at a time (see BatchIntegrand.hpp).
+ValueWithError_t<double> MontecarloIntegrate(
+    const unsigned long int n_pts,                  //number of points to use in the integration 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
+    BatchIntegrand_t fcn,                           //fcn to integrate. returns the number of points in the block inside the region. 
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the random stream (see above)
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// same as above, for a real-valued fcn (see BatchIntegrand.hpp): the integral of the fcn over the bounds, 
+// with the usual monte-carlo error (from the spread of the fcn's values). 
+ValueWithError_t<double> MontecarloIntegrate(
+    const unsigned long int n_pts,                  //number of points to use in the integration 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
+    BatchValueIntegrand_t fcn,                      //fcn to integrate. writes the value of the fcn at each point of the block. 
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the random stream (see above)
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// 'target-precision' versions of the above: rather than a fixed number of points, these keep adding rounds 
+// of points (each round split between the threads) until the error reaches the target, or max_pts points 
+// have been used (see PrecisionTarget.hpp). the number of points in each round is guessed from the error 
+// so far. the points are always the first n_pts of the random stream, so the value is the same as that 
+// of the fixed-size version with the same n_pts and seed. the error is the binomial error (for a batch 
+// integrand), or the spread of the values (for a real-valued one). 
+TargetResult_t MontecarloIntegrateToTarget(
+    const PrecisionTarget_t target,                 //error to reach, and the most points to use
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
+    BatchIntegrand_t fcn,                           //fcn to integrate. returns the number of points in the block inside the region. 
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the random stream (see above)
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+TargetResult_t MontecarloIntegrateToTarget(
+    const PrecisionTarget_t target,                 //error to reach, and the most points to use
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
+    BatchValueIntegrand_t fcn,                      //fcn to integrate. writes the value of the fcn at each point of the block. 
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the random stream (see above)
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// 'checkpoint' versions: one pass over the first checkpoints.back() points of the random stream, which gives 
+// the running result at each of the checkpoints (numbers of points, in strictly increasing order) on the way. 
+// as the stream is the same for any number of points, result k is the same as that of a fixed-size run with 
+// checkpoints[k] points and the same seed; but all of them together cost only as much as the last one. 
+std::vector<ValueWithError_t<double>> MontecarloIntegrateCheckpoints(
+    const std::vector<unsigned long int> checkpoints,   //numbers of points to give the result at (increasing)
+    const std::vector<IntegrationBound_t> bounds,       //number of dimensions is given by the number of bounds given.  
+    BatchIntegrand_t fcn,                               //fcn to integrate. returns the number of points in the block inside the region. 
+    const std::optional<uint64_t> seed=std::nullopt,    //seed of the random stream (see above)
+    const ExecutionPolicy_t& policy={}                  //threads (see ExecutionPolicy.hpp)
+); 
+
+std::vector<ValueWithError_t<double>> MontecarloIntegrateCheckpoints(
+    const std::vector<unsigned long int> checkpoints,   //numbers of points to give the result at (increasing)
+    const std::vector<IntegrationBound_t> bounds,       //number of dimensions is given by the number of bounds given.  
+    BatchValueIntegrand_t fcn,                          //fcn to integrate. writes the value of the fcn at each point of the block. 
+    const std::optional<uint64_t> seed=std::nullopt,    //seed of the random stream (see above)
+    const ExecutionPolicy_t& policy={}                  //threads (see ExecutionPolicy.hpp)
+); 
+
+// for several regions at once, which share a bounding box (see BatchMultiIntegrand_t): each point is made 
+// only once, and tested against all of them. result k is the volume of region k; it is the same as what 
+// the single-region version would give for it alone, with the same seed (and the same bounds). as the same 
+// points are used for all of them, their errors are correlated, so differences between them are smooth. 
+std::vector<ValueWithError_t<double>> MontecarloIntegrateMulti(
+    const long unsigned int n_pts,                  //number of points to use in the integration
+    const std::vector<IntegrationBound_t> bounds,   //bounding box shared by all of the regions
+    const unsigned long int n_regions,              //number of regions the fcn tests the points against
+    BatchMultiIntegrand_t fcn,                      //fcn to integrate. adds the number of points of the block inside each region to counts[k].
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the random stream (see above)
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// for a vector-valued fcn (see BatchVectorIntegrand_t): all 'n_components' outputs are integrated over the 
+// same points, in one pass. result k is the integral of output k, with its own error (as the real-valued 
+// version would give it). for example, the volume, centroid and second moments of a region all at once. 
+std::vector<ValueWithError_t<double>> MontecarloIntegrateVector(
+    const long unsigned int n_pts,                  //number of points to use in the integration
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.
+    const unsigned long int n_components,           //number of outputs of the fcn
+    BatchVectorIntegrand_t fcn,                     //fcn to integrate. writes each output of the fcn at each point of the block.
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the random stream (see above)
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// same as above, for a fcn called one point at a time: fcn(X, out) writes its outputs to out[0 ... n_components-1]
+std::vector<ValueWithError_t<double>> MontecarloIntegrateVector(
+    const long unsigned int n_pts,                  //number of points to use in the integration
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.
+    const unsigned long int n_components,           //number of outputs of the fcn
+    std::function<void(const double*, double*)> fcn,//fcn to integrate
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the random stream (see above)
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// with control variates (see ControlVariate.hpp): the references are evaluated at the same points as the 
+// fcn, and the part of the error they account for is taken out. their integrals must be over 'bounds'. 
+ValueWithError_t<double> MontecarloIntegrateControlVariates(
+    const long unsigned int n_pts,                  //number of points to use in the integration
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.
+    BatchValueIntegrand_t fcn,                      //fcn to integrate. writes the value of the fcn at each point of the block.
+    const std::vector<ControlVariate_t> controls,   //references, with their exact integrals over the bounds
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the random stream (see above)
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// one shard of a run split between several processes (see ShardRecord.hpp): shard 'i_shard' of 'n_shards' 
+// runs its own range of the points of MontecarloIntegrate(n_pts, bounds, fcn, seed), and returns the record 
+// of its partial result. MergeShardRecords(), given the records of all the shards, returns the same result 
+// as MontecarloIntegrate itself. (every shard must be given the same seed, so there is no default.)
+ShardRecord_t MontecarloIntegrateShard(
+    const unsigned int i_shard,                     //which shard this is (0 ... n_shards-1)
+    const unsigned int n_shards,                    //number of shards the run is split into
+    const unsigned long int n_pts,                  //number of points of the whole run
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
+    BatchIntegrand_t fcn,                           //fcn to integrate. returns the number of points in the block inside the region. 
+    const uint64_t seed,                            //seed of the random stream
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+ShardRecord_t MontecarloIntegrateShard(
+    const unsigned int i_shard,                     //which shard this is (0 ... n_shards-1)
+    const unsigned int n_shards,                    //number of shards the run is split into
+    const unsigned long int n_pts,                  //number of points of the whole run
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
+    BatchValueIntegrand_t fcn,                      //fcn to integrate. writes the value of the fcn at each point of the block. 
+    const uint64_t seed,                            //seed of the random stream
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// same as above, but with the dimension and the type of the fcn known at compile time, so that 
+// the fcn can be inlined, and the loops over coordinates unrolled. 'fcn' must be callable as 
+// bool(const double*), and bounds.size() must equal 'Dim'. for example: 
+//
+//  auto vol = MontecarloIntegrate<3>(1e6, bounds, [](const double* X){ return X[0]*X[0] + X[1]*X[1] + X[2]*X[2] < 1.; });
+// 
+// see DimDispatch.hpp for how to get here from a runtime dimension. 
+template<int Dim, typename F> ValueWithError_t<double> MontecarloIntegrate(
+    const unsigned long int n_pts,                  //number of points to use in the integration 
+    const std::vector<IntegrationBound_t>& bounds,  //must have exactly 'Dim' bounds
+    F&& fcn,                                        //fcn to integrate. returns TRUE if inside region, FALSE if not.
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the random stream. (the points are the same as for the other versions.)
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+)
+{
+    static_assert(Dim > 0, "in <MontecarloIntegrate<Dim>>: Dim must be positive"); 
+
+    if (bounds.size() != Dim) {
+        throw std::invalid_argument("in <MontecarloIntegrate<Dim>>: number of bounds given does not match 'Dim'."); 
+    }
+
+    //copy the bounds into a fixed-size array, so the compiler knows how many there are
+    std::array<IntegrationBound_t, Dim> bnds; 
+    for (int i=0; i<Dim; i++) bnds[i] = bounds[i]; 
+
+    const uint64_t stream_seed = Philox::ResolveSeed(seed); 
+
+    const unsigned long int n_chunks = (n_pts + kChunkSize - 1) / kChunkSize; 
+
+    std::vector<unsigned long int> chunk_counts(n_chunks, 0); 
+
+    //(as for GridIntegrate<Dim>, the fcn is inlined into the making of the points, so all of a chunk 
+    // counts as evaluating the fcn.)
+    TelemetryRecorder_t telemetry_recorder("MontecarloIntegrate<Dim>"); 
+    TelemetryRecorder_t* const telemetry = telemetry_recorder.Get(); 
+
+    ThreadPool::Global().ParallelFor(n_chunks, [&](unsigned long int i_chunk, unsigned int i_thread)
+    {
+        const double t_start = telemetry ? telemetry->Now() : 0.; 
+
+        const unsigned long int n_chunk_pts = std::min<unsigned long int>( kChunkSize, n_pts - i_chunk*kChunkSize ); 
+
+        //each chunk works with its own copy of the fcn
+        auto chunk_fcn = fcn; 
+
+        std::array<double, Dim> space_point; 
+
+        unsigned long int count=0; 
+        for (unsigned long int n=0; n<n_chunk_pts; n++) {
+
+            philox_point(stream_seed, i_chunk*kChunkSize + n, bnds, space_point.data()); 
+
+            if (chunk_fcn(space_point.data())) count++; 
+        }
+        chunk_counts[i_chunk] = count; 
+
+        if (telemetry) {
+            const double t_end = telemetry->Now(); 
+            telemetry->AddChunk(i_thread, t_start, t_end, n_chunk_pts, t_end - t_start); 
+        }
+
+    }, policy, (double)(kChunkSize * Dim)); 
+
+    unsigned long int count = 0; 
+    for (auto chunk_count : chunk_counts) count += chunk_count;
+
+    double total_vol{1.}; 
+    for (const auto& bound : bnds) total_vol *= (bound.xmax - bound.xmin);
+
+    double result = total_vol * ((double)count) / ((double)n_pts); 
+    double error  = total_vol * (std::sqrt((double)count) / ((double)n_pts)); 
+
+    return ValueWithError_t<double>{ result, error, telemetry_recorder.Finish((long int)count) }; 
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include "PhiloxRandom.hpp"
+#include "SimdLevel.hpp"
+#include <random>
+
+#ifdef INTEGRATORS_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+//_______________________________________________________________________________
+uint64_t Philox::ResolveSeed(const optional<uint64_t> seed)
+{
+    if (seed) return *seed;
+
+    random_device rd;
+    return ( ((uint64_t)rd()) << 32 ) | ((uint64_t)rd());
+}
+//_______________________________________________________________________________
+
+namespace {
+
+    //the 10 rounds of philox, for one counter. (the same as Philox::Block(), written out for the loop below.)
+    inline void philox_rounds(
+        uint32_t& c0, uint32_t& c1, uint32_t& c2, uint32_t& c3, uint32_t k0, uint32_t k1
+    )
+    {
+        for (int r=0; r<Philox::kRounds; r++) {
+
+            const uint64_t prod0 = (uint64_t)Philox::kMul0 * c0;
+            const uint64_t prod1 = (uint64_t)Philox::kMul1 * c2;
+
+            const uint32_t n0 = (uint32_t)(prod1 >> 32) ^ c1 ^ k0;
+            const uint32_t n2 = (uint32_t)(prod0 >> 32) ^ c3 ^ k1;
+            c1 = (uint32_t)prod1;
+            c3 = (uint32_t)prod0;
+            c0 = n0;
+            c2 = n2;
+
+            k0 += Philox::kWeyl0;
+            k1 += Philox::kWeyl1;
+        }
+    }
+
+    //fills coordinates x0 (and x1, if it isn't null) of points [j_start, n_pts), from the philox block
+    // with counter {first_pt + j, i_pair}. this is the reference (scalar) version.
+    void fill_pair_scalar(
+        const unsigned long int j_start, const unsigned long int n_pts, const uint64_t first_pt, const uint32_t i_pair,
+        const uint32_t key0, const uint32_t key1,
+        const double xmin0, const double dx0, double* x0,
+        const double xmin1, const double dx1, double* x1
+    )
+    {
+        for (unsigned long int j=j_start; j<n_pts; j++) {
+
+            const uint64_t i_pt = first_pt + j;
+
+            uint32_t c0 = (uint32_t)i_pt, c1 = (uint32_t)(i_pt >> 32), c2 = i_pair, c3 = 0u;
+            philox_rounds(c0, c1, c2, c3, key0, key1);
+
+            x0[j] = xmin0 + dx0*Philox::ToUniform(c0, c1);
+            if (x1) x1[j] = xmin1 + dx1*Philox::ToUniform(c2, c3);
+        }
+    }
+
+#ifdef INTEGRATORS_HAVE_X86_SIMD
+
+    //the vectorized versions keep each 32-bit word of the counter in the low half of a 64-bit lane,
+    // so that _mm*_mul_epu32 gives us the full 64-bit product of the philox multiply.
+
+    //_______________________________________________________________________________
+    __attribute__((target("avx2")))
+    void fill_pair_avx2(
+        const unsigned long int n_pts, const uint64_t first_pt, const uint32_t i_pair,
+        const uint32_t key0, const uint32_t key1,
+        const double xmin0, const double dx0, double* x0,
+        const double xmin1, const double dx1, double* x1
+    )
+    {
+        const __m256i mul0 = _mm256_set1_epi64x(Philox::kMul0);
+        const __m256i mul1 = _mm256_set1_epi64x(Philox::kMul1);
+        const __m256i lo32 = _mm256_set1_epi64x(0xFFFFFFFFll);
+        const __m256i one_exp = _mm256_set1_epi64x(0x3FF0000000000000ll);
+        const __m256d one  = _mm256_set1_pd(1.);
+
+        unsigned long int j=0;
+        for (; j+4<=n_pts; j+=4) {
+
+            const __m256i i_pt = _mm256_add_epi64(_mm256_set1_epi64x((long long)(first_pt + j)), _mm256_set_epi64x(3, 2, 1, 0));
+
+            __m256i c0 = _mm256_and_si256(i_pt, lo32);
+            __m256i c1 = _mm256_srli_epi64(i_pt, 32);
+            __m256i c2 = _mm256_set1_epi64x(i_pair);
+            __m256i c3 = _mm256_setzero_si256();
+
+            uint32_t k0 = key0, k1 = key1;
+            for (int r=0; r<Philox::kRounds; r++) {
+                const __m256i prod0 = _mm256_mul_epu32(c0, mul0);
+                const __m256i prod1 = _mm256_mul_epu32(c2, mul1);
+                const __m256i n0 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(prod1, 32), c1), _mm256_set1_epi64x(k0));
+                const __m256i n2 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(prod0, 32), c3), _mm256_set1_epi64x(k1));
+                c1 = _mm256_and_si256(prod1, lo32);
+                c3 = _mm256_and_si256(prod0, lo32);
+                c0 = n0;
+                c2 = n2;
+                k0 += Philox::kWeyl0;
+                k1 += Philox::kWeyl1;
+            }
+
+            //same as Philox::ToUniform()
+            const __m256i bits0 = _mm256_or_si256(_mm256_srli_epi64(_mm256_or_si256(_mm256_slli_epi64(c0, 32), c1), 12), one_exp);
+            const __m256d u0    = _mm256_sub_pd(_mm256_castsi256_pd(bits0), one);
+            _mm256_storeu_pd(x0 + j, _mm256_add_pd(_mm256_set1_pd(xmin0), _mm256_mul_pd(_mm256_set1_pd(dx0), u0)));
+
+            if (x1) {
+                const __m256i bits1 = _mm256_or_si256(_mm256_srli_epi64(_mm256_or_si256(_mm256_slli_epi64(c2, 32), c3), 12), one_exp);
+                const __m256d u1    = _mm256_sub_pd(_mm256_castsi256_pd(bits1), one);
+                _mm256_storeu_pd(x1 + j, _mm256_add_pd(_mm256_set1_pd(xmin1), _mm256_mul_pd(_mm256_set1_pd(dx1), u1)));
+            }
+        }
+        fill_pair_scalar(j, n_pts, first_pt, i_pair, key0, key1, xmin0, dx0, x0, xmin1, dx1, x1);
+    }
+    //_______________________________________________________________________________
+    __attribute__((target("avx512f")))
+    void fill_pair_avx512(
+        const unsigned long int n_pts, const uint64_t first_pt, const uint32_t i_pair,
+        const uint32_t key0, const uint32_t key1,
+        const double xmin0, const double dx0, double* x0,
+        const double xmin1, const double dx1, double* x1
+    )
+    {
+        const __m512i mul0 = _mm512_set1_epi64(Philox::kMul0);
+        const __m512i mul1 = _mm512_set1_epi64(Philox::kMul1);
+        const __m512i lo32 = _mm512_set1_epi64(0xFFFFFFFFll);
+        const __m512i one_exp = _mm512_set1_epi64(0x3FF0000000000000ll);
+        const __m512d one  = _mm512_set1_pd(1.);
+
+        unsigned long int j=0;
+        for (; j+8<=n_pts; j+=8) {
+
+            const __m512i i_pt = _mm512_add_epi64(_mm512_set1_epi64((long long)(first_pt + j)), _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0));
+
+            __m512i c0 = _mm512_and_si512(i_pt, lo32);
+            __m512i c1 = _mm512_srli_epi64(i_pt, 32);
+            __m512i c2 = _mm512_set1_epi64(i_pair);
+            __m512i c3 = _mm512_setzero_si512();
+
+            uint32_t k0 = key0, k1 = key1;
+            for (int r=0; r<Philox::kRounds; r++) {
+                const __m512i prod0 = _mm512_mul_epu32(c0, mul0);
+                const __m512i prod1 = _mm512_mul_epu32(c2, mul1);
+                const __m512i n0 = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(prod1, 32), c1), _mm512_set1_epi64(k0));
+                const __m512i n2 = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(prod0, 32), c3), _mm512_set1_epi64(k1));
+                c1 = _mm512_and_si512(prod1, lo32);
+                c3 = _mm512_and_si512(prod0, lo32);
+                c0 = n0;
+                c2 = n2;
+                k0 += Philox::kWeyl0;
+                k1 += Philox::kWeyl1;
+            }
+
+            const __m512i bits0 = _mm512_or_si512(_mm512_srli_epi64(_mm512_or_si512(_mm512_slli_epi64(c0, 32), c1), 12), one_exp);
+            const __m512d u0    = _mm512_sub_pd(_mm512_castsi512_pd(bits0), one);
+            _mm512_storeu_pd(x0 + j, _mm512_add_pd(_mm512_set1_pd(xmin0), _mm512_mul_pd(_mm512_set1_pd(dx0), u0)));
+
+            if (x1) {
+                const __m512i bits1 = _mm512_or_si512(_mm512_srli_epi64(_mm512_or_si512(_mm512_slli_epi64(c2, 32), c3), 12), one_exp);
+                const __m512d u1    = _mm512_sub_pd(_mm512_castsi512_pd(bits1), one);
+                _mm512_storeu_pd(x1 + j, _mm512_add_pd(_mm512_set1_pd(xmin1), _mm512_mul_pd(_mm512_set1_pd(dx1), u1)));
+            }
+        }
+        fill_pair_scalar(j, n_pts, first_pt, i_pair, key0, key1, xmin0, dx0, x0, xmin1, dx1, x1);
+    }
+    //_______________________________________________________________________________
+#endif
+}
+
+void philox_fill_block(
+    const uint64_t seed,
+    const uint64_t first_pt,
+    const unsigned long int n_pts,
+    const vector<IntegrationBound_t>& bounds,
+    double* const* X
+)
+{
+    const uint32_t key0 = (uint32_t)seed;
+    const uint32_t key1 = (uint32_t)(seed >> 32);
+
+    const SimdLevel simd_level = get_simd_level();
+
+    const int dim = (int)bounds.size();
+
+    //coordinates are made two at a time, from the same philox block. if the dimension is odd, the
+    // last coordinate just uses the first half of its block.
+    for (int i=0; i<dim; i+=2) {
+
+        const double xmin0 = bounds[i].xmin, dx0 = bounds[i].xmax - bounds[i].xmin;
+
+        const bool has_second = (i+1 < dim);
+        const double xmin1 = has_second ? bounds[i+1].xmin : 0.;
+        const double dx1   = has_second ? bounds[i+1].xmax - bounds[i+1].xmin : 0.;
+        double* x1 = has_second ? X[i+1] : nullptr;
+
+        const uint32_t i_pair = (uint32_t)(i/2);
+
+#ifdef INTEGRATORS_HAVE_X86_SIMD
+        if (simd_level == kSimdAVX512) { fill_pair_avx512(n_pts, first_pt, i_pair, key0, key1, xmin0, dx0, X[i], xmin1, dx1, x1); continue; }
+        if (simd_level == kSimdAVX2)   { fill_pair_avx2  (n_pts, first_pt, i_pair, key0, key1, xmin0, dx0, X[i], xmin1, dx1, x1); continue; }
+#endif
+        fill_pair_scalar(0, n_pts, first_pt, i_pair, key0, key1, xmin0, dx0, X[i], xmin1, dx1, x1);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#ifndef PhiloxRandom_H
+#define PhiloxRandom_H
+
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <vector>
+#include <optional>
+#include "IntegrationBound.hpp"
+
+// A counter-based random number generator (Philox4x32-10, from Salmon et al., "Parallel random
+// numbers: as easy as 1, 2, 3", SC11). Instead of carrying state from one number to the next, each
+// block of 4 random 32-bit words is a pure function of a 128-bit counter and a 64-bit key (the seed).
+//
+// We use this to give every point in a monte-carlo integration a fixed place in the random stream:
+// coordinates (2k, 2k+1) of point number 'i_pt' come from the block with counter {i_pt, k}. So any
+// chunk of points can jump straight to its place in the stream, and the points (and the result)
+// only depend on the seed, not on how the work was split between threads.
+
+namespace Philox {
+
+    constexpr uint32_t kMul0  = 0xD2511F53;
+    constexpr uint32_t kMul1  = 0xCD9E8D57;
+    constexpr uint32_t kWeyl0 = 0x9E3779B9;
+    constexpr uint32_t kWeyl1 = 0xBB67AE85;
+
+    constexpr int kRounds = 10;
+
+    //one block of 4 random words, for the given counter and key
+    inline std::array<uint32_t, 4> Block(std::array<uint32_t, 4> ctr, std::array<uint32_t, 2> key)
+    {
+        for (int r=0; r<kRounds; r++) {
+
+            const uint64_t prod0 = (uint64_t)kMul0 * ctr[0];
+            const uint64_t prod1 = (uint64_t)kMul1 * ctr[2];
+
+            ctr = {
+                (uint32_t)(prod1 >> 32) ^ ctr[1] ^ key[0],
+                (uint32_t)prod1,
+                (uint32_t)(prod0 >> 32) ^ ctr[3] ^ key[1],
+                (uint32_t)prod0
+            };
+
+            key[0] += kWeyl0;
+            key[1] += kWeyl1;
+        }
+        return ctr;
+    }
+
+    //turns the top 52 bits of a 64-bit word into a double, uniform in [0,1). this is done by putting
+    // them in the mantissa of a double in [1,2) and subtracting 1, which (unlike an integer-to-double
+    // conversion) vectorizes with plain AVX2 / AVX-512F.
+    inline double ToUniform(const uint32_t hi, const uint32_t lo)
+    {
+        const uint64_t bits = (( ( ((uint64_t)hi) << 32 ) | lo ) >> 12) | 0x3FF0000000000000ull;
+        double one_to_two;
+        std::memcpy(&one_to_two, &bits, sizeof(double));
+        return one_to_two - 1.;
+    }
+
+    //returns the seed given, or, if none was given, a fresh one from std::random_device.
+    uint64_t ResolveSeed(const std::optional<uint64_t> seed);
+}
+
+// fills 'point' with the random point number 'i_pt' of the stream 'seed', mapped onto 'bounds'.
+// point must have room for bounds.size() coordinates. (this gives exactly the same point as
+// philox_fill_block() does.)
+template<typename Bounds_t> inline void philox_point(
+    const uint64_t seed,
+    const uint64_t i_pt,
+    const Bounds_t& bounds,
+    double* point
+)
+{
+    const std::array<uint32_t, 2> key{ (uint32_t)seed, (uint32_t)(seed >> 32) };
+
+    const int dim = (int)bounds.size();
+    for (int i=0; i<dim; i+=2) {
+
+        const auto r = Philox::Block({ (uint32_t)i_pt, (uint32_t)(i_pt >> 32), (uint32_t)(i/2), 0u }, key);
+
+        point[i] = bounds[i].xmin + (bounds[i].xmax - bounds[i].xmin)*Philox::ToUniform(r[0], r[1]);
+
+        if (i+1 < dim) point[i+1] = bounds[i+1].xmin + (bounds[i+1].xmax - bounds[i+1].xmin)*Philox::ToUniform(r[2], r[3]);
+    }
+}
+
+// fills a whole (SoA) block with the random points [first_pt, first_pt + n_pts) of the stream 'seed',
+// mapped onto 'bounds': X[i][j] is the i-th coordinate of point (first_pt + j). this is vectorized
+// over the points (with AVX2 or AVX-512, if the cpu has it).
+void philox_fill_block(
+    const uint64_t seed,
+    const uint64_t first_pt,
+    const unsigned long int n_pts,
+    const std::vector<IntegrationBound_t>& bounds,
+    double* const* X
+);
+
+#endif
\ No newline at end of file
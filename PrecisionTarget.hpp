@@ -0,0 +1,43 @@
+#ifndef PrecisionTarget_H
+#define PrecisionTarget_H
+
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include "ValueWithError.hpp"
+
+// What an integrator run in 'target-precision' mode is asked for: it keeps adding points until its error
+// estimate is at most abs_error, OR at most rel_error times the value (whichever is reached first; a target
+// of 0 is ignored), or until it has used max_pts points.
+struct PrecisionTarget_t {
+    double abs_error{0.};                           //absolute error to reach (0 = none)
+    double rel_error{0.};                           //relative error to reach (0 = none)
+    unsigned long int max_pts{1ul << 32};           //the most points to use, target or not
+    unsigned long int min_pts{1ul << 16};           //the fewest points to use before the target is checked
+
+    //throws std::invalid_argument if there is no target at all
+    void Check() const
+    {
+        if (!(abs_error > 0.) && !(rel_error > 0.)) {
+            throw std::invalid_argument("in <PrecisionTarget_t>: need an absolute or a relative error to aim for.");
+        }
+    }
+
+    //the error a result with value 'val' has to reach
+    double Tolerance(const double val) const
+    {
+        double tol = 0.;
+        if (abs_error > 0.) tol = abs_error;
+        if (rel_error > 0.) tol = std::max<double>( tol, rel_error * std::fabs(val) );
+        return tol;
+    }
+};
+
+// the result of a run in target-precision mode: the value and its error, how many points it took, and
+// whether the target was actually reached (rather than running out of points).
+struct TargetResult_t : public ValueWithError_t<double> {
+    unsigned long int n_pts{0};
+    bool reached_target{false};
+};
+
+#endif
\ No newline at end of file
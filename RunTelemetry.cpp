@@ -0,0 +1,191 @@
+#include "RunTelemetry.hpp"
+#include "ThreadPool.hpp"
+#include <atomic>
+#include <mutex>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+    atomic<bool> g_enabled{false};
+
+    mutex g_log_mutex;
+    vector<shared_ptr<const RunTelemetry_t>> g_log;
+
+    //a number, or 'null' if it isn't finite (JSON has no NaN)
+    string json_number(const double x)
+    {
+        if (!isfinite(x)) return "null";
+        ostringstream oss;
+        oss.precision(6);
+        oss << x;
+        return oss.str();
+    }
+}
+
+//_______________________________________________________________________________
+void SetTelemetryEnabled(const bool enabled) { g_enabled = enabled; }
+
+bool TelemetryEnabled() { return g_enabled.load(memory_order_relaxed); }
+//_______________________________________________________________________________
+vector<shared_ptr<const RunTelemetry_t>> TakeTelemetryLog()
+{
+    lock_guard<mutex> lock(g_log_mutex);
+    vector<shared_ptr<const RunTelemetry_t>> log;
+    log.swap(g_log);
+    return log;
+}
+//_______________________________________________________________________________
+double RunTelemetry_t::EvaluateSeconds() const
+{
+    double t=0.;
+    for (const auto& thread : threads) t += thread.evaluate_s;
+    return t;
+}
+
+double RunTelemetry_t::GenerateSeconds() const
+{
+    double t=0.;
+    for (const auto& thread : threads) t += thread.busy_s - thread.evaluate_s;
+    return t;
+}
+
+double RunTelemetry_t::PointsPerSecond() const { return ((double)n_pts) / wall_s; }
+
+double RunTelemetry_t::HitRatio() const
+{
+    if (n_inside < 0 || n_pts == 0) return numeric_limits<double>::quiet_NaN();
+    return ((double)n_inside) / ((double)n_pts);
+}
+
+double RunTelemetry_t::LoadImbalance() const
+{
+    if (threads.empty()) return 0.;
+
+    double max_busy=0., sum_busy=0.;
+    for (const auto& thread : threads) { max_busy = max<double>(max_busy, thread.busy_s); sum_busy += thread.busy_s; }
+
+    return (sum_busy > 0.) ? max_busy / (sum_busy / (double)threads.size()) - 1. : 0.;
+}
+
+double RunTelemetry_t::StartOverhead() const
+{
+    if (threads.empty()) return 0.;
+
+    double sum=0.;
+    for (const auto& thread : threads) sum += thread.first_start_s;
+    return sum / (double)threads.size();
+}
+
+double RunTelemetry_t::JoinOverhead() const
+{
+    double last_end=0.;
+    for (const auto& thread : threads) last_end = max<double>(last_end, thread.last_end_s);
+    return wall_s - last_end;
+}
+//_______________________________________________________________________________
+string RunTelemetry_t::ToJson() const
+{
+    ostringstream oss;
+    oss << "{ \"integrator\": \"" << integrator << "\""
+        << ", \"wall_s\": "           << json_number(wall_s)
+        << ", \"n_pts\": "            << n_pts
+        << ", \"n_inside\": "         << (n_inside < 0 ? string("null") : to_string(n_inside))
+        << ", \"hit_ratio\": "        << json_number(HitRatio())
+        << ", \"generate_s\": "       << json_number(GenerateSeconds())
+        << ", \"evaluate_s\": "       << json_number(EvaluateSeconds())
+        << ", \"pts_per_s\": "        << json_number(PointsPerSecond())
+        << ", \"load_imbalance\": "   << json_number(LoadImbalance())
+        << ", \"start_overhead_s\": " << json_number(StartOverhead())
+        << ", \"join_overhead_s\": "  << json_number(JoinOverhead())
+        << ", \"threads\": [";
+
+    for (size_t t=0; t<threads.size(); t++) {
+        const auto& thread = threads[t];
+        oss << (t ? ", " : "")
+            << "{ \"n_pts\": "    << thread.n_pts
+            << ", \"n_chunks\": "   << thread.n_chunks
+            << ", \"busy_s\": "     << json_number(thread.busy_s)
+            << ", \"evaluate_s\": " << json_number(thread.evaluate_s)
+            << ", \"pts_per_s\": "  << json_number(((double)thread.n_pts) / thread.busy_s)
+            << " }";
+    }
+    oss << "] }";
+
+    return oss.str();
+}
+//_______________________________________________________________________________
+string TelemetryToJson(const vector<shared_ptr<const RunTelemetry_t>>& records)
+{
+    string json = "[\n";
+    for (size_t i=0; i<records.size(); i++) {
+        json += "  " + (records[i] ? records[i]->ToJson() : string("null"));
+        json += (i + 1 < records.size()) ? ",\n" : "\n";
+    }
+    return json + "]\n";
+}
+//_______________________________________________________________________________
+bool WriteTelemetryLog(const char* path)
+{
+    ofstream file(path);
+    if (!file) return false;
+
+    file << TelemetryToJson( TakeTelemetryLog() );
+    return (bool)file;
+}
+//_______________________________________________________________________________
+TelemetryRecorder_t::TelemetryRecorder_t(const char* integrator)
+    : fStart(chrono::steady_clock::now())
+{
+    if (!TelemetryEnabled()) return;
+
+    fRecord = make_shared<RunTelemetry_t>();
+    fRecord->integrator = integrator;
+    fSlots.resize( ThreadPool::Global().NumThreads() );
+}
+//_______________________________________________________________________________
+void TelemetryRecorder_t::AddChunk(
+    const unsigned int i_thread,
+    const double t_start,
+    const double t_end,
+    const unsigned long int n_pts,
+    const double t_evaluate
+)
+{
+    ThreadTelemetry_t& thread = fSlots[i_thread].thread;
+
+    if (thread.n_chunks == 0) thread.first_start_s = t_start;
+
+    thread.n_chunks++;
+    thread.n_pts      += n_pts;
+    thread.busy_s     += t_end - t_start;
+    thread.evaluate_s += t_evaluate;
+    thread.last_end_s  = max<double>(thread.last_end_s, t_end);
+}
+//_______________________________________________________________________________
+shared_ptr<const RunTelemetry_t> TelemetryRecorder_t::Finish(const long int n_inside)
+{
+    if (!fRecord) return nullptr;
+
+    fRecord->wall_s   = Now();
+    fRecord->n_inside = n_inside;
+
+    for (const auto& slot : fSlots) {
+        if (slot.thread.n_chunks == 0) continue;
+        fRecord->threads.push_back(slot.thread);
+        fRecord->n_pts += slot.thread.n_pts;
+    }
+
+    shared_ptr<const RunTelemetry_t> record = fRecord;
+    fRecord.reset();
+
+    lock_guard<mutex> lock(g_log_mutex);
+    g_log.push_back(record);
+
+    return record;
+}
\ No newline at end of file
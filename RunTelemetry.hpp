@@ -0,0 +1,109 @@
+#ifndef RunTelemetry_H
+#define RunTelemetry_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+
+// Optional instrumentation of the integrators. It is always compiled in, but off unless it is turned on
+// (SetTelemetryEnabled(true)); while it is off, all it costs is a check of one pointer per chunk of work.
+//
+// When it is on, every entry point of MontecarloIntegrate, SobolIntegrate (scrambled or not) and
+// GridIntegrate (the <Dim>, checkpoint, to-target, multi, vector, control-variate and shard versions too)
+// records, for each call: the time spent making points vs. evaluating the integrand, the points per second
+// of each thread, the fraction of points inside the region (how much of the bounding box is wasted), how
+// evenly the work was spread between the threads, and how long it took the threads to get going, and to
+// finish up. The record is handed back on the result (ValueWithError_t::telemetry; the results of a call
+// which returns several all share its record), and also kept in a log (see TakeTelemetryLog). A shard's
+// record only goes into the log.
+//
+// for example:
+//
+//  SetTelemetryEnabled(true);
+//  auto result = MontecarloIntegrate(n_pts, bounds, fcn);
+//  if (result.telemetry) cout << result.telemetry->ToJson() << endl;
+//
+
+// what one thread did during a call
+struct ThreadTelemetry_t {
+    unsigned long int n_pts{0};                     //points handled by this thread
+    unsigned long int n_chunks{0};                  //chunks of work it ran
+    double busy_s{0.};                              //time spent running chunks
+    double evaluate_s{0.};                          //time (of busy_s) spent in the integrand
+    double first_start_s{-1.};                      //when it started its first chunk (from the start of the call)
+    double last_end_s{0.};                          //when it finished its last chunk
+};
+
+// the record of a single integrator call
+struct RunTelemetry_t {
+    std::string integrator;                         //name of the integrator
+    double wall_s{0.};                              //time the whole call took
+    unsigned long int n_pts{0};                     //total number of points used
+    long int n_inside{-1};                          //number of those inside the region (-1 if the integrand doesn't count them)
+    std::vector<ThreadTelemetry_t> threads;         //each thread which took part
+
+    double EvaluateSeconds() const;                 //time spent in the integrand, summed over threads
+    double GenerateSeconds() const;                 //time spent on everything else (making the points), summed over threads
+    double PointsPerSecond() const;                 //points per (wall-clock) second
+    double HitRatio() const;                        //fraction of the points inside the region (NaN if not known)
+    double LoadImbalance() const;                   //(largest busy time of a thread) / (mean busy time) - 1
+    double StartOverhead() const;                   //mean time it took a thread to start its first chunk
+    double JoinOverhead() const;                    //time from the last chunk finishing, to the end of the call
+
+    std::string ToJson() const;
+};
+
+// turns the instrumentation on or off (for all threads). off by default.
+void SetTelemetryEnabled(const bool enabled);
+bool TelemetryEnabled();
+
+// returns (and clears) the records of all calls made while the instrumentation was on
+std::vector<std::shared_ptr<const RunTelemetry_t>> TakeTelemetryLog();
+
+// a list of records, as a JSON array
+std::string TelemetryToJson(const std::vector<std::shared_ptr<const RunTelemetry_t>>& records);
+
+// takes the log (see above), and writes it to a file as JSON. returns false if the file can't be written.
+bool WriteTelemetryLog(const char* path);
+
+// the executables turn the instrumentation on if this environment variable is set, and write the log to
+// the file it names when they're done. for example: INTEGRATORS_TELEMETRY=run.json ./ndcrescent 10 1e7
+constexpr const char* kTelemetryEnvVar = "INTEGRATORS_TELEMETRY";
+
+// what the integrators use to fill in a record. Get() is nullptr if the instrumentation is off, so the
+// integrators just pass the pointer along, and only do any timing if it isn't null.
+class TelemetryRecorder_t {
+public:
+
+    explicit TelemetryRecorder_t(const char* integrator);
+
+    TelemetryRecorder_t* Get() { return fRecord ? this : nullptr; }
+
+    //seconds since the recorder was made
+    double Now() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - fStart).count(); }
+
+    //one chunk of work, run by thread 'i_thread' (of the pool) from t_start to t_end, which handled n_pts
+    // points, and spent t_evaluate of its time in the integrand. each thread only ever touches its own entry.
+    void AddChunk(
+        const unsigned int i_thread,
+        const double t_start,
+        const double t_end,
+        const unsigned long int n_pts,
+        const double t_evaluate
+    );
+
+    //finishes the record, adds it to the log, and returns it (nullptr if the instrumentation is off)
+    std::shared_ptr<const RunTelemetry_t> Finish(const long int n_inside=-1);
+
+private:
+
+    //(each thread's entry is on its own cache line)
+    struct alignas(64) Slot_t { ThreadTelemetry_t thread; };
+
+    std::chrono::steady_clock::time_point fStart;
+    std::shared_ptr<RunTelemetry_t> fRecord;
+    std::vector<Slot_t> fSlots;
+};
+
+#endif
\ No newline at end of file
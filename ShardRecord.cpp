@@ -0,0 +1,232 @@
+#include "ShardRecord.hpp"
+#include <map>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+    //a double, in hex (%a), so that it reads back exactly
+    string hex_double(const double x)
+    {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%a", x);
+        return buf;
+    }
+
+    //splits 'str' at each 'sep' (an empty string gives no pieces)
+    vector<string> split(const string& str, const char sep)
+    {
+        vector<string> pieces;
+        if (str.empty()) return pieces;
+
+        size_t start=0;
+        for (size_t pos = str.find(sep); pos != string::npos; pos = str.find(sep, start)) {
+            pieces.push_back(str.substr(start, pos - start));
+            start = pos + 1;
+        }
+        pieces.push_back(str.substr(start));
+        return pieces;
+    }
+
+    void bad_record(const string& why)
+    {
+        throw invalid_argument("in <ShardRecord_t::FromString>: " + why);
+    }
+
+    double parse_double(const string& str)
+    {
+        char* end=nullptr;
+        const double x = strtod(str.c_str(), &end);
+        if (str.empty() || *end != '\0') bad_record("'" + str + "' isn't a number.");
+        return x;
+    }
+
+    unsigned long long parse_unsigned(const string& str)
+    {
+        char* end=nullptr;
+        const unsigned long long x = strtoull(str.c_str(), &end, 10);
+        if (str.empty() || *end != '\0' || str[0] == '-') bad_record("'" + str + "' isn't a non-negative integer.");
+        return x;
+    }
+}
+
+//_______________________________________________________________________________
+void shard_point_range(
+    const unsigned int i_shard,
+    const unsigned int n_shards,
+    const unsigned long int n_pts,
+    unsigned long int& first,
+    unsigned long int& end
+)
+{
+    if (n_shards == 0 || i_shard >= n_shards) {
+        throw invalid_argument("in <shard_point_range>: shard "+to_string(i_shard)+" of "+to_string(n_shards)+" doesn't exist.");
+    }
+
+    const unsigned long int n_chunks = (n_pts + kChunkSize - 1) / kChunkSize;
+
+    first = min<unsigned long int>( n_pts, ((n_chunks * i_shard)     / n_shards) * kChunkSize );
+    end   = min<unsigned long int>( n_pts, ((n_chunks * (i_shard+1)) / n_shards) * kChunkSize );
+}
+//_______________________________________________________________________________
+string ShardRecord_t::ToString() const
+{
+    ostringstream oss;
+    oss << "shard integrator=" << integrator
+        << " seed="   << seed
+        << " n_pts="  << n_pts
+        << " first="  << first
+        << " end="    << end
+        << " bounds=";
+    for (size_t i=0; i<bounds.size(); i++) oss << (i ? "," : "") << hex_double(bounds[i].xmin) << ":" << hex_double(bounds[i].xmax);
+
+    if (counting) {
+        oss << " fcn=count count=" << count;
+    } else {
+        oss << " fcn=value stats=";
+        for (size_t i=0; i<chunk_stats.size(); i++) {
+            const auto& s = chunk_stats[i];
+            oss << (i ? ";" : "") << s.n << ":" << hex_double(s.mean) << ":" << hex_double(s.mean_c)
+                                         << ":" << hex_double(s.m2)   << ":" << hex_double(s.m2_c);
+        }
+    }
+    return oss.str();
+}
+//_______________________________________________________________________________
+ShardRecord_t ShardRecord_t::FromString(const std::string& line)
+{
+    istringstream iss(line);
+    string word;
+    if (!(iss >> word) || word != "shard") bad_record("not a shard record.");
+
+    map<string, string> fields;
+    while (iss >> word) {
+        const size_t eq = word.find('=');
+        if (eq == string::npos) bad_record("'" + word + "' isn't a 'key=value' pair.");
+        fields[word.substr(0, eq)] = word.substr(eq + 1);
+    }
+    for (const char* key : {"integrator", "seed", "n_pts", "first", "end", "bounds", "fcn"}) {
+        if (!fields.count(key)) bad_record("'" + string(key) + "' is missing.");
+    }
+
+    ShardRecord_t record;
+    record.integrator = fields["integrator"];
+    record.seed       = parse_unsigned(fields["seed"]);
+    record.n_pts      = parse_unsigned(fields["n_pts"]);
+    record.first      = parse_unsigned(fields["first"]);
+    record.end        = parse_unsigned(fields["end"]);
+
+    for (const string& bound : split(fields["bounds"], ',')) {
+        const auto limits = split(bound, ':');
+        if (limits.size() != 2) bad_record("'" + bound + "' isn't a bound (xmin:xmax).");
+        record.bounds.push_back({ parse_double(limits[0]), parse_double(limits[1]) });
+    }
+
+    if (fields["fcn"] == "count") {
+        if (!fields.count("count")) bad_record("'count' is missing.");
+        record.counting = true;
+        record.count    = parse_unsigned(fields["count"]);
+    } else if (fields["fcn"] == "value") {
+        if (!fields.count("stats")) bad_record("'stats' is missing.");
+        record.counting = false;
+        for (const string& chunk : split(fields["stats"], ';')) {
+            const auto s = split(chunk, ':');
+            if (s.size() != 5) bad_record("'" + chunk + "' isn't a chunk's stats (n:mean:mean_c:m2:m2_c).");
+            RunningStats_t stats;
+            stats.n      = parse_unsigned(s[0]);
+            stats.mean   = parse_double(s[1]);
+            stats.mean_c = parse_double(s[2]);
+            stats.m2     = parse_double(s[3]);
+            stats.m2_c   = parse_double(s[4]);
+            record.chunk_stats.push_back(stats);
+        }
+    } else {
+        bad_record("unknown fcn type '" + fields["fcn"] + "' (expected count, or value).");
+    }
+
+    if (record.first > record.end || record.end > record.n_pts) bad_record("the range of points is invalid.");
+
+    return record;
+}
+//_______________________________________________________________________________
+void WriteShardRecord(std::ostream& out, const ShardRecord_t& record)
+{
+    out << record.ToString() << "\n" << flush;
+}
+
+vector<ShardRecord_t> ReadShardRecords(std::istream& in)
+{
+    vector<ShardRecord_t> records;
+    string line;
+    while (getline(in, line)) {
+        if (line.find_first_not_of(" \t\r") == string::npos) continue;
+        records.push_back( ShardRecord_t::FromString(line) );
+    }
+    return records;
+}
+//_______________________________________________________________________________
+ValueWithError_t<double> MergeShardRecords(std::vector<ShardRecord_t> records)
+{
+    if (records.empty()) throw invalid_argument("in <MergeShardRecords>: no records to merge.");
+
+    const ShardRecord_t& front = records.front();
+
+    auto same_bounds = [](const vector<IntegrationBound_t>& a, const vector<IntegrationBound_t>& b)
+    {
+        if (a.size() != b.size()) return false;
+        for (size_t i=0; i<a.size(); i++) if (a[i].xmin != b[i].xmin || a[i].xmax != b[i].xmax) return false;
+        return true;
+    };
+    for (const auto& record : records) {
+        if (record.integrator != front.integrator || record.seed != front.seed || record.n_pts != front.n_pts ||
+            record.counting != front.counting || !same_bounds(record.bounds, front.bounds)) {
+            throw invalid_argument("in <MergeShardRecords>: the records aren't all from the same integration.");
+        }
+    }
+
+    //the shards' ranges must tile [0, n_pts), with no gaps or overlaps
+    sort(records.begin(), records.end(), [](const ShardRecord_t& a, const ShardRecord_t& b)
+    {
+        return (a.first != b.first) ? a.first < b.first : a.end < b.end;
+    });
+
+    unsigned long int covered=0;
+    for (const auto& record : records) {
+        if (record.first != covered) {
+            throw invalid_argument("in <MergeShardRecords>: points ["+to_string(min(covered, record.first))+", "
+                +to_string(max(covered, record.first))+") are "+(record.first > covered ? "missing." : "in more than one shard."));
+        }
+        covered = record.end;
+    }
+    if (covered != front.n_pts) {
+        throw invalid_argument("in <MergeShardRecords>: points ["+to_string(covered)+", "+to_string(front.n_pts)+") are missing.");
+    }
+
+    double total_vol{1.};
+    for (auto bound : front.bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    //(this is the same arithmetic as the integrators' own, so the result is identical to theirs)
+    if (front.counting) {
+        unsigned long int count=0;
+        for (const auto& record : records) count += record.count;
+
+        const double result = (front.integrator == "SobolIntegrate")
+            ? total_vol * (((double)count) / ((double)front.n_pts))
+            : total_vol * ((double)count) / ((double)front.n_pts);
+        const double error  = total_vol * (sqrt((double)count) / ((double)front.n_pts));
+
+        return ValueWithError_t<double>{ result, error };
+    }
+
+    RunningStats_t stats;
+    for (const auto& record : records) {
+        for (const auto& chunk : record.chunk_stats) stats.Add(chunk);
+    }
+    return stats.Estimate(total_vol);
+}
@@ -0,0 +1,60 @@
+#ifndef ShardRecord_H
+#define ShardRecord_H
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <cstdint>
+#include "ValueWithError.hpp"
+#include "IntegrationBound.hpp"
+#include "BatchIntegrand.hpp"
+
+// Splitting one integration between several processes: each 'shard' runs its own contiguous range of the
+// points (a whole number of chunks, the same chunks a single process would have run), and hands back a
+// small record of its partial result, which can be written out as one line of text (to a file, or a pipe),
+// and read back. the records of all the shards are then merged into the result of the whole integration,
+// which is exactly the one a single process would have given (the chunks are merged in the same order).
+//
+// for example, with MontecarloIntegrateShard (see MontecarloIntegrate.hpp):
+//
+//  worker i of n:  WriteShardRecord(cout, MontecarloIntegrateShard(i, n, n_pts, bounds, fcn, seed));
+//  coordinator:    auto result = MergeShardRecords( ReadShardRecords(cin) );
+//
+
+struct ShardRecord_t {
+    std::string integrator;                         //"MontecarloIntegrate" or "SobolIntegrate"
+    uint64_t seed{0};                               //seed of the random stream (MontecarloIntegrate only)
+    std::vector<IntegrationBound_t> bounds;         //bounds of the whole integration
+    unsigned long int n_pts{0};                     //number of points of the whole integration
+    unsigned long int first{0}, end{0};             //this shard's points are [first, end)
+    bool counting{true};                            //TRUE if the fcn counts points inside a region, FALSE if it's real-valued
+    unsigned long int count{0};                     //(counting) number of this shard's points inside the region
+    std::vector<RunningStats_t> chunk_stats;        //(real-valued) stats of each of this shard's chunks, in order
+
+    //the record as a single line of text (the doubles are written in hex, so they read back exactly)
+    std::string ToString() const;
+
+    //reads back a line written by ToString(). throws invalid_argument if it isn't one.
+    static ShardRecord_t FromString(const std::string& line);
+};
+
+// the points [first, end) of shard 'i_shard' of 'n_shards': the chunks of [0, n_pts) are split as evenly as
+// possible between the shards (so if there are more shards than chunks, some of them get none).
+void shard_point_range(
+    const unsigned int i_shard,
+    const unsigned int n_shards,
+    const unsigned long int n_pts,
+    unsigned long int& first,
+    unsigned long int& end
+);
+
+// writes a record as one line, and reads back all the records (one per non-empty line) from a stream
+void WriteShardRecord(std::ostream& out, const ShardRecord_t& record);
+std::vector<ShardRecord_t> ReadShardRecords(std::istream& in);
+
+// merges the records of all the shards of one integration into its result. throws invalid_argument if they
+// aren't all from the same integration, or don't cover each of its points exactly once.
+ValueWithError_t<double> MergeShardRecords(std::vector<ShardRecord_t> records);
+
+#endif
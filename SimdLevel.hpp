@@ -0,0 +1,53 @@
+#ifndef SimdLevel_H
+#define SimdLevel_H
+
+#include <atomic>
+
+// The widest vector instruction set which this cpu supports (and which we have kernels for).
+// The kernels are compiled with per-function 'target' attributes, so the binary itself does
+// not need to be built with -mavx2 / -mavx512f; we just pick the right kernel at runtime.
+enum SimdLevel {
+    kSimdScalar     = 0,
+    kSimdAVX2       = 1,
+    kSimdAVX512     = 2
+};
+
+// x86-64 with gcc or clang is the only place we have vectorized kernels
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define INTEGRATORS_HAVE_X86_SIMD 1
+#endif
+
+// the widest level the cpu supports (this is only detected once, the first time its asked for)
+inline SimdLevel detect_simd_level()
+{
+#ifdef INTEGRATORS_HAVE_X86_SIMD
+    static const SimdLevel level = []{
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return kSimdAVX512;
+        if (__builtin_cpu_supports("avx2"))    return kSimdAVX2;
+        return kSimdScalar;
+    }();
+    return level;
+#else
+    return kSimdScalar;
+#endif
+}
+
+// the widest level the kernels are allowed to use (by default, all of them). this is meant for testing:
+// lowering it makes the kernels fall back to the narrower ones, so they can be checked against each other.
+inline std::atomic<int>& simd_level_limit()
+{
+    static std::atomic<int> limit{kSimdAVX512};
+    return limit;
+}
+
+inline void set_simd_level_limit(const SimdLevel level) { simd_level_limit() = level; }
+
+// the level the kernels run at: the widest one the cpu supports, within the limit above
+inline SimdLevel get_simd_level()
+{
+    const SimdLevel limit = (SimdLevel)simd_level_limit().load(std::memory_order_relaxed);
+    return detect_simd_level() < limit ? detect_simd_level() : limit;
+}
+
+#endif
\ No newline at end of file
@@ -2,64 +2,162 @@
 #include <random> 
 #include <chrono> 
 #include <iostream> 
-#include <thread>
-#include <Math/QuasiRandom.h>
-#include <chrono>
-#include <random> 
+#include "ThreadPool.hpp"
+#include "SobolSequence.hpp"
+#include "PhiloxRandom.hpp"
+#include "RunTelemetry.hpp"
+#include <algorithm> 
+#include <cmath> 
+#include <stdexcept> 
+#include <string> 
 
 using namespace std; 
-using QRS = ROOT::Math::QuasiRandomSobol; 
 
 // A generalized monte-carlo integration tool 
 
-//this is kinda a hacky way to do this, but its how we can have our 
-// generators skip an aribtrary number of 'pairs' in the sequence each time, 
-// without waisting any. 
-static std::map<int, std::unique_ptr<ROOT::Math::QuasiRandomSobol>> sobol_generators{}; 
-
 
 ValueWithError_t<double> SobolIntegrate(
     const unsigned long int n_pts,                  //number of points to use in the integration. 
                                                     // for example, if you choose npts=100 and dim=5, then total points is 100^5. 
     const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
-    std::function<bool(const double*)> fcn          //fcn to integrate. must accept (CONST) ptr to doubles. returns TRUE if inside region, FALSE if not.               
+    std::function<bool(const double*)> fcn,         //fcn to integrate. must accept (CONST) ptr to doubles. returns TRUE if inside region, FALSE if not.               
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
 )
-{ 
-    //dimension of the space we're integrating in 
-    const int dim = (int)bounds.size(); 
+{
+    return SobolIntegrate(n_pts, bounds, make_batch_integrand((int)bounds.size(), fcn), policy); 
+}
 
-    //look to see if a sobol generator of this dimension already exists 
-    auto it = sobol_generators.find(dim); 
+namespace {
 
-    QRS* sobol = nullptr; 
+    //the scramble seed of replica number 'i_replica'
+    uint64_t replica_seed(const uint64_t seed, const unsigned long int i_replica)
+    {
+        const auto r = Philox::Block({ (uint32_t)i_replica, (uint32_t)(i_replica >> 32), 0u, 0u }, { (uint32_t)seed, (uint32_t)(seed >> 32) }); 
+        return ( ((uint64_t)r[0]) << 32 ) | r[1]; 
+    }
 
-    if (it == sobol_generators.end()) {
-        //we need to make a new one; none exists yet 
-        sobol_generators[dim] = unique_ptr<QRS>(
-            new QRS(dim)
-        ); 
-        
-        sobol = sobol_generators[dim].get(); 
-    } else {
-        //one already exists; let's use it    
-        sobol = it->second.get(); 
-    }   
+    //walks through the points [first, ends.back()) of the sobol sequence, a block at a time, and hands each 
+    // block to 'on_block(tally, n_block, X)', which adds it to the tally of its segment. segment i is the 
+    // points [ends[i-1], ends[i]) (the first starts at 'first'), and should be at most kChunkSize long. 
+    // returns the tally of each segment. 
+    //
+    // if a scramble seed is given, this is done for 'n_replicas' independently scrambled copies of the 
+    // sequence, and the tallies of replica r are [r*n_segments, (r+1)*n_segments) of what is returned. 
+    // (if 'telemetry' isn't null, the time each segment takes is recorded.)
+    template<typename Tally_t, typename OnBlock> vector<Tally_t> sobol_segments(
+        const unsigned long int first, 
+        const vector<unsigned long int>& ends, 
+        const vector<IntegrationBound_t>& bounds, 
+        const ExecutionPolicy_t& policy, 
+        const OnBlock& on_block, 
+        const unsigned int n_replicas=1, 
+        const optional<uint64_t> scramble_seed=nullopt, 
+        TelemetryRecorder_t* telemetry=nullptr
+    )
+    {
+        //dimension of the space we're integrating in 
+        const int dim = (int)bounds.size(); 
 
+        if (!ends.empty() && ends.back() > SobolSequence::kMaxPoints) {
+            throw invalid_argument("in <SobolIntegrate>: can't use more than 2^"+to_string(SobolSequence::kBits)+" points of the sobol sequence.");
+        }
 
+        //each segment of points is a contiguous block of the sobol sequence, which its thread makes on its
+        // own (by skipping straight to the start of the block). so the points, and the result, are the
+        // same no matter how many threads are used.
+        auto& pool = ThreadPool::Global(); 
 
-    //create an array of ints, which represents the 'point' in space we're using. 
-    vector<double> point(dim, 0.);
+        const unsigned long int n_segments = ends.size(); 
 
-    unsigned long long count =0; 
-    
-    for (unsigned long int i=0; i<n_pts; i++) {
+        vector<Tally_t> segment_tallies(n_segments * n_replicas); 
+
+        pool.ParallelFor(n_segments * n_replicas, [&](unsigned long int i_task, unsigned int i_thread)
+        {
+            const double t_start = telemetry ? telemetry->Now() : 0.; 
+            double t_evaluate = 0.; 
+
+            const unsigned long int i_replica = i_task / n_segments; 
+            const unsigned long int i_segment = i_task % n_segments; 
+
+            const unsigned long int segment_first = (i_segment == 0) ? first : ends[i_segment-1]; 
+            const unsigned long int n_segment     = ends[i_segment] - segment_first; 
+
+            //(every segment of a replica makes the same scrambling from the replica's own seed)
+            SobolSequence sobol = scramble_seed ? SobolSequence(dim, replica_seed(*scramble_seed, i_replica)) : SobolSequence(dim); 
+            sobol.Seek(segment_first); 
+
+            //(the tally is kept here, and only written back at the end, to keep the threads off each other's cache lines)
+            OnBlock segment_on_block = on_block; 
+            Tally_t tally{}; 
+
+            //points of this batch, mapped onto our bounds (SoA): block[i*kBatchSize + j] is the i-th coordinate of point j.
+            vector<double> block(dim * kBatchSize); 
+            vector<double*> X(dim); 
+            for (int i=0; i<dim; i++) X[i] = block.data() + i*kBatchSize; 
+
+            for (unsigned long int j_batch=0; j_batch<n_segment; j_batch += kBatchSize) {
 
-        sobol->Next(point.data()); 
+                const unsigned long int n_batch = min<unsigned long int>( kBatchSize, n_segment - j_batch ); 
 
-        //check the fcn at our current Sobol point
-        if (fcn(point.data())) count++;    
+                sobol.NextBlock(n_batch, bounds, X.data()); 
+                
+                if (telemetry) {
+                    const double t = telemetry->Now(); 
+                    segment_on_block(tally, n_batch, X.data()); 
+                    t_evaluate += telemetry->Now() - t; 
+                } else {
+                    segment_on_block(tally, n_batch, X.data()); 
+                }
+            }
+            segment_tallies[i_task] = move(tally); 
+
+            if (telemetry) telemetry->AddChunk(i_thread, t_start, telemetry->Now(), n_segment, t_evaluate); 
+
+        }, policy, (double)(kChunkSize * dim)); 
+
+        return segment_tallies; 
     }
 
+    //the same, for the points [0, n_pts), split into chunks of (at most) kChunkSize points each. (so with 
+    // replicas, the tallies of replica r are chunks [r*n_chunks, (r+1)*n_chunks) of what is returned.)
+    template<typename Tally_t, typename OnBlock> vector<Tally_t> sobol_blocks(
+        const unsigned long int n_pts, 
+        const vector<IntegrationBound_t>& bounds, 
+        const ExecutionPolicy_t& policy, 
+        const OnBlock& on_block, 
+        const unsigned int n_replicas=1, 
+        const optional<uint64_t> scramble_seed=nullopt, 
+        TelemetryRecorder_t* telemetry=nullptr
+    )
+    {
+        if (n_pts > SobolSequence::kMaxPoints) {
+            throw invalid_argument("in <SobolIntegrate>: can't use more than 2^"+to_string(SobolSequence::kBits)+" points of the sobol sequence.");
+        }
+
+        vector<unsigned long int> ends; 
+        for (unsigned long int first=0; first < n_pts; first += kChunkSize) ends.push_back( min<unsigned long int>( n_pts, first + kChunkSize ) ); 
+
+        return sobol_segments<Tally_t>(0, ends, bounds, policy, on_block, n_replicas, scramble_seed, telemetry); 
+    }
+}
+
+ValueWithError_t<double> SobolIntegrate(
+    const unsigned long int n_pts,                  //number of points to use in the integration. 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    BatchIntegrand_t fcn,                           //fcn to integrate, a whole (SoA) block of points at a time. returns the number inside the region.               
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{ 
+    auto count_block = [fcn](unsigned long int& count, const unsigned long int n_batch, double* const* X)
+    {
+        count += fcn(n_batch, X); 
+    }; 
+    TelemetryRecorder_t telemetry("SobolIntegrate"); 
+    const auto chunk_counts = sobol_blocks<unsigned long int>(n_pts, bounds, policy, count_block, 1, nullopt, telemetry.Get()); 
+
+    unsigned long long count =0; 
+    for (auto chunk_count : chunk_counts) count += chunk_count; 
+
     //compute the volume of our 'box' we're integrating in 
     double total_vol{1.}; 
     for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
@@ -68,6 +166,565 @@ ValueWithError_t<double> SobolIntegrate(
     //very rudimentary error estimate
     double error  = total_vol * (sqrt((double)count) / ((double)n_pts)); 
 
-    return ValueWithError_t<double>{ result, error }; 
+    return ValueWithError_t<double>{ result, error, telemetry.Finish((long int)count) }; 
+}
+
+ValueWithError_t<double> SobolIntegrate(
+    const unsigned long int n_pts,                  //number of points to use in the integration. 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    BatchValueIntegrand_t fcn,                      //real-valued fcn to integrate, a whole (SoA) block of points at a time
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{ 
+    auto stats_block = [fcn, f = vector<double>(kBatchSize)](RunningStats_t& stats, const unsigned long int n_batch, double* const* X) mutable
+    {
+        fcn(n_batch, X, f.data()); 
+        stats.Add(n_batch, f.data()); 
+    }; 
+    TelemetryRecorder_t telemetry("SobolIntegrate"); 
+    const auto chunk_stats = sobol_blocks<RunningStats_t>(n_pts, bounds, policy, stats_block, 1, nullopt, telemetry.Get()); 
+
+    RunningStats_t stats; 
+    for (const auto& chunk : chunk_stats) stats.Add(chunk); 
+
+    double total_vol{1.}; 
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    //(this is the error the same number of pseudo-random points would have; the real error is usually smaller.)
+    auto result = stats.Estimate(total_vol); 
+    result.telemetry = telemetry.Finish(); 
+    return result; 
+}
+
+namespace {
+
+    void add_tally(unsigned long int& total, const unsigned long int segment) { total += segment; }
+    void add_tally(RunningStats_t& total, const RunningStats_t& segment)      { total.Add(segment); }
+
+    //the number of points inside the region, for the telemetry (-1 if the fcn doesn't count them)
+    long int tally_hits(const unsigned long int count) { return (long int)count; }
+    long int tally_hits(const RunningStats_t&)         { return -1; }
+
+    //mean, and standard error of the mean, of the estimates of the replicas
+    ValueWithError_t<double> combine_replicas(const vector<double>& estimates)
+    {
+        const double K = (double)estimates.size(); 
+
+        double mean=0.; 
+        for (double e : estimates) mean += e; 
+        mean /= K; 
+
+        double var=0.; 
+        for (double e : estimates) var += (e - mean)*(e - mean); 
+        var /= (K - 1.); 
+
+        return ValueWithError_t<double>{ mean, sqrt( var / K ) }; 
+    }
+
+    void check_replicas(const unsigned long int n_pts, const unsigned int n_replicas)
+    {
+        if (n_replicas < 2) {
+            throw invalid_argument("in <ScrambledSobolIntegrate>: need at least 2 replicas to estimate the error."); 
+        }
+        if (n_pts < n_replicas) {
+            throw invalid_argument("in <ScrambledSobolIntegrate>: need at least one point per replica."); 
+        }
+        //(every replica must get the same number of points, and we don't want to drop any without saying so)
+        if (n_pts % n_replicas != 0) {
+            throw invalid_argument("in <ScrambledSobolIntegrate>: n_pts ("+to_string(n_pts)+") must be a multiple of n_replicas ("
+                +to_string(n_replicas)+"), for example "+to_string(n_pts - n_pts % n_replicas)+"."); 
+        }
+    }
+
+    //runs every replica in rounds, until the spread of their estimates ('estimate(tally, n)' gives the estimate 
+    // of one replica from its tally of n points) reaches the target. each round carries on from where the last 
+    // one left off, in every replica, so each replica always uses the first n_used points of its own sequence, 
+    // no matter how many rounds it took to get there. (all the rounds go into the one record of 'telemetry', 
+    // which is finished, and handed back on the result.)
+    template<typename Tally_t, typename OnBlock, typename Estimate> TargetResult_t scrambled_sobol_to_target(
+        const PrecisionTarget_t& target, 
+        const vector<IntegrationBound_t>& bounds, 
+        const unsigned int n_replicas, 
+        const uint64_t scramble_seed, 
+        const ExecutionPolicy_t& policy, 
+        const OnBlock& on_block, 
+        const Estimate& estimate, 
+        TelemetryRecorder_t& telemetry
+    )
+    {
+        target.Check(); 
+
+        if (n_replicas < 2) {
+            throw invalid_argument("in <ScrambledSobolIntegrateToTarget>: need at least 2 replicas to estimate the error."); 
+        }
+
+        //(the limits are in points per replica)
+        const unsigned long int max_per_replica = min<unsigned long int>( SobolSequence::kMaxPoints, max<unsigned long int>( 1, target.max_pts / n_replicas ) ); 
+
+        //every round ends on a whole chunk (unless it runs into max_pts), so the next one can start at a chunk
+        auto round_end = [max_per_replica](const double n)
+        {
+            const double n_chunks = ceil( n / ((double)kChunkSize) ); 
+            return (unsigned long int)min<double>( (double)max_per_replica, n_chunks * (double)kChunkSize ); 
+        }; 
+
+        vector<Tally_t> totals(n_replicas); 
+        unsigned long int n_used=0; 
+        unsigned long int n_end = round_end( (double)max<unsigned long int>(1, target.min_pts / n_replicas) ); 
+
+        while (true) {
+
+            vector<unsigned long int> ends; 
+            for (unsigned long int first=n_used; first < n_end; first += kChunkSize) ends.push_back( min<unsigned long int>( n_end, first + kChunkSize ) ); 
+
+            const auto segment_tallies = sobol_segments<Tally_t>(n_used, ends, bounds, policy, on_block, n_replicas, scramble_seed, telemetry.Get()); 
+            for (unsigned int r=0; r<n_replicas; r++) {
+                for (unsigned long int i=0; i<ends.size(); i++) add_tally(totals[r], segment_tallies[r*ends.size() + i]); 
+            }
+            n_used = n_end; 
+
+            vector<double> estimates; 
+            for (const auto& total : totals) estimates.push_back( estimate(total, n_used) ); 
+
+            const ValueWithError_t<double> result = combine_replicas(estimates); 
+            const double tol = target.Tolerance(result.val); 
+
+            TargetResult_t target_result; 
+            target_result.val            = result.val; 
+            target_result.error          = result.error; 
+            target_result.n_pts          = n_used * n_replicas; 
+            target_result.reached_target = (tol > 0. && result.error <= tol); 
+
+            if (target_result.reached_target || n_used >= max_per_replica) {
+                Tally_t total{}; 
+                for (const auto& replica_total : totals) add_tally(total, replica_total); 
+                target_result.telemetry = telemetry.Finish(tally_hits(total)); 
+                return target_result; 
+            }
+
+            //quasi-random points usually do better than the 1/sqrt(n) of random ones, so guess how many points it 
+            // will take from an error which goes as 1/n. (if it doesn't do that well, this just takes more rounds.) 
+            // as with random points, don't more than quadruple the points in one round. 
+            const double n_guess = (tol > 0.) ? 1.2 * ((double)n_used) * (result.error/tol) : 4.*((double)n_used); 
+
+            n_end = round_end( min<double>( max<double>( n_guess, (double)(n_used + kChunkSize) ), 4.*((double)n_used) ) ); 
+        }
+    }
+}
+
+ValueWithError_t<double> ScrambledSobolIntegrate(
+    const unsigned long int n_pts,                  //total number of points to use (a multiple of n_replicas), split evenly between the replicas
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    std::function<bool(const double*)> fcn,         //fcn to integrate. returns TRUE if inside region, FALSE if not.               
+    const unsigned int n_replicas,                  //number of independently scrambled copies of the sequence
+    const std::optional<uint64_t> seed,             //seed of the scrambling (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    return ScrambledSobolIntegrate(n_pts, bounds, make_batch_integrand((int)bounds.size(), fcn), n_replicas, seed, policy); 
 }
 
+ValueWithError_t<double> ScrambledSobolIntegrate(
+    const unsigned long int n_pts,                  //total number of points to use (a multiple of n_replicas), split evenly between the replicas
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    BatchIntegrand_t fcn,                           //fcn to integrate, a whole (SoA) block of points at a time. returns the number inside the region.               
+    const unsigned int n_replicas,                  //number of independently scrambled copies of the sequence
+    const std::optional<uint64_t> seed,             //seed of the scrambling (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    check_replicas(n_pts, n_replicas); 
+
+    const unsigned long int n_per_replica = n_pts / n_replicas; 
+    const unsigned long int n_chunks      = (n_per_replica + kChunkSize - 1) / kChunkSize; 
+
+    auto count_block = [fcn](unsigned long int& count, const unsigned long int n_batch, double* const* X)
+    {
+        count += fcn(n_batch, X); 
+    }; 
+    TelemetryRecorder_t telemetry("ScrambledSobolIntegrate"); 
+    const auto chunk_counts = sobol_blocks<unsigned long int>(n_per_replica, bounds, policy, count_block, n_replicas, Philox::ResolveSeed(seed), telemetry.Get()); 
+
+    double total_vol{1.}; 
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    vector<double> estimates(n_replicas); 
+    unsigned long int total_count=0; 
+    for (unsigned int r=0; r<n_replicas; r++) {
+
+        unsigned long int count=0; 
+        for (unsigned long int c=0; c<n_chunks; c++) count += chunk_counts[r*n_chunks + c]; 
+
+        estimates[r] = total_vol * ((double)count) / ((double)n_per_replica); 
+        total_count += count; 
+    }
+
+    auto result = combine_replicas(estimates); 
+    result.telemetry = telemetry.Finish((long int)total_count); 
+    return result; 
+}
+
+ValueWithError_t<double> ScrambledSobolIntegrate(
+    const unsigned long int n_pts,                  //total number of points to use (a multiple of n_replicas), split evenly between the replicas
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    BatchValueIntegrand_t fcn,                      //real-valued fcn to integrate, a whole (SoA) block of points at a time
+    const unsigned int n_replicas,                  //number of independently scrambled copies of the sequence
+    const std::optional<uint64_t> seed,             //seed of the scrambling (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    check_replicas(n_pts, n_replicas); 
+
+    const unsigned long int n_per_replica = n_pts / n_replicas; 
+    const unsigned long int n_chunks      = (n_per_replica + kChunkSize - 1) / kChunkSize; 
+
+    auto stats_block = [fcn, f = vector<double>(kBatchSize)](RunningStats_t& stats, const unsigned long int n_batch, double* const* X) mutable
+    {
+        fcn(n_batch, X, f.data()); 
+        stats.Add(n_batch, f.data()); 
+    }; 
+    TelemetryRecorder_t telemetry("ScrambledSobolIntegrate"); 
+    const auto chunk_stats = sobol_blocks<RunningStats_t>(n_per_replica, bounds, policy, stats_block, n_replicas, Philox::ResolveSeed(seed), telemetry.Get()); 
+
+    double total_vol{1.}; 
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    vector<double> estimates(n_replicas); 
+    for (unsigned int r=0; r<n_replicas; r++) {
+
+        RunningStats_t stats; 
+        for (unsigned long int c=0; c<n_chunks; c++) stats.Add(chunk_stats[r*n_chunks + c]); 
+
+        estimates[r] = total_vol * stats.Mean(); 
+    }
+
+    auto result = combine_replicas(estimates); 
+    result.telemetry = telemetry.Finish(); 
+    return result; 
+}
+
+TargetResult_t ScrambledSobolIntegrateToTarget(
+    const PrecisionTarget_t target,                 //error to reach, and the most points to use (over all the replicas)
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    BatchIntegrand_t fcn,                           //fcn to integrate, a whole (SoA) block of points at a time. returns the number inside the region.               
+    const unsigned int n_replicas,                  //number of independently scrambled copies of the sequence
+    const std::optional<uint64_t> seed,             //seed of the scrambling (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    double total_vol{1.}; 
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    auto count_block = [fcn](unsigned long int& count, const unsigned long int n_batch, double* const* X)
+    {
+        count += fcn(n_batch, X); 
+    }; 
+
+    auto estimate = [total_vol](const unsigned long int count, const unsigned long int n_per_replica)
+    {
+        return total_vol * ((double)count) / ((double)n_per_replica); 
+    }; 
+
+    TelemetryRecorder_t telemetry("ScrambledSobolIntegrateToTarget"); 
+    return scrambled_sobol_to_target<unsigned long int>(target, bounds, n_replicas, Philox::ResolveSeed(seed), policy, count_block, estimate, telemetry); 
+}
+
+TargetResult_t ScrambledSobolIntegrateToTarget(
+    const PrecisionTarget_t target,                 //error to reach, and the most points to use (over all the replicas)
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    BatchValueIntegrand_t fcn,                      //real-valued fcn to integrate, a whole (SoA) block of points at a time
+    const unsigned int n_replicas,                  //number of independently scrambled copies of the sequence
+    const std::optional<uint64_t> seed,             //seed of the scrambling (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    double total_vol{1.}; 
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    auto stats_block = [fcn, f = vector<double>(kBatchSize)](RunningStats_t& stats, const unsigned long int n_batch, double* const* X) mutable
+    {
+        fcn(n_batch, X, f.data()); 
+        stats.Add(n_batch, f.data()); 
+    }; 
+
+    auto estimate = [total_vol](const RunningStats_t& stats, const unsigned long int) { return total_vol * stats.Mean(); }; 
+
+    TelemetryRecorder_t telemetry("ScrambledSobolIntegrateToTarget"); 
+    return scrambled_sobol_to_target<RunningStats_t>(target, bounds, n_replicas, Philox::ResolveSeed(seed), policy, stats_block, estimate, telemetry); 
+}
+
+
+
+namespace {
+
+    //tallies the segments of the sequence up to the last checkpoint (in parallel), then adds them up in 
+    // order, and gives 'estimate(tally, n)' each time the sum reaches a checkpoint. (the whole run is one 
+    // record of 'telemetry', which every checkpoint's result shares.)
+    template<typename Tally_t, typename OnBlock, typename Estimate> vector<ValueWithError_t<double>> sobol_checkpoints(
+        const vector<unsigned long int>& checkpoints, 
+        const vector<IntegrationBound_t>& bounds, 
+        const ExecutionPolicy_t& policy, 
+        const OnBlock& on_block, 
+        const Estimate& estimate, 
+        TelemetryRecorder_t& telemetry
+    )
+    {
+        const auto ends = checkpoint_segment_ends(checkpoints); 
+
+        const auto segment_tallies = sobol_segments<Tally_t>(0, ends, bounds, policy, on_block, 1, nullopt, telemetry.Get()); 
+
+        vector<ValueWithError_t<double>> results; 
+        results.reserve(checkpoints.size()); 
+
+        Tally_t total{}; 
+        for (size_t i=0, i_checkpoint=0; i<ends.size(); i++) {
+            add_tally(total, segment_tallies[i]); 
+            if (ends[i] == checkpoints[i_checkpoint]) results.push_back( estimate(total, checkpoints[i_checkpoint++]) ); 
+        }
+
+        const auto record = telemetry.Finish(tally_hits(total)); 
+        for (auto& result : results) result.telemetry = record; 
+        return results; 
+    }
+}
+
+std::vector<ValueWithError_t<double>> SobolIntegrateCheckpoints(
+    const std::vector<unsigned long int> checkpoints,   //numbers of points to give the result at (increasing)
+    const std::vector<IntegrationBound_t> bounds,       //number of dimensions is given by the number of bounds given. 
+    BatchIntegrand_t fcn,                               //fcn to integrate, a whole (SoA) block of points at a time. returns the number inside the region.               
+    const ExecutionPolicy_t& policy                     //threads (see ExecutionPolicy.hpp)
+)
+{
+    double total_vol{1.}; 
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    auto count_block = [fcn](unsigned long int& count, const unsigned long int n_batch, double* const* X)
+    {
+        count += fcn(n_batch, X); 
+    }; 
+
+    auto estimate = [total_vol](const unsigned long int count, const unsigned long int n_pts)
+    {
+        return ValueWithError_t<double>{ total_vol * (((double)count) / ((double)n_pts)), total_vol * (sqrt((double)count) / ((double)n_pts)) }; 
+    }; 
+
+    TelemetryRecorder_t telemetry("SobolIntegrateCheckpoints"); 
+    return sobol_checkpoints<unsigned long int>(checkpoints, bounds, policy, count_block, estimate, telemetry); 
+}
+
+std::vector<ValueWithError_t<double>> SobolIntegrateCheckpoints(
+    const std::vector<unsigned long int> checkpoints,   //numbers of points to give the result at (increasing)
+    const std::vector<IntegrationBound_t> bounds,       //number of dimensions is given by the number of bounds given. 
+    BatchValueIntegrand_t fcn,                          //real-valued fcn to integrate, a whole (SoA) block of points at a time
+    const ExecutionPolicy_t& policy                     //threads (see ExecutionPolicy.hpp)
+)
+{
+    double total_vol{1.}; 
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    auto stats_block = [fcn, f = vector<double>(kBatchSize)](RunningStats_t& stats, const unsigned long int n_batch, double* const* X) mutable
+    {
+        fcn(n_batch, X, f.data()); 
+        stats.Add(n_batch, f.data()); 
+    }; 
+
+    auto estimate = [total_vol](const RunningStats_t& stats, const unsigned long int) { return stats.Estimate(total_vol); }; 
+
+    TelemetryRecorder_t telemetry("SobolIntegrateCheckpoints"); 
+    return sobol_checkpoints<RunningStats_t>(checkpoints, bounds, policy, stats_block, estimate, telemetry); 
+}
+
+std::vector<ValueWithError_t<double>> SobolIntegrateMulti(
+    const unsigned long int n_pts,                  //number of points to use in the integration. 
+    const std::vector<IntegrationBound_t> bounds,   //bounding box shared by all of the regions
+    const unsigned long int n_regions,              //number of regions the fcn tests the points against
+    BatchMultiIntegrand_t fcn,                      //fcn to integrate. adds the number of points of the block inside each region to counts[k].
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    auto count_block = [fcn, n_regions](vector<unsigned long int>& counts, const unsigned long int n_batch, double* const* X)
+    {
+        if (counts.empty()) counts.assign(n_regions, 0); 
+        fcn(n_batch, X, counts.data()); 
+    }; 
+    TelemetryRecorder_t telemetry("SobolIntegrateMulti"); 
+    const auto chunk_counts = sobol_blocks<vector<unsigned long int>>(n_pts, bounds, policy, count_block, 1, nullopt, telemetry.Get()); 
+
+    vector<unsigned long int> counts(n_regions, 0); 
+    for (const auto& chunk : chunk_counts) {
+        for (unsigned long int k=0; k<chunk.size(); k++) counts[k] += chunk[k]; 
+    }
+
+    double total_vol{1.}; 
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    //(there is no one hit ratio for all the regions, so the record doesn't have one)
+    const auto record = telemetry.Finish(); 
+
+    vector<ValueWithError_t<double>> results; 
+    for (const unsigned long int count : counts) {
+        results.push_back({ total_vol * (((double)count) / ((double)n_pts)), total_vol * (sqrt((double)count) / ((double)n_pts)), record }); 
+    }
+    return results; 
+}
+
+std::vector<ValueWithError_t<double>> SobolIntegrateVector(
+    const unsigned long int n_pts,                  //number of points to use in the integration. 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    const unsigned long int n_components,           //number of outputs of the fcn
+    BatchVectorIntegrand_t fcn,                     //fcn to integrate, a whole (SoA) block of points at a time
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    //(F has to be pointed at this copy's own buffer on every call: the lambda is copied for each segment)
+    auto stats_block = [fcn, n_components, f = vector<double>(n_components * kBatchSize), F = vector<double*>(n_components)]
+        (vector<RunningStats_t>& stats, const unsigned long int n_batch, double* const* X) mutable
+    {
+        if (stats.empty()) stats.resize(n_components); 
+        for (unsigned long int k=0; k<n_components; k++) F[k] = f.data() + k*kBatchSize; 
+
+        fcn(n_batch, X, F.data()); 
+        for (unsigned long int k=0; k<n_components; k++) stats[k].Add(n_batch, F[k]); 
+    }; 
+    TelemetryRecorder_t telemetry("SobolIntegrateVector"); 
+    const auto chunk_stats = sobol_blocks<vector<RunningStats_t>>(n_pts, bounds, policy, stats_block, 1, nullopt, telemetry.Get()); 
+
+    vector<RunningStats_t> stats(n_components); 
+    for (const auto& chunk : chunk_stats) {
+        for (unsigned long int k=0; k<chunk.size(); k++) stats[k].Add(chunk[k]); 
+    }
+
+    double total_vol{1.}; 
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    const auto record = telemetry.Finish(); 
+
+    vector<ValueWithError_t<double>> results; 
+    for (const auto& component : stats) {
+        results.push_back( component.Estimate(total_vol) ); 
+        results.back().telemetry = record; 
+    }
+    return results; 
+}
+
+std::vector<ValueWithError_t<double>> SobolIntegrateVector(
+    const unsigned long int n_pts,                  //number of points to use in the integration. 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    const unsigned long int n_components,           //number of outputs of the fcn
+    std::function<void(const double*, double*)> fcn,//fcn to integrate. writes its outputs at the point X to out[0 ... n_components-1]
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    return SobolIntegrateVector(n_pts, bounds, n_components, make_batch_vector_integrand((int)bounds.size(), n_components, fcn), policy); 
+}
+
+ValueWithError_t<double> SobolIntegrateControlVariates(
+    const unsigned long int n_pts,                  //number of points to use in the integration. 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    BatchValueIntegrand_t fcn,                      //real-valued fcn to integrate, a whole (SoA) block of points at a time
+    const std::vector<ControlVariate_t> controls,   //references, with their exact integrals over the bounds
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    const unsigned long int n_fcns = 1 + controls.size(); 
+
+    //F[0] is the fcn, F[1+m] is reference m. (F has to be pointed at this copy's own buffer on every call.)
+    auto covariance_block = [fcn, controls, n_fcns, f = vector<double>(n_fcns * kBatchSize), F = vector<double*>(n_fcns)]
+        (RunningCovariance_t& covariance, const unsigned long int n_batch, double* const* X) mutable
+    {
+        for (unsigned long int k=0; k<n_fcns; k++) F[k] = f.data() + k*kBatchSize; 
+
+        fcn(n_batch, X, F[0]); 
+        for (unsigned long int m=0; m<controls.size(); m++) controls[m].fcn(n_batch, X, F[1+m]); 
+
+        covariance.Add(n_batch, n_fcns, F.data()); 
+    }; 
+    TelemetryRecorder_t telemetry("SobolIntegrateControlVariates"); 
+    const auto chunk_covariances = sobol_blocks<RunningCovariance_t>(n_pts, bounds, policy, covariance_block, 1, nullopt, telemetry.Get()); 
+
+    RunningCovariance_t covariance; 
+    for (const auto& chunk : chunk_covariances) covariance.Add(chunk); 
+
+    double total_vol{1.}; 
+    for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+    vector<double> mu; 
+    for (const auto& control : controls) mu.push_back( control.integral / total_vol ); 
+
+    auto result = covariance.Estimate(total_vol, mu); 
+    result.telemetry = telemetry.Finish(); 
+    return result; 
+}
+
+namespace {
+
+    //the (empty) record of shard 'i_shard' of a run, and the ends of the chunks of its points
+    ShardRecord_t sobol_shard_record(
+        const unsigned int i_shard, 
+        const unsigned int n_shards, 
+        const unsigned long int n_pts, 
+        const vector<IntegrationBound_t>& bounds, 
+        vector<unsigned long int>& ends
+    )
+    {
+        ShardRecord_t record; 
+        record.integrator = "SobolIntegrate"; 
+        record.bounds     = bounds; 
+        record.n_pts      = n_pts; 
+        shard_point_range(i_shard, n_shards, n_pts, record.first, record.end); 
+
+        for (unsigned long int i_pt=record.first; i_pt < record.end; i_pt += kChunkSize) ends.push_back( min<unsigned long int>( record.end, i_pt + kChunkSize ) ); 
+        return record; 
+    }
+}
+
+ShardRecord_t SobolIntegrateShard(
+    const unsigned int i_shard,                     //which shard this is (0 ... n_shards-1)
+    const unsigned int n_shards,                    //number of shards the run is split into
+    const unsigned long int n_pts,                  //number of points of the whole run
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    BatchIntegrand_t fcn,                           //fcn to integrate, a whole (SoA) block of points at a time. returns the number inside the region.               
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    vector<unsigned long int> ends; 
+    ShardRecord_t record = sobol_shard_record(i_shard, n_shards, n_pts, bounds, ends); 
+
+    auto count_block = [fcn](unsigned long int& count, const unsigned long int n_batch, double* const* X)
+    {
+        count += fcn(n_batch, X); 
+    }; 
+    //(a shard record has nowhere to keep the telemetry, so it only goes into the log)
+    TelemetryRecorder_t telemetry("SobolIntegrateShard"); 
+    const auto chunk_counts = sobol_segments<unsigned long int>(record.first, ends, bounds, policy, count_block, 1, nullopt, telemetry.Get()); 
+
+    record.counting = true; 
+    for (auto chunk_count : chunk_counts) record.count += chunk_count; 
+    telemetry.Finish((long int)record.count); 
+    return record; 
+}
+
+ShardRecord_t SobolIntegrateShard(
+    const unsigned int i_shard,                     //which shard this is (0 ... n_shards-1)
+    const unsigned int n_shards,                    //number of shards the run is split into
+    const unsigned long int n_pts,                  //number of points of the whole run
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given. 
+    BatchValueIntegrand_t fcn,                      //real-valued fcn to integrate, a whole (SoA) block of points at a time
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    vector<unsigned long int> ends; 
+    ShardRecord_t record = sobol_shard_record(i_shard, n_shards, n_pts, bounds, ends); 
+
+    auto stats_block = [fcn, f = vector<double>(kBatchSize)](RunningStats_t& stats, const unsigned long int n_batch, double* const* X) mutable
+    {
+        fcn(n_batch, X, f.data()); 
+        stats.Add(n_batch, f.data()); 
+    }; 
+
+    TelemetryRecorder_t telemetry("SobolIntegrateShard"); 
+    record.counting    = false; 
+    record.chunk_stats = sobol_segments<RunningStats_t>(record.first, ends, bounds, policy, stats_block, 1, nullopt, telemetry.Get()); 
+    telemetry.Finish(); 
+    return record; 
+}
\ No newline at end of file
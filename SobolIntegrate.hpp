@@ -6,16 +6,172 @@
 #include <limits> 
 #include <functional> 
 #include <vector> 
+#include <cstdint> 
 #include "ValueWithError.hpp"
 #include "IntegrationBound.hpp"
-#include <Math/QuasiRandom.h>
-#include <map> 
-#include <memory> 
+#include "BatchIntegrand.hpp"
+#include "ControlVariate.hpp"
+#include "PrecisionTarget.hpp"
+#include "ExecutionPolicy.hpp"
+#include "ShardRecord.hpp"
 
 ValueWithError_t<double> SobolIntegrate(
     const long unsigned int npts,                   //number of points to use in the quasai-random sequence 
     const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
-    std::function<bool(const double*)> fcn          //fcn to integrate. must accept (CONST) ptr to doubles.  
+    std::function<bool(const double*)> fcn,         //fcn to integrate. must accept (CONST) ptr to doubles.  
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// same as above, but the fcn is evaluated on a whole block of points at a time (see BatchIntegrand.hpp).
+ValueWithError_t<double> SobolIntegrate(
+    const long unsigned int npts,                   //number of points to use in the quasai-random sequence 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
+    BatchIntegrand_t fcn,                           //fcn to integrate. returns the number of points in the block inside the region. 
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// same as above, for a real-valued fcn (see BatchIntegrand.hpp). the error given is the one the same 
+// number of pseudo-random points would have. 
+ValueWithError_t<double> SobolIntegrate(
+    const long unsigned int npts,                   //number of points to use in the quasai-random sequence 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
+    BatchValueIntegrand_t fcn,                      //fcn to integrate. writes the value of the fcn at each point of the block. 
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// 'checkpoint' versions: one pass over the first checkpoints.back() points of the sequence, which gives the 
+// running result at each of the checkpoints (numbers of points, in strictly increasing order) on the way. 
+// result k is the same as SobolIntegrate() with checkpoints[k] points, at the cost of just the last one. 
+std::vector<ValueWithError_t<double>> SobolIntegrateCheckpoints(
+    const std::vector<unsigned long int> checkpoints,   //numbers of points to give the result at (increasing)
+    const std::vector<IntegrationBound_t> bounds,       //number of dimensions is given by the number of bounds given.  
+    BatchIntegrand_t fcn,                               //fcn to integrate. returns the number of points in the block inside the region. 
+    const ExecutionPolicy_t& policy={}                  //threads (see ExecutionPolicy.hpp)
+); 
+
+std::vector<ValueWithError_t<double>> SobolIntegrateCheckpoints(
+    const std::vector<unsigned long int> checkpoints,   //numbers of points to give the result at (increasing)
+    const std::vector<IntegrationBound_t> bounds,       //number of dimensions is given by the number of bounds given.  
+    BatchValueIntegrand_t fcn,                          //fcn to integrate. writes the value of the fcn at each point of the block. 
+    const ExecutionPolicy_t& policy={}                  //threads (see ExecutionPolicy.hpp)
+); 
+
+// for several regions at once, which share a bounding box (see BatchMultiIntegrand_t). result k is the same 
+// as SobolIntegrate() would give for region k alone. 
+std::vector<ValueWithError_t<double>> SobolIntegrateMulti(
+    const long unsigned int npts,                   //number of points to use in the quasai-random sequence 
+    const std::vector<IntegrationBound_t> bounds,   //bounding box shared by all of the regions
+    const unsigned long int n_regions,              //number of regions the fcn tests the points against
+    BatchMultiIntegrand_t fcn,                      //fcn to integrate. adds the number of points of the block inside each region to counts[k].
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// for a vector-valued fcn (see BatchVectorIntegrand_t): result k is the integral of output k, as the 
+// real-valued SobolIntegrate() would give it; all of them come from the same points, in one pass. 
+std::vector<ValueWithError_t<double>> SobolIntegrateVector(
+    const unsigned long int n_pts,                  //number of points to use in the integration. 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.
+    const unsigned long int n_components,           //number of outputs of the fcn
+    BatchVectorIntegrand_t fcn,                     //fcn to integrate. writes each output of the fcn at each point of the block.
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// same as above, for a fcn called one point at a time: fcn(X, out) writes its outputs to out[0 ... n_components-1]
+std::vector<ValueWithError_t<double>> SobolIntegrateVector(
+    const unsigned long int n_pts,                  //number of points to use in the integration. 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.
+    const unsigned long int n_components,           //number of outputs of the fcn
+    std::function<void(const double*, double*)> fcn,//fcn to integrate
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// with control variates (see ControlVariate.hpp), fit on the sobol points. (as for the plain version, the 
+// error is what random points would give.) 
+ValueWithError_t<double> SobolIntegrateControlVariates(
+    const unsigned long int n_pts,                  //number of points to use in the integration. 
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.
+    BatchValueIntegrand_t fcn,                      //fcn to integrate. writes the value of the fcn at each point of the block.
+    const std::vector<ControlVariate_t> controls,   //references, with their exact integrals over the bounds
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// one shard of a run split between several processes (see ShardRecord.hpp, and MontecarloIntegrateShard): 
+// the records of all the shards merge into the same result as SobolIntegrate(n_pts, bounds, fcn). 
+ShardRecord_t SobolIntegrateShard(
+    const unsigned int i_shard,                     //which shard this is (0 ... n_shards-1)
+    const unsigned int n_shards,                    //number of shards the run is split into
+    const unsigned long int n_pts,                  //number of points of the whole run
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
+    BatchIntegrand_t fcn,                           //fcn to integrate. returns the number of points in the block inside the region. 
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+ShardRecord_t SobolIntegrateShard(
+    const unsigned int i_shard,                     //which shard this is (0 ... n_shards-1)
+    const unsigned int n_shards,                    //number of shards the run is split into
+    const unsigned long int n_pts,                  //number of points of the whole run
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
+    BatchValueIntegrand_t fcn,                      //fcn to integrate. writes the value of the fcn at each point of the block. 
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// Randomized quasi-monte-carlo: the points are split between 'n_replicas' independently scrambled copies 
+// of the sobol sequence (see SobolSequence.hpp), each of which gives its own (unbiased) estimate. the 
+// result is their mean, and the error is the standard error of that mean, so unlike the plain versions 
+// above, it tells you how well the quasi-random points actually did. every replica gets the same number 
+// of points, so the total must be a multiple of n_replicas (if not, invalid_argument is thrown, rather than 
+// dropping the rest). (each replica does best with a power of 2 points.)
+
+//default number of replicas
+constexpr unsigned int kSobolReplicas = 16; 
+
+ValueWithError_t<double> ScrambledSobolIntegrate(
+    const long unsigned int npts,                   //total number of points to use. must be a multiple of n_replicas (each gets npts/n_replicas).
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
+    std::function<bool(const double*)> fcn,         //fcn to integrate. must accept (CONST) ptr to doubles.  
+    const unsigned int n_replicas=kSobolReplicas,   //number of independently scrambled copies of the sequence (at least 2)
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the scrambling. the same seed always gives the same result.
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+ValueWithError_t<double> ScrambledSobolIntegrate(
+    const long unsigned int npts,                   //total number of points to use. must be a multiple of n_replicas (each gets npts/n_replicas).
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
+    BatchIntegrand_t fcn,                           //fcn to integrate. returns the number of points in the block inside the region. 
+    const unsigned int n_replicas=kSobolReplicas,   //number of independently scrambled copies of the sequence (at least 2)
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the scrambling (see above)
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+ValueWithError_t<double> ScrambledSobolIntegrate(
+    const long unsigned int npts,                   //total number of points to use. must be a multiple of n_replicas (each gets npts/n_replicas).
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
+    BatchValueIntegrand_t fcn,                      //fcn to integrate. writes the value of the fcn at each point of the block. 
+    const unsigned int n_replicas=kSobolReplicas,   //number of independently scrambled copies of the sequence (at least 2)
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the scrambling (see above)
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+// 'target-precision' versions (see PrecisionTarget.hpp): every replica gets more points, a round at a time, 
+// until the spread of the replicas reaches the target, or max_pts points (over all the replicas) have been 
+// used. each replica always uses the first n_pts/n_replicas points of its own sequence, so the value is the 
+// same as that of the fixed-size version with the same n_pts and seed. 
+TargetResult_t ScrambledSobolIntegrateToTarget(
+    const PrecisionTarget_t target,                 //error to reach, and the most points to use (over all the replicas)
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
+    BatchIntegrand_t fcn,                           //fcn to integrate. returns the number of points in the block inside the region. 
+    const unsigned int n_replicas=kSobolReplicas,   //number of independently scrambled copies of the sequence (at least 2)
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the scrambling (see above)
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+); 
+
+TargetResult_t ScrambledSobolIntegrateToTarget(
+    const PrecisionTarget_t target,                 //error to reach, and the most points to use (over all the replicas)
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.  
+    BatchValueIntegrand_t fcn,                      //fcn to integrate. writes the value of the fcn at each point of the block. 
+    const unsigned int n_replicas=kSobolReplicas,   //number of independently scrambled copies of the sequence (at least 2)
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the scrambling (see above)
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
 ); 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,286 @@
+#include "SobolSequence.hpp"
+#include "SimdLevel.hpp"
+#include "PhiloxRandom.hpp"
+#include "SobolDirectionNumbers.hpp"
+#include <stdexcept>
+#include <string>
+#include <cstring>
+#include <array>
+#include <algorithm>
+
+#ifdef INTEGRATORS_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+static_assert(SobolSequence::kMaxDim == kSobolJoeKuoMaxDim, "SobolSequence::kMaxDim must match the table of direction numbers");
+
+namespace {
+
+    //x / 2^32, by putting x at the top of the mantissa of a double in [1,2) and subtracting 1. this is
+    // exact (so it's the same as (double)x / 2^32), but unlike an unsigned-to-double conversion, it
+    // vectorizes with plain SSE2 / AVX2.
+    inline double to_unit(const uint32_t x)
+    {
+        const uint64_t bits = (((uint64_t)x) << 20) | 0x3FF0000000000000ull;
+        double one_to_two;
+        memcpy(&one_to_two, &bits, sizeof(double));
+        return one_to_two - 1.;
+    }
+
+    //writes coordinate i of the points [first, first + 8*n_octets) (first must be a multiple of 8) into x,
+    // where 'state' is coordinate i of point 'first'. returns coordinate i of the point after the last.
+    // for n a multiple of 8, gray(n+t) = gray(n) ^ gray(t), so point n+t is just point n XORed with the
+    // fixed offsets for t; the inner loop over t vectorizes.
+    inline uint32_t fill_octets(
+        const unsigned long int n_octets, const uint64_t first, const int dim, const int i,
+        const uint32_t* directions, const uint32_t* offsets, uint32_t state,
+        const double xmin, const double dx, double* x
+    )
+    {
+        for (unsigned long int b=0; b<n_octets; b++, x+=8) {
+
+            for (int t=0; t<8; t++) x[t] = xmin + dx*to_unit(state ^ offsets[t]);
+
+            //from point n+7 on to point n+8
+            const uint64_t n_last = first + 8*b + 7;
+            if (n_last + 1 < SobolSequence::kMaxPoints) state ^= offsets[7] ^ directions[__builtin_ctzll(~n_last)*dim + i];
+        }
+        return state;
+    }
+
+#ifdef INTEGRATORS_HAVE_X86_SIMD
+    //the same, with the 8 offsets of the coordinate kept in a register. (the same bits as to_unit().)
+    __attribute__((target("avx2")))
+    uint32_t fill_octets_avx2(
+        const unsigned long int n_octets, const uint64_t first, const int dim, const int i,
+        const uint32_t* directions, const uint32_t* offsets, uint32_t state,
+        const double xmin, const double dx, double* x
+    )
+    {
+        const __m256i offs    = _mm256_loadu_si256((const __m256i*)offsets);
+        const __m256i one_exp = _mm256_set1_epi64x(0x3FF0000000000000ll);
+        const __m256d one     = _mm256_set1_pd(1.);
+        const __m256d v_xmin  = _mm256_set1_pd(xmin);
+        const __m256d v_dx    = _mm256_set1_pd(dx);
+
+        for (unsigned long int b=0; b<n_octets; b++, x+=8) {
+
+            const __m256i pts = _mm256_xor_si256(_mm256_set1_epi32((int)state), offs);
+
+            const __m256i lo = _mm256_or_si256(_mm256_slli_epi64(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(pts)),      20), one_exp);
+            const __m256i hi = _mm256_or_si256(_mm256_slli_epi64(_mm256_cvtepu32_epi64(_mm256_extracti128_si256(pts, 1)), 20), one_exp);
+
+            _mm256_storeu_pd(x,     _mm256_add_pd(v_xmin, _mm256_mul_pd(v_dx, _mm256_sub_pd(_mm256_castsi256_pd(lo), one))));
+            _mm256_storeu_pd(x + 4, _mm256_add_pd(v_xmin, _mm256_mul_pd(v_dx, _mm256_sub_pd(_mm256_castsi256_pd(hi), one))));
+
+            const uint64_t n_last = first + 8*b + 7;
+            if (n_last + 1 < SobolSequence::kMaxPoints) state ^= offsets[7] ^ directions[__builtin_ctzll(~n_last)*dim + i];
+        }
+        return state;
+    }
+
+    __attribute__((target("avx512f")))
+    uint32_t fill_octets_avx512(
+        const unsigned long int n_octets, const uint64_t first, const int dim, const int i,
+        const uint32_t* directions, const uint32_t* offsets, uint32_t state,
+        const double xmin, const double dx, double* x
+    )
+    {
+        const __m256i offs    = _mm256_loadu_si256((const __m256i*)offsets);
+        const __m512i one_exp = _mm512_set1_epi64(0x3FF0000000000000ll);
+        const __m512d one     = _mm512_set1_pd(1.);
+        const __m512d v_xmin  = _mm512_set1_pd(xmin);
+        const __m512d v_dx    = _mm512_set1_pd(dx);
+
+        for (unsigned long int b=0; b<n_octets; b++, x+=8) {
+
+            const __m256i pts  = _mm256_xor_si256(_mm256_set1_epi32((int)state), offs);
+            const __m512i bits = _mm512_or_si512(_mm512_slli_epi64(_mm512_cvtepu32_epi64(pts), 20), one_exp);
+
+            _mm512_storeu_pd(x, _mm512_add_pd(v_xmin, _mm512_mul_pd(v_dx, _mm512_sub_pd(_mm512_castsi512_pd(bits), one))));
+
+            const uint64_t n_last = first + 8*b + 7;
+            if (n_last + 1 < SobolSequence::kMaxPoints) state ^= offsets[7] ^ directions[__builtin_ctzll(~n_last)*dim + i];
+        }
+        return state;
+    }
+#endif
+}
+
+//_______________________________________________________________________________
+SobolSequence::SobolSequence(const int dim)
+    : fDim(dim)
+{
+    if (dim < 1 || dim > kMaxDim) {
+        throw invalid_argument("in <SobolSequence::SobolSequence>: dim must be between 1 and "+to_string(kMaxDim)+", not "+to_string(dim)+".");
+    }
+
+    fDirections.resize(kBits * dim);
+    fShift.assign(dim, 0u);
+    fState.assign(dim, 0u);
+
+    //v_k = m_k / 2^k, stored as an integer with kBits bits after the point.
+    auto V = [this](const int k, const int i)->uint32_t& { return fDirections[(k-1)*fDim + i]; };
+
+    //the first coordinate is just the van der corput sequence: all m_k = 1.
+    for (int k=1; k<=kBits; k++) V(k, 0) = 1u << (kBits-k);
+
+    //the others start from Joe & Kuo's initial numbers (see SobolDirectionNumbers.hpp)
+    for (int i=1; i<dim; i++) {
+
+        const SobolInitialNumbers_t& init = kSobolJoeKuo[i-1];
+
+        const int s      = init.s;
+        const uint32_t a = init.a;
+
+        for (int k=1; k<=s && k<=kBits; k++) V(k, i) = ((uint32_t)init.m[k-1]) << (kBits-k);
+
+        //the recurrence from the polynomial (Bratley & Fox)
+        for (int k=s+1; k<=kBits; k++) {
+
+            uint32_t v = V(k-s, i) ^ (V(k-s, i) >> s);
+
+            for (int l=1; l<s; l++) if ((a >> (s-1-l)) & 1u) v ^= V(k-l, i);
+
+            V(k, i) = v;
+        }
+    }
+
+    fGrayOffsets.assign(8 * dim, 0u);
+    for (int i=0; i<dim; i++) {
+        for (int t=0; t<8; t++) {
+            const int gray = t ^ (t >> 1);
+            for (int k=1; k<=3; k++) if ((gray >> (k-1)) & 1) fGrayOffsets[8*i + t] ^= V(k, i);
+        }
+    }
+}
+//_______________________________________________________________________________
+SobolSequence::SobolSequence(const int dim, const uint64_t scramble_seed)
+    : SobolSequence(dim)
+{
+    const array<uint32_t, 2> key{ (uint32_t)scramble_seed, (uint32_t)(scramble_seed >> 32) };
+
+    for (int i=0; i<fDim; i++) {
+
+        //random words for this coordinate (we use 33 of them: one for each row of the matrix, and the shift)
+        uint32_t words[36];
+        for (uint32_t w=0; w<9; w++) {
+            const auto r = Philox::Block({ (uint32_t)i, w, 0u, 0u }, key);
+            copy(r.begin(), r.end(), words + 4*w);
+        }
+
+        //row b of the matrix (b=0 is the highest bit) has a 1 on the diagonal, random bits above it (the higher
+        // bits of the input), and 0s below it.
+        uint32_t rows[kBits];
+        for (int b=0; b<kBits; b++) {
+            const uint32_t higher = (b == 0) ? 0u : (words[b] & (0xFFFFFFFFu << (kBits - b)));
+            rows[b] = higher | (1u << (kBits-1 - b));
+        }
+
+        auto scramble = [&rows](const uint32_t x)
+        {
+            uint32_t y=0;
+            for (int b=0; b<kBits; b++) y |= ((uint32_t)__builtin_parity(x & rows[b])) << (kBits-1 - b);
+            return y;
+        };
+
+        //the scrambling is linear (over XOR), so scrambling the direction numbers scrambles every point
+        for (int k=0; k<kBits; k++) fDirections[k*fDim + i] = scramble(fDirections[k*fDim + i]);
+        for (int t=0; t<8; t++)     fGrayOffsets[8*i + t]   = scramble(fGrayOffsets[8*i + t]);
+
+        fShift[i] = words[kBits];
+    }
+
+    fState = fShift;
+}
+//_______________________________________________________________________________
+void SobolSequence::Seek(const uint64_t index)
+{
+    if (index >= kMaxPoints) {
+        throw out_of_range("in <SobolSequence::Seek>: index "+to_string(index)+" is past the end of the sequence.");
+    }
+
+    //in gray-code order, point n is the XOR of the direction numbers for the set bits of gray(n).
+    const uint64_t gray = index ^ (index >> 1);
+
+    fState = fShift;
+    for (int k=0; k<kBits; k++) {
+        if (!((gray >> k) & 1)) continue;
+
+        const uint32_t* v = fDirections.data() + k*fDim;
+        for (int i=0; i<fDim; i++) fState[i] ^= v[i];
+    }
+
+    fIndex = index;
+}
+//_______________________________________________________________________________
+void SobolSequence::Next(double* point)
+{
+    if (fIndex >= kMaxPoints) {
+        throw out_of_range("in <SobolSequence::Next>: ran past the end of the sequence.");
+    }
+
+    for (int i=0; i<fDim; i++) point[i] = to_unit(fState[i]);
+
+    Advance();
+}
+//_______________________________________________________________________________
+void SobolSequence::Advance()
+{
+    //gray(n+1) differs from gray(n) in just one bit: the lowest zero bit of n.
+    if (fIndex + 1 < kMaxPoints) {
+
+        const uint32_t* v = fDirections.data() + __builtin_ctzll(~fIndex)*fDim;
+        for (int i=0; i<fDim; i++) fState[i] ^= v[i];
+    }
+
+    fIndex++;
+}
+//_______________________________________________________________________________
+void SobolSequence::NextBlock(
+    const unsigned long int n_pts,
+    const vector<IntegrationBound_t>& bounds,
+    double* const* X
+)
+{
+    if (fIndex + n_pts > kMaxPoints) {
+        throw out_of_range("in <SobolSequence::NextBlock>: ran past the end of the sequence.");
+    }
+
+    //one point at a time, until we're at a multiple of 8 (or done)
+    unsigned long int j=0;
+    for (; j<n_pts && (fIndex & 7); j++) {
+        for (int i=0; i<fDim; i++) X[i][j] = bounds[i].xmin + (bounds[i].xmax - bounds[i].xmin)*to_unit(fState[i]);
+        Advance();
+    }
+
+    //then 8 points at a time, one coordinate at a time
+    const unsigned long int n_octets = (n_pts - j) / 8;
+    if (n_octets > 0) {
+
+        const SimdLevel simd_level = get_simd_level();
+
+        for (int i=0; i<fDim; i++) {
+
+            const double xmin = bounds[i].xmin, dx = bounds[i].xmax - bounds[i].xmin;
+            const uint32_t* offsets = fGrayOffsets.data() + 8*i;
+
+#ifdef INTEGRATORS_HAVE_X86_SIMD
+            if (simd_level == kSimdAVX512) { fState[i] = fill_octets_avx512(n_octets, fIndex, fDim, i, fDirections.data(), offsets, fState[i], xmin, dx, X[i] + j); continue; }
+            if (simd_level == kSimdAVX2)   { fState[i] = fill_octets_avx2  (n_octets, fIndex, fDim, i, fDirections.data(), offsets, fState[i], xmin, dx, X[i] + j); continue; }
+#endif
+            fState[i] = fill_octets(n_octets, fIndex, fDim, i, fDirections.data(), offsets, fState[i], xmin, dx, X[i] + j);
+        }
+        fIndex += 8*n_octets;
+        j      += 8*n_octets;
+    }
+
+    //and whatever is left over
+    for (; j<n_pts; j++) {
+        for (int i=0; i<fDim; i++) X[i][j] = bounds[i].xmin + (bounds[i].xmax - bounds[i].xmin)*to_unit(fState[i]);
+        Advance();
+    }
+}
+//_______________________________________________________________________________
\ No newline at end of file
@@ -0,0 +1,92 @@
+#ifndef SobolSequence_H
+#define SobolSequence_H
+
+#include <cstdint>
+#include <vector>
+#include "IntegrationBound.hpp"
+
+// A Sobol low-discrepancy sequence in the unit hypercube [0,1)^dim, generated in Gray-code order
+// (Antonov & Saleev): point n is the XOR of the direction numbers picked out by the bits of the
+// Gray code of n, so going from point n to point n+1 flips exactly one of them.
+//
+// Each SobolSequence object owns its own position in the sequence, and can be moved to any point
+// with Seek() in O(dim * bits), without generating the points before it. So a range of indices can
+// be split up into contiguous blocks, and each block generated by a different thread, with exactly
+// the same points as a serial run.
+//
+// for example:
+//
+//  SobolSequence sobol(3);
+//  sobol.Seek(1024);                      //skip straight to point 1024
+//  double X[3];
+//  sobol.Next(X);                         //X is now point 1024, and the next call gives point 1025
+//
+class SobolSequence {
+public:
+
+    //number of bits in each coordinate; also, the sequence has 2^kBits points.
+    static constexpr int kBits = 32;
+
+    //the highest dimension we have direction numbers for (see SobolDirectionNumbers.hpp)
+    static constexpr int kMaxDim = 1111;
+
+    //the number of points in the sequence
+    static constexpr uint64_t kMaxPoints = ((uint64_t)1) << kBits;
+
+    // throws std::invalid_argument if dim is not in [1, kMaxDim]
+    explicit SobolSequence(const int dim);
+
+    // a randomly scrambled version of the sequence: the bits of each coordinate are mixed by a random
+    // lower-triangular matrix (each bit of the result only depends on the same, and higher, bits of the
+    // point), and then XORed with a random 'digital shift' (Matousek's linear matrix scrambling). the
+    // points are still a (t,s)-sequence, but each one is uniform in [0,1)^dim, so averaging over
+    // independent scramblings gives an unbiased estimate, with an honest error.
+    SobolSequence(const int dim, const uint64_t scramble_seed);
+
+    int GetDim() const { return fDim; }
+
+    //index of the point which the next call to Next() will return
+    uint64_t GetIndex() const { return fIndex; }
+
+    //move to point 'index' of the sequence (0 is the first point). throws std::out_of_range if
+    // index >= kMaxPoints.
+    void Seek(const uint64_t index);
+
+    //write the current point into 'point' (which must have room for 'dim' doubles), and move on
+    // to the next one.
+    void Next(double* point);
+
+    //write the next n_pts points straight into a (SoA) block, mapped onto 'bounds': X[i][j] is the i-th
+    // coordinate of point (GetIndex() + j). gives exactly the same points as calling Next() n_pts times,
+    // but works on 8 points at a time. throws std::out_of_range if this runs past the end of the sequence.
+    void NextBlock(
+        const unsigned long int n_pts,
+        const std::vector<IntegrationBound_t>& bounds,
+        double* const* X
+    );
+
+private:
+
+    //move fState on from point fIndex to point fIndex+1
+    void Advance();
+
+    const int fDim;
+
+    uint64_t fIndex{0};
+
+    //direction numbers; fDirections[k*fDim + i] is the k-th (k = 0 ... kBits-1) direction number of
+    // the i-th coordinate.
+    std::vector<uint32_t> fDirections;
+
+    //fGrayOffsets[8*i + t] is the XOR of the first 3 direction numbers of coordinate i picked out by
+    // gray(t). if n is a multiple of 8, point n+t is point n XORed with these (t = 0 ... 7).
+    std::vector<uint32_t> fGrayOffsets;
+
+    //the digital shift each point is XORed with (all 0 if the sequence isn't scrambled)
+    std::vector<uint32_t> fShift;
+
+    //the current point, as integers (divide by 2^kBits to get a coordinate in [0,1))
+    std::vector<uint32_t> fState;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,420 @@
+#include "SphereKernels.hpp"
+#include "SimdLevel.hpp"
+#include "DimDispatch.hpp"
+#include <cmath>
+#include <algorithm>
+
+#ifdef INTEGRATORS_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+//note on exactness: every kernel accumulates |X|^2 in the same order (X[0] first), using a
+// separate multiply and add (no fma), so that a point on the boundary is classified the same
+// way no matter which kernel runs.
+//
+//each kernel is a template on 'Dim', the number of coordinates. Dim=0 means 'use the runtime 
+// value of dim'; otherwise, the loops over coordinates have a fixed length and can be unrolled. 
+
+namespace {
+
+    //_______________________________________________________________________________
+    template<int Dim> unsigned long int count_inside_ball_scalar(
+        const unsigned long int j_start, const unsigned long int n_pts, const int dim_rt, const double* const* X, const double R_R
+    )
+    {
+        const int dim = Dim > 0 ? Dim : dim_rt;
+
+        unsigned long int count=0;
+        for (unsigned long int j=j_start; j<n_pts; j++) {
+
+            double val=0.;
+            for (int i=0; i<dim; i++) val += X[i][j]*X[i][j];
+
+            if (val < R_R) count++;
+        }
+        return count;
+    }
+    //_______________________________________________________________________________
+    template<int Dim> unsigned long int count_inside_both_spheres_scalar(
+        const unsigned long int j_start, const unsigned long int n_pts, const int dim_rt, const double* const* X,
+        const double R1_R1, const double R2_R2, const double sep
+    )
+    {
+        const int dim = Dim > 0 ? Dim : dim_rt;
+
+        unsigned long int count=0;
+        for (unsigned long int j=j_start; j<n_pts; j++) {
+
+            //check the first sphere
+            double val=0.;
+            for (int i=0; i<dim; i++) val += X[i][j]*X[i][j];
+
+            if (val > R1_R1) continue;
+
+            //compute dist to second sphere. this is the only term which differs between
+            // the distance to the two spheres
+            const double x0 = X[0][j];
+            val += (( x0 - sep )*( x0 - sep )) - ( x0*x0 );
+
+            if (val > R2_R2) continue;
+
+            count++;
+        }
+        return count;
+    }
+    //_______________________________________________________________________________
+    //the second half of the two-sphere test, for points whose |X|^2 ('val') is already known: counts how many
+    // of the points [j_start, n_pts) are inside both spheres. (the 'multi' kernels share val between configurations.)
+    unsigned long int count_inside_both_spheres_given_val_scalar(
+        const unsigned long int j_start, const unsigned long int n_pts, const double* val, const double* x0,
+        const double R1_R1, const double R2_R2, const double sep
+    )
+    {
+        unsigned long int count=0;
+        for (unsigned long int j=j_start; j<n_pts; j++) {
+
+            if (val[j] > R1_R1) continue;
+
+            const double val2 = val[j] + ((( x0[j] - sep )*( x0[j] - sep )) - ( x0[j]*x0[j] ));
+
+            if (val2 > R2_R2) continue;
+
+            count++;
+        }
+        return count;
+    }
+    //_______________________________________________________________________________
+
+#ifdef INTEGRATORS_HAVE_X86_SIMD
+
+    //_______________________________________________________________________________
+    template<int Dim> __attribute__((target("avx2")))
+    unsigned long int count_inside_ball_avx2(
+        const unsigned long int n_pts, const int dim_rt, const double* const* X, const double R_R
+    )
+    {
+        const int dim = Dim > 0 ? Dim : dim_rt;
+
+        const __m256d r_r = _mm256_set1_pd(R_R);
+
+        unsigned long int count=0, j=0;
+        for (; j+4<=n_pts; j+=4) {
+
+            __m256d val = _mm256_setzero_pd();
+            for (int i=0; i<dim; i++) {
+                const __m256d x = _mm256_loadu_pd(X[i] + j);
+                val = _mm256_add_pd(val, _mm256_mul_pd(x, x));
+            }
+            const int mask = _mm256_movemask_pd(_mm256_cmp_pd(val, r_r, _CMP_LT_OQ));
+            count += __builtin_popcount(mask);
+        }
+        //do the remainder one at a time
+        return count + count_inside_ball_scalar<Dim>(j, n_pts, dim, X, R_R);
+    }
+    //_______________________________________________________________________________
+    template<int Dim> __attribute__((target("avx2")))
+    unsigned long int count_inside_both_spheres_avx2(
+        const unsigned long int n_pts, const int dim_rt, const double* const* X,
+        const double R1_R1, const double R2_R2, const double sep
+    )
+    {
+        const int dim = Dim > 0 ? Dim : dim_rt;
+
+        const __m256d r1_r1 = _mm256_set1_pd(R1_R1);
+        const __m256d r2_r2 = _mm256_set1_pd(R2_R2);
+        const __m256d s     = _mm256_set1_pd(sep);
+
+        unsigned long int count=0, j=0;
+        for (; j+4<=n_pts; j+=4) {
+
+            __m256d val = _mm256_setzero_pd();
+            for (int i=0; i<dim; i++) {
+                const __m256d x = _mm256_loadu_pd(X[i] + j);
+                val = _mm256_add_pd(val, _mm256_mul_pd(x, x));
+            }
+            const __m256d x0   = _mm256_loadu_pd(X[0] + j);
+            const __m256d x0_s = _mm256_sub_pd(x0, s);
+            const __m256d val2 = _mm256_add_pd(val, _mm256_sub_pd(_mm256_mul_pd(x0_s, x0_s), _mm256_mul_pd(x0, x0)));
+
+            const __m256d inside = _mm256_and_pd(
+                _mm256_cmp_pd(val,  r1_r1, _CMP_LE_OQ),
+                _mm256_cmp_pd(val2, r2_r2, _CMP_LE_OQ)
+            );
+            count += __builtin_popcount(_mm256_movemask_pd(inside));
+        }
+        return count + count_inside_both_spheres_scalar<Dim>(j, n_pts, dim, X, R1_R1, R2_R2, sep);
+    }
+    //_______________________________________________________________________________
+    __attribute__((target("avx2")))
+    unsigned long int count_inside_both_spheres_given_val_avx2(
+        const unsigned long int n_pts, const double* val, const double* x0,
+        const double R1_R1, const double R2_R2, const double sep
+    )
+    {
+        const __m256d r1_r1 = _mm256_set1_pd(R1_R1);
+        const __m256d r2_r2 = _mm256_set1_pd(R2_R2);
+        const __m256d s     = _mm256_set1_pd(sep);
+
+        unsigned long int count=0, j=0;
+        for (; j+4<=n_pts; j+=4) {
+
+            const __m256d v    = _mm256_loadu_pd(val + j);
+            const __m256d x    = _mm256_loadu_pd(x0 + j);
+            const __m256d x_s  = _mm256_sub_pd(x, s);
+            const __m256d val2 = _mm256_add_pd(v, _mm256_sub_pd(_mm256_mul_pd(x_s, x_s), _mm256_mul_pd(x, x)));
+
+            const __m256d inside = _mm256_and_pd(
+                _mm256_cmp_pd(v,    r1_r1, _CMP_LE_OQ),
+                _mm256_cmp_pd(val2, r2_r2, _CMP_LE_OQ)
+            );
+            count += __builtin_popcount(_mm256_movemask_pd(inside));
+        }
+        return count + count_inside_both_spheres_given_val_scalar(j, n_pts, val, x0, R1_R1, R2_R2, sep);
+    }
+    //_______________________________________________________________________________
+    template<int Dim> __attribute__((target("avx512f")))
+    unsigned long int count_inside_ball_avx512(
+        const unsigned long int n_pts, const int dim_rt, const double* const* X, const double R_R
+    )
+    {
+        const int dim = Dim > 0 ? Dim : dim_rt;
+
+        const __m512d r_r = _mm512_set1_pd(R_R);
+
+        unsigned long int count=0, j=0;
+        for (; j+8<=n_pts; j+=8) {
+
+            __m512d val = _mm512_setzero_pd();
+            for (int i=0; i<dim; i++) {
+                const __m512d x = _mm512_loadu_pd(X[i] + j);
+                val = _mm512_add_pd(val, _mm512_mul_pd(x, x));
+            }
+            count += __builtin_popcount(_mm512_cmp_pd_mask(val, r_r, _CMP_LT_OQ));
+        }
+        return count + count_inside_ball_scalar<Dim>(j, n_pts, dim, X, R_R);
+    }
+    //_______________________________________________________________________________
+    template<int Dim> __attribute__((target("avx512f")))
+    unsigned long int count_inside_both_spheres_avx512(
+        const unsigned long int n_pts, const int dim_rt, const double* const* X,
+        const double R1_R1, const double R2_R2, const double sep
+    )
+    {
+        const int dim = Dim > 0 ? Dim : dim_rt;
+
+        const __m512d r1_r1 = _mm512_set1_pd(R1_R1);
+        const __m512d r2_r2 = _mm512_set1_pd(R2_R2);
+        const __m512d s     = _mm512_set1_pd(sep);
+
+        unsigned long int count=0, j=0;
+        for (; j+8<=n_pts; j+=8) {
+
+            __m512d val = _mm512_setzero_pd();
+            for (int i=0; i<dim; i++) {
+                const __m512d x = _mm512_loadu_pd(X[i] + j);
+                val = _mm512_add_pd(val, _mm512_mul_pd(x, x));
+            }
+            const __m512d x0   = _mm512_loadu_pd(X[0] + j);
+            const __m512d x0_s = _mm512_sub_pd(x0, s);
+            const __m512d val2 = _mm512_add_pd(val, _mm512_sub_pd(_mm512_mul_pd(x0_s, x0_s), _mm512_mul_pd(x0, x0)));
+
+            const __mmask8 inside = _mm512_cmp_pd_mask(val,  r1_r1, _CMP_LE_OQ)
+                                  & _mm512_cmp_pd_mask(val2, r2_r2, _CMP_LE_OQ);
+            count += __builtin_popcount(inside);
+        }
+        return count + count_inside_both_spheres_scalar<Dim>(j, n_pts, dim, X, R1_R1, R2_R2, sep);
+    }
+    //_______________________________________________________________________________
+    __attribute__((target("avx512f")))
+    unsigned long int count_inside_both_spheres_given_val_avx512(
+        const unsigned long int n_pts, const double* val, const double* x0,
+        const double R1_R1, const double R2_R2, const double sep
+    )
+    {
+        const __m512d r1_r1 = _mm512_set1_pd(R1_R1);
+        const __m512d r2_r2 = _mm512_set1_pd(R2_R2);
+        const __m512d s     = _mm512_set1_pd(sep);
+
+        unsigned long int count=0, j=0;
+        for (; j+8<=n_pts; j+=8) {
+
+            const __m512d v    = _mm512_loadu_pd(val + j);
+            const __m512d x    = _mm512_loadu_pd(x0 + j);
+            const __m512d x_s  = _mm512_sub_pd(x, s);
+            const __m512d val2 = _mm512_add_pd(v, _mm512_sub_pd(_mm512_mul_pd(x_s, x_s), _mm512_mul_pd(x, x)));
+
+            const __mmask8 inside = _mm512_cmp_pd_mask(v,    r1_r1, _CMP_LE_OQ)
+                                  & _mm512_cmp_pd_mask(val2, r2_r2, _CMP_LE_OQ);
+            count += __builtin_popcount(inside);
+        }
+        return count + count_inside_both_spheres_given_val_scalar(j, n_pts, val, x0, R1_R1, R2_R2, sep);
+    }
+    //_______________________________________________________________________________
+#endif
+
+    //_______________________________________________________________________________
+    template<int Dim> unsigned long int count_inside_ball_dim(
+        const unsigned long int n_pts, const int dim, const double* const* X, const double R_R
+    )
+    {
+#ifdef INTEGRATORS_HAVE_X86_SIMD
+        switch (get_simd_level()) {
+            case (kSimdAVX512)  : return count_inside_ball_avx512<Dim>(n_pts, dim, X, R_R);
+            case (kSimdAVX2)    : return count_inside_ball_avx2<Dim>(n_pts, dim, X, R_R);
+            default             : break;
+        }
+#endif
+        return count_inside_ball_scalar<Dim>(0, n_pts, dim, X, R_R);
+    }
+    //_______________________________________________________________________________
+    template<int Dim> unsigned long int count_inside_both_spheres_dim(
+        const unsigned long int n_pts, const int dim, const double* const* X,
+        const double R1_R1, const double R2_R2, const double sep
+    )
+    {
+#ifdef INTEGRATORS_HAVE_X86_SIMD
+        switch (get_simd_level()) {
+            case (kSimdAVX512)  : return count_inside_both_spheres_avx512<Dim>(n_pts, dim, X, R1_R1, R2_R2, sep);
+            case (kSimdAVX2)    : return count_inside_both_spheres_avx2<Dim>(n_pts, dim, X, R1_R1, R2_R2, sep);
+            default             : break;
+        }
+#endif
+        return count_inside_both_spheres_scalar<Dim>(0, n_pts, dim, X, R1_R1, R2_R2, sep);
+    }
+    //_______________________________________________________________________________
+    unsigned long int count_inside_both_spheres_given_val(
+        const unsigned long int n_pts, const double* val, const double* x0,
+        const double R1_R1, const double R2_R2, const double sep
+    )
+    {
+#ifdef INTEGRATORS_HAVE_X86_SIMD
+        switch (get_simd_level()) {
+            case (kSimdAVX512)  : return count_inside_both_spheres_given_val_avx512(n_pts, val, x0, R1_R1, R2_R2, sep);
+            case (kSimdAVX2)    : return count_inside_both_spheres_given_val_avx2(n_pts, val, x0, R1_R1, R2_R2, sep);
+            default             : break;
+        }
+#endif
+        return count_inside_both_spheres_given_val_scalar(0, n_pts, val, x0, R1_R1, R2_R2, sep);
+    }
+    //_______________________________________________________________________________
+}
+
+unsigned long int count_inside_ball(
+    const unsigned long int n_pts,
+    const int dim,
+    const double* const* X,
+    const double R_R
+)
+{
+    //use the unrolled kernel for this dimension, if there is one
+    unsigned long int count=0;
+    if (dispatch_dim(dim, [&](auto dim_c){ count = count_inside_ball_dim<decltype(dim_c)::value>(n_pts, dim, X, R_R); })) return count;
+
+    return count_inside_ball_dim<0>(n_pts, dim, X, R_R);
+}
+
+unsigned long int count_inside_both_spheres(
+    const unsigned long int n_pts,
+    const int dim,
+    const double* const* X,
+    const double R1_R1,
+    const double R2_R2,
+    const double sep
+)
+{
+    //use the unrolled kernel for this dimension, if there is one
+    unsigned long int count=0;
+    if (dispatch_dim(dim, [&](auto dim_c){ count = count_inside_both_spheres_dim<decltype(dim_c)::value>(n_pts, dim, X, R1_R1, R2_R2, sep); })) return count;
+
+    return count_inside_both_spheres_dim<0>(n_pts, dim, X, R1_R1, R2_R2, sep);
+}
+
+void count_inside_both_spheres_multi(
+    const unsigned long int n_pts,
+    const int dim,
+    const double* const* X,
+    const unsigned long int n_configs,
+    const double* R1_R1,
+    const double* R2_R2,
+    const double* sep,
+    unsigned long int* counts
+)
+{
+    //the points are done a (small) block at a time, so that |X|^2 of the block stays in the cache while
+    // every configuration is tested against it
+    constexpr unsigned long int kBlock = 256;
+    double val[kBlock];
+
+    for (unsigned long int j_block=0; j_block<n_pts; j_block += kBlock) {
+
+        const unsigned long int n_block = min<unsigned long int>( kBlock, n_pts - j_block );
+
+        //|X|^2, summed in the same order as the other kernels
+        fill_n(val, n_block, 0.);
+        for (int i=0; i<dim; i++) {
+            const double* x = X[i] + j_block;
+            for (unsigned long int j=0; j<n_block; j++) val[j] += x[j]*x[j];
+        }
+
+        for (unsigned long int k=0; k<n_configs; k++) {
+            counts[k] += count_inside_both_spheres_given_val(n_block, val, X[0] + j_block, R1_R1[k], R2_R2[k], sep[k]);
+        }
+    }
+}
+
+void inside_both_spheres_indicator(
+    const unsigned long int n_pts,
+    const int dim,
+    const double* const* X,
+    const double R1_R1,
+    const double R2_R2,
+    const double sep,
+    double* inside
+)
+{
+    //|X|^2 of each point (summed in the same order as the counting kernels, so the tests agree exactly)
+    fill_n(inside, n_pts, 0.);
+    for (int i=0; i<dim; i++) {
+        const double* x = X[i];
+        for (unsigned long int j=0; j<n_pts; j++) inside[j] += x[j]*x[j];
+    }
+
+    const double* x0 = X[0];
+    for (unsigned long int j=0; j<n_pts; j++) {
+
+        const double val  = inside[j];
+        const double val2 = val + ((( x0[j] - sep )*( x0[j] - sep )) - ( x0[j]*x0[j] ));
+
+        inside[j] = (val > R1_R1 || val2 > R2_R2) ? 0. : 1.;
+    }
+}
+
+void lens_chord_lengths(
+    const unsigned long int n_pts,
+    const int dim_perp,
+    const double* const* X,
+    const double R1_R1,
+    const double R2_R2,
+    const double sep,
+    double* length
+)
+{
+    //first, the (squared) distance of each point from the X[0]-axis
+    fill_n(length, n_pts, 0.);
+    for (int i=0; i<dim_perp; i++) {
+        const double* x = X[i];
+        for (unsigned long int j=0; j<n_pts; j++) length[j] += x[j]*x[j];
+    }
+
+    //each sphere cuts the line through the point (parallel to the X[0]-axis) in an interval of half-width
+    // sqrt(R^2 - rho^2), around the sphere's center. the chord is where the two intervals overlap.
+    for (unsigned long int j=0; j<n_pts; j++) {
+
+        const double h1 = sqrt( max<double>( 0., R1_R1 - length[j] ) );
+        const double h2 = sqrt( max<double>( 0., R2_R2 - length[j] ) );
+
+        length[j] = max<double>( 0., min<double>( h1, sep + h2 ) - max<double>( -h1, sep - h2 ) );
+    }
+}
\ No newline at end of file
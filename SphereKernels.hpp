@@ -0,0 +1,99 @@
+#ifndef SphereKernels_H
+#define SphereKernels_H
+
+// Batch 'sphere-membership' tests, meant to be used as the body of a BatchIntegrand_t.
+// The points are in structure-of-arrays layout (X[i][j] is the i-th coordinate of point j).
+// Each of these picks an AVX-512, AVX2 or scalar kernel at runtime (see SimdLevel.hpp); all
+// three give exactly the same answer.
+
+// counts how many of the points are strictly inside the ball of radius R centered at the origin,
+// i.e., |X|^2 < R_R
+unsigned long int count_inside_ball(
+    const unsigned long int n_pts,  //number of points in the block
+    const int dim,                  //number of coordinates of each point
+    const double* const* X,         //SoA block of points
+    const double R_R                //square of the radius of the ball
+);
+
+// counts how many of the points are inside both sphere 1 (radius R1, centered at the origin),
+// and sphere 2 (radius R2, centered at {sep,0,...,0}).
+unsigned long int count_inside_both_spheres(
+    const unsigned long int n_pts,  //number of points in the block
+    const int dim,                  //number of coordinates of each point
+    const double* const* X,         //SoA block of points
+    const double R1_R1,             //square of the radius of sphere 1
+    const double R2_R2,             //square of the radius of sphere 2
+    const double sep                //offset of sphere 2 along the X[0]-axis
+);
+
+// the same test as count_inside_both_spheres, for 'n_configs' pairs of spheres at once: counts[k] is increased
+// by the number of the points inside both spheres of configuration k. |X|^2 is found only once for each point,
+// and shared by all of the configurations. (this gives exactly the same counts as count_inside_both_spheres.)
+void count_inside_both_spheres_multi(
+    const unsigned long int n_pts,  //number of points in the block
+    const int dim,                  //number of coordinates of each point
+    const double* const* X,         //SoA block of points
+    const unsigned long int n_configs, //number of configurations
+    const double* R1_R1,            //square of the radius of sphere 1, for each configuration
+    const double* R2_R2,            //square of the radius of sphere 2, for each configuration
+    const double* sep,              //offset of sphere 2 along the X[0]-axis, for each configuration
+    unsigned long int* counts       //(output) counts[k] is increased by the number inside configuration k
+);
+
+// the length of the chord along the X[0]-axis which is inside both sphere 1 (radius R1, centered at the
+// origin) and sphere 2 (radius R2, centered at {sep,0,...,0}), for each point of a block of the OTHER
+// coordinates: X[i][j] is coordinate i+1 of point j. (this is written as a plain loop over the points,
+// which the compiler vectorizes.)
+void lens_chord_lengths(
+    const unsigned long int n_pts,  //number of points in the block
+    const int dim_perp,             //number of coordinates of each point (the dimension of the space, minus 1)
+    const double* const* X,         //SoA block of points, without their X[0]-coordinate
+    const double R1_R1,             //square of the radius of sphere 1
+    const double R2_R2,             //square of the radius of sphere 2
+    const double sep,               //offset of sphere 2 along the X[0]-axis
+    double* length                  //(output) length[j] is the length of the chord through point j
+);
+
+// the same test as count_inside_both_spheres, but for each point: inside[j] is 1 if point j is inside both
+// spheres, and 0 if not (for real-valued integrands which weight the region, by X[i] for example). this is
+// a plain loop too, and agrees exactly with count_inside_both_spheres.
+void inside_both_spheres_indicator(
+    const unsigned long int n_pts,  //number of points in the block
+    const int dim,                  //number of coordinates of each point
+    const double* const* X,         //SoA block of points
+    const double R1_R1,             //square of the radius of sphere 1
+    const double R2_R2,             //square of the radius of sphere 2
+    const double sep,               //offset of sphere 2 along the X[0]-axis
+    double* inside                  //(output) inside[j] is 1 if point j is inside both spheres, 0 if not
+);
+
+// One-point-at-a-time versions of the same tests, with the dimension fixed at compile time so the
+// loop over coordinates is unrolled. these are meant for the templated integrators, for example
+// MontecarloIntegrate<Dim>(n_pts, bounds, InsideBothSpheres<Dim>{R1*R1, R2*R2, sep}).
+
+template<int Dim> struct InsideBall {
+    double R_R{1.};
+
+    bool operator()(const double* X) const {
+        double val=0.;
+        for (int i=0; i<Dim; i++) val += X[i]*X[i];
+        return val < R_R;
+    }
+};
+
+template<int Dim> struct InsideBothSpheres {
+    double R1_R1{1.}, R2_R2{1.}, sep{0.};
+
+    bool operator()(const double* X) const {
+        double val=0.;
+        for (int i=0; i<Dim; i++) val += X[i]*X[i];
+
+        if (val > R1_R1) return false;
+
+        val += (( X[0] - sep )*( X[0] - sep )) - ( X[0]*X[0] );
+
+        return !(val > R2_R2);
+    }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "SphereOverlapAnalytic.hpp"
+#include "BallIntegrate.hpp"
+#include "BatchIntegrand.hpp"
+#include "ThreadPool.hpp"
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+    //below this x, I_x(p,1/2) is summed as a series; above it, it is found by recurrence (see below)
+    constexpr double kBetaSeriesMaxX = 0.9;
+
+    //the regularized incomplete beta fcn I_x(p, 1/2), for p = 1/2, 1, 3/2, 2, ...
+    //
+    // both ways use the same step, I_x(p+1, 1/2) = I_x(p, 1/2) - T(p), with T(p) = x^p sqrt(1-x) / (p B(p,1/2)),
+    // and T(p+1) = T(p) * x (p + 1/2)/(p + 1).
+    //  - for small x, I_x(p,1/2) is small, and is best found as the sum T(p) + T(p+1) + ... of positive terms,
+    //    which shrink at least as fast as x^k.
+    //  - for x close to 1 that series converges too slowly, but I_x(p,1/2) isn't small either, so we start from
+    //    the closed forms I_x(1/2,1/2) = (2/pi) asin(sqrt x), or I_x(1,1/2) = 1 - sqrt(1-x), and step up to p.
+    double incomplete_beta_half(const double p, const double x)
+    {
+        if (!(x > 0.)) return 0.;
+        if (!(x < 1.)) return 1.;
+
+        if (x < kBetaSeriesMaxX) {
+
+            double term = exp( p*log(x) + 0.5*log1p(-x) + lgamma(p + 0.5) - lgamma(p + 1.) - 0.5*log(M_PI) );
+            double sum  = 0.;
+            for (double k=p; term > 1e-17*sum; k += 1.) {
+                sum  += term;
+                term *= x*(k + 0.5)/(k + 1.);
+            }
+            return sum;
+        }
+
+        const bool half_whole = (fmod(p, 1.) != 0.);
+
+        double k    = half_whole ? 0.5 : 1.;
+        double I    = half_whole ? (2./M_PI)*asin(sqrt(x)) : 1. - sqrt(1. - x);
+        double term = half_whole ? (2./M_PI)*sqrt(x*(1. - x)) : 0.5*x*sqrt(1. - x);
+
+        for (; k < p; k += 1.) {
+            I    -= term;
+            term *= x*(k + 0.5)/(k + 1.);
+        }
+        return max<double>( I, 0. );
+    }
+}
+
+double sphere_cap_volume(const int dim, const double R, const double a)
+{
+    if (a <= -R) return ball_volume(dim, R);
+    if (a >=  R) return 0.;
+
+    //x = 1 - a^2/R^2, written so that it doesn't lose its precision for small caps (a close to R)
+    const double x   = ((R - fabs(a))*(R + fabs(a)))/(R*R);
+    const double cap = 0.5 * ball_volume(dim, R) * incomplete_beta_half(0.5*((double)dim + 1.), x);
+
+    return (a >= 0.) ? cap : ball_volume(dim, R) - cap;
+}
+
+double sphere_overlap_volume(const int dim, const double R1, const double R2, const double sep)
+{
+    if (dim < 1) {
+        throw invalid_argument("in <sphere_overlap_volume>: dimension must be at least 1, not "+to_string(dim)+".");
+    }
+    if (!(R1 > 0. && R2 > 0. && sep >= 0.)) {
+        throw invalid_argument("in <sphere_overlap_volume>: R1 and R2 must be positive, and sep must not be negative.");
+    }
+
+    //the spheres don't touch
+    if (sep >= R1 + R2) return 0.;
+
+    //one sphere is entirely inside the other
+    if (sep <= fabs(R1 - R2)) return ball_volume(dim, min<double>(R1, R2));
+
+    //the plane the two spheres meet in, along the x0-axis. the lens is the cap of sphere 1 beyond it, and the
+    // cap of sphere 2 before it (which is a distance sep - x_plane from its center).
+    const double x_plane = (sep*sep + (R1 - R2)*(R1 + R2))/(2.*sep);
+
+    return sphere_cap_volume(dim, R1, x_plane) + sphere_cap_volume(dim, R2, sep - x_plane);
+}
+
+void sphere_overlap_volume(
+    const unsigned long int n,      //number of configurations
+    const int* dim,                 //dimension of each
+    const double* R1,               //radius of sphere 1 of each
+    const double* R2,               //radius of sphere 2 of each
+    const double* sep,              //separation of the centers of each
+    double* vol,                    //(output) the overlap volume of each
+    const ExecutionPolicy_t& policy //threads (see ExecutionPolicy.hpp)
+)
+{
+    const unsigned long int n_chunks = (n + kBatchSize - 1) / kBatchSize;
+
+    //(each configuration takes up to a few hundred steps of the series, or dim/2 of the recurrence)
+    ThreadPool::Global().ParallelFor(n_chunks, [&](unsigned long int i_chunk, unsigned int)
+    {
+        const unsigned long int k_end = min<unsigned long int>( n, (i_chunk + 1)*kBatchSize );
+
+        for (unsigned long int k=i_chunk*kBatchSize; k<k_end; k++) vol[k] = sphere_overlap_volume(dim[k], R1[k], R2[k], sep[k]);
+
+    }, policy, (double)(kBatchSize * 100));
+}
\ No newline at end of file
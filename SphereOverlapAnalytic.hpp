@@ -0,0 +1,36 @@
+#ifndef SphereOverlapAnalytic_H
+#define SphereOverlapAnalytic_H
+
+#include "ExecutionPolicy.hpp"
+
+// The exact volume of the overlap of two n-balls, with no integration at all.
+//
+// The overlap is a 'lens': the plane through the circle where the two spheres meet cuts it into a cap
+// of each ball. The cap of a ball of radius R, beyond a plane at (signed) distance 'a' from its center, is
+//
+//  V_cap = V_ball(R) * 1/2 * I_x( (dim+1)/2, 1/2 ),    x = 1 - a^2/R^2     (for a >= 0)
+//
+// where I_x(p,q) is the regularized incomplete beta fcn. With q = 1/2 and p a whole or half-whole number,
+// I_x is an elementary fcn, which we get from a short recurrence (or series) in p.
+
+// the volume of the part of a ball (radius R, in 'dim' dimensions) which lies beyond a plane at (signed)
+// distance 'a' from its center. (a <= -R gives the whole ball; a >= R gives nothing.)
+double sphere_cap_volume(const int dim, const double R, const double a);
+
+// the volume of the overlap of sphere 1 (radius R1, centered at the origin) and sphere 2 (radius R2,
+// centered at {sep,0,...,0}), in 'dim' dimensions.
+double sphere_overlap_volume(const int dim, const double R1, const double R2, const double sep);
+
+// same as above, for 'n' configurations at once: vol[k] is the overlap for (dim[k], R1[k], R2[k], sep[k]).
+// the configurations are split between the threads of the pool (see ThreadPool.hpp).
+void sphere_overlap_volume(
+    const unsigned long int n,      //number of configurations
+    const int* dim,                 //dimension of each
+    const double* R1,               //radius of sphere 1 of each
+    const double* R2,               //radius of sphere 2 of each
+    const double* sep,              //separation of the centers of each
+    double* vol,                    //(output) the overlap volume of each
+    const ExecutionPolicy_t& policy={} //threads (see ExecutionPolicy.hpp)
+);
+
+#endif
\ No newline at end of file
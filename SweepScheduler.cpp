@@ -0,0 +1,64 @@
+#include "SweepScheduler.hpp"
+#include "ThreadPool.hpp"
+#include <atomic>
+#include <numeric>
+#include <algorithm>
+
+using namespace std;
+
+void RunSweep(
+    const vector<SweepJob_t>& jobs,
+    const ExecutionPolicy_t& policy //threads (see ExecutionPolicy.hpp)
+)
+{
+    if (jobs.empty()) return;
+
+    //the order the jobs are taken in: most expensive first (and in the order given, for equal costs)
+    vector<size_t> order(jobs.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&jobs](size_t a, size_t b){ return jobs[a].cost > jobs[b].cost; });
+
+    auto& pool = ThreadPool::Global();
+
+    const unsigned int n_threads = (policy.n_threads == 0) ? pool.NumThreads() : min<unsigned int>(policy.n_threads, pool.NumThreads());
+
+    double total_cost = accumulate(jobs.begin(), jobs.end(), 0., [](double sum, const SweepJob_t& job){ return sum + job.cost; });
+
+    //a job which costs more than the whole sweep should take per thread would hold up the end of the sweep on 
+    // its own, with the other threads idle. (with fewer jobs than threads, that's all of them.) so these run 
+    // first, one at a time, and the integrals inside them split themselves between all of the threads as 
+    // usual. (they can't be told how many threads to use, so this is only done if the sweep may use them all.) 
+    size_t n_solo = 0;
+    if (n_threads == pool.NumThreads() && n_threads > 1) {
+
+        if (policy.affinity != kAffinityKeep) pool.SetAffinity(policy.affinity);
+
+        while (n_solo < order.size() && jobs[order[n_solo]].cost * n_threads > total_cost) {
+            jobs[order[n_solo]].run();
+            total_cost -= jobs[order[n_solo]].cost;
+            n_solo++;
+        }
+    }
+    if (n_solo == jobs.size()) return;
+
+    //the rest run side by side, one per thread: one 'chunk' per thread, each of which keeps taking the next job 
+    // from the (shared) queue. (the pool's own split of the chunks into ranges would hand all of the most 
+    // expensive jobs to the same thread.)
+    const unsigned int n_runners = min<unsigned long int>( jobs.size() - n_solo, n_threads );
+
+    atomic<size_t> next_job{n_solo};
+    atomic<bool>   abort{false};
+
+    pool.ParallelFor(n_runners, [&](unsigned long int, unsigned int)
+    {
+        for (size_t k = next_job++; k < jobs.size() && !abort.load(); k = next_job++) {
+            try {
+                jobs[order[k]].run();
+            } catch (...) {
+                abort = true;
+                throw;
+            }
+        }
+
+    }, policy, total_cost/n_runners);
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef SweepScheduler_H
+#define SweepScheduler_H
+
+#include <functional>
+#include <vector>
+#include "ExecutionPolicy.hpp"
+
+// A scheduler for parameter 'sweeps': a whole grid of independent integrals (one for each dimension,
+// number of points, method and trial, say), which are run side by side on the thread pool (see
+// ThreadPool.hpp), rather than one after the other with each split between the threads.
+//
+// Most of the jobs of a sweep are far too small to fill a machine on their own, so each job runs on a
+// single thread (any ParallelFor inside a job runs serially; see ThreadPool.hpp), and the threads take the
+// jobs from a shared queue, the most expensive first. That way the big jobs don't end up at the back of
+// the queue, with all but one thread left idle waiting for them.
+//
+// A job which costs more than the whole sweep's share per thread (total cost / number of threads) would
+// still hold everyone up on a single thread; and when there are fewer jobs than threads, every job does.
+// So those jobs are run first, one at a time, with the integrals inside them free to use all of the pool's
+// threads; only the rest are run side by side. (this needs the whole pool: with policy.n_threads below
+// the pool's size, every job runs on a single thread, as the integrals inside them can't be capped.)
+//
+// for example:
+//
+//  vector<double> vols(dims.size());
+//  vector<SweepJob_t> jobs;
+//  for (size_t k=0; k<dims.size(); k++) {
+//      jobs.push_back({ (double)(n_pts * dims[k]), [&, k]{ vols[k] = compute_sphere_overlap(dims[k], n_pts, ...).val; } });
+//  }
+//  RunSweep(jobs);
+//
+struct SweepJob_t {
+    double cost;                    //rough estimate of the cost of the job (for example, points*dimensions)
+    std::function<void()> run;      //does the job, and stores its result wherever it needs to go
+};
+
+// runs all of the jobs, and returns once they are done. if any job throws, the jobs which haven't started
+// yet are abandoned, and the (first) exception is rethrown here.
+void RunSweep(
+    const std::vector<SweepJob_t>& jobs,
+    const ExecutionPolicy_t& policy={} //threads (see ExecutionPolicy.hpp)
+);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,310 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <fstream>
+#include <sstream>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+namespace {
+    //true while this thread is running chunks of a job (always true for the pool's own workers).
+    // a ParallelFor() called from inside a job just runs serially, so that nested parallel code
+    // (an integrator called from inside a parallel sweep, for example) can't deadlock the pool.
+    thread_local bool tl_in_job = false;
+
+#ifdef __linux__
+    //reads a list of cpus like '0-3,8-11' (the format the kernel uses)
+    vector<int> parse_cpu_list(const string& list)
+    {
+        vector<int> cpus;
+        stringstream ss(list);
+        string range;
+        while (getline(ss, range, ',')) {
+            if (range.empty()) continue;
+            const size_t dash = range.find('-');
+            const int first = stoi(range.substr(0, dash));
+            const int last  = (dash == string::npos) ? first : stoi(range.substr(dash + 1));
+            for (int cpu=first; cpu<=last; cpu++) cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+
+    //the cpus we're allowed to use, split up by NUMA node. (if the kernel doesn't tell us about the
+    // nodes, they all go into one.)
+    vector<vector<int>> allowed_cpus_by_node(const cpu_set_t& allowed)
+    {
+        vector<vector<int>> nodes;
+        vector<bool> placed(CPU_SETSIZE, false);
+
+        for (int node=0; node<256; node++) {
+            ifstream file("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+            if (!file) continue;
+
+            string list;
+            getline(file, list);
+
+            vector<int> cpus;
+            for (int cpu : parse_cpu_list(list)) {
+                if (cpu < 0 || cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed) || placed[cpu]) continue;
+                cpus.push_back(cpu);
+                placed[cpu] = true;
+            }
+            if (!cpus.empty()) nodes.push_back(cpus);
+        }
+
+        //anything the nodes didn't mention
+        vector<int> rest;
+        for (int cpu=0; cpu<CPU_SETSIZE; cpu++) if (CPU_ISSET(cpu, &allowed) && !placed[cpu]) rest.push_back(cpu);
+        if (!rest.empty()) nodes.push_back(rest);
+
+        return nodes;
+    }
+
+    //the order in which the pool's threads are given cpus
+    vector<int> cpu_placement(const ThreadAffinity_t affinity, const cpu_set_t& allowed)
+    {
+        const vector<vector<int>> nodes = allowed_cpus_by_node(allowed);
+
+        vector<int> cpus;
+        if (affinity == kAffinitySpread) {
+            //one from each node in turn
+            for (size_t j=0; cpus.size() < (size_t)CPU_COUNT(&allowed); j++) {
+                for (const auto& node : nodes) if (j < node.size()) cpus.push_back(node[j]);
+            }
+        } else {
+            //one node after the other
+            for (const auto& node : nodes) cpus.insert(cpus.end(), node.begin(), node.end());
+        }
+        return cpus;
+    }
+#endif
+}
+
+//_______________________________________________________________________________
+ThreadPool& ThreadPool::Global()
+{
+    static ThreadPool pool( []{
+        //(the environment variable, if it's set, overrides the number of hardware threads)
+        const char* n_threads = getenv(kThreadsEnvVar);
+        if (n_threads && atoi(n_threads) > 0) return (unsigned int)atoi(n_threads);
+        return max<unsigned int>(1, thread::hardware_concurrency());
+    }() );
+    return pool;
+}
+//_______________________________________________________________________________
+ThreadPool::ThreadPool(const unsigned int n_threads)
+    : fNThreads(max<unsigned int>(1, n_threads))
+{
+    //the calling thread counts as thread 0, so we only need n-1 workers
+    for (unsigned int t=1; t<fNThreads; t++) fWorkers.emplace_back([this, t]{ WorkerLoop(t); });
+}
+//_______________________________________________________________________________
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(fMutex);
+        fStop = true;
+    }
+    fWakeWorkers.notify_all();
+    for (auto& worker : fWorkers) worker.join();
+}
+//_______________________________________________________________________________
+bool ThreadPool::SetAffinity(const ThreadAffinity_t affinity)
+{
+    if (affinity == kAffinityKeep) return true;
+
+    lock_guard<mutex> lock(fAffinityMutex);
+
+#ifdef __linux__
+    //the cpus this process may run on (the calling thread is never pinned by us, so its mask is the process's)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return false;
+
+    const vector<int> cpus = cpu_placement(affinity, allowed);
+    if (cpus.empty()) return false;
+
+    bool ok=true;
+    for (unsigned int t=1; t<fNThreads; t++) {
+
+        cpu_set_t set = allowed;
+        if (affinity != kAffinityNone) {
+            //(cpus[0] is left for the calling thread; if there are more threads than cpus, they wrap around)
+            CPU_ZERO(&set);
+            CPU_SET(cpus[t % cpus.size()], &set);
+        }
+        ok &= (pthread_setaffinity_np(fWorkers[t-1].native_handle(), sizeof(set), &set) == 0);
+    }
+
+    if (ok) fAffinity = affinity;
+    return ok;
+#else
+    return false;
+#endif
+}
+//_______________________________________________________________________________
+unsigned int ThreadPool::ThreadsForJob(const unsigned long int n_chunks, const unsigned int n_threads, const double work_per_chunk) const
+{
+    unsigned int threads = (n_threads == 0) ? fNThreads : min<unsigned int>(n_threads, fNThreads);
+
+    const double total_work = ((double)n_chunks) * work_per_chunk;
+
+    //too small to be worth waking anyone up
+    if (total_work < kInlineWork) return 1;
+
+    //only use as many threads as can each get a decent amount of work
+    const double max_by_work = max<double>(1., total_work / kMinWorkPerThread);
+    if (max_by_work < (double)threads) threads = (unsigned int)max_by_work;
+
+    if (n_chunks < (unsigned long int)threads) threads = (unsigned int)n_chunks;
+
+    return max<unsigned int>(1, threads);
+}
+//_______________________________________________________________________________
+void ThreadPool::ParallelFor(
+    const unsigned long int n_chunks,
+    const function<void(unsigned long int, unsigned int)>& fcn,
+    const ExecutionPolicy_t& policy,
+    const double work_per_chunk
+)
+{
+    if (n_chunks == 0) return;
+
+    //(a nested call doesn't get a say in where the threads are: they're busy with the outer call)
+    if (!tl_in_job && policy.affinity != kAffinityKeep && policy.affinity != fAffinity.load()) SetAffinity(policy.affinity);
+
+    const unsigned int n_participants = tl_in_job ? 1 : ThreadsForJob(n_chunks, policy.n_threads, work_per_chunk);
+
+    //small (or nested) jobs are just run right here
+    if (n_participants == 1) {
+        for (unsigned long int i=0; i<n_chunks; i++) fcn(i, 0);
+        return;
+    }
+
+    lock_guard<mutex> submit_lock(fSubmitMutex);
+
+    Job_t job;
+    job.fcn            = &fcn;
+    job.n_participants = n_participants;
+    job.ranges         = unique_ptr<ChunkRange_t[]>(new ChunkRange_t[n_participants]);
+
+    //give each participant an (as close to) equal, contiguous range of the chunks
+    for (unsigned int t=0; t<n_participants; t++) {
+        job.ranges[t].begin = (n_chunks * t)     / n_participants;
+        job.ranges[t].end   = (n_chunks * (t+1)) / n_participants;
+    }
+
+    {
+        lock_guard<mutex> lock(fMutex);
+        fJob = &job;
+        fJobGeneration++;
+    }
+    fWakeWorkers.notify_all();
+
+    //the calling thread is participant 0
+    tl_in_job = true;
+    RunJob(job, 0);
+    tl_in_job = false;
+
+    //wait for everyone else to finish
+    {
+        unique_lock<mutex> lock(fMutex);
+        fJobDone.wait(lock, [&job]{ return job.n_finished.load() == job.n_participants; });
+        fJob = nullptr;
+    }
+
+    if (job.error) rethrow_exception(job.error);
+}
+//_______________________________________________________________________________
+void ThreadPool::WorkerLoop(const unsigned int i_thread)
+{
+    tl_in_job = true;
+
+    unsigned long int generation_seen = 0;
+
+    while (1) {
+
+        Job_t* job = nullptr;
+        {
+            unique_lock<mutex> lock(fMutex);
+            fWakeWorkers.wait(lock, [&]{ return fStop || (fJob != nullptr && fJobGeneration != generation_seen); });
+
+            if (fStop) return;
+
+            generation_seen = fJobGeneration;
+
+            //not every job uses every thread. (this has to be checked while we hold the lock: if we
+            // aren't a participant, the job can finish, and be destroyed, without waiting for us.)
+            if (i_thread < fJob->n_participants) job = fJob;
+        }
+
+        if (job) RunJob(*job, i_thread);
+    }
+}
+//_______________________________________________________________________________
+void ThreadPool::RunJob(Job_t& job, const unsigned int i_thread)
+{
+    unsigned long int i_chunk;
+
+    while (!job.abort.load(memory_order_relaxed) && NextChunk(job, i_thread, i_chunk)) {
+
+        try {
+            (*job.fcn)(i_chunk, i_thread);
+        } catch (...) {
+            lock_guard<mutex> lock(job.error_mutex);
+            if (!job.error) job.error = current_exception();
+            job.abort = true;
+        }
+    }
+
+    //the last one out lets the caller know we're done. (once n_finished is incremented, the job may
+    // be destroyed at any moment, so don't touch it after that.)
+    const unsigned int n_participants = job.n_participants;
+    if (job.n_finished.fetch_add(1) + 1 == n_participants) {
+        lock_guard<mutex> lock(fMutex);
+        fJobDone.notify_all();
+    }
+}
+//_______________________________________________________________________________
+bool ThreadPool::NextChunk(Job_t& job, const unsigned int i_thread, unsigned long int& i_chunk)
+{
+    //first, try our own range
+    {
+        auto& own = job.ranges[i_thread];
+        lock_guard<mutex> lock(own.mutex);
+        if (own.begin < own.end) { i_chunk = own.begin++; return true; }
+    }
+
+    //we're out of work; steal the back half of someone else's range
+    for (unsigned int k=1; k<job.n_participants; k++) {
+
+        auto& victim = job.ranges[(i_thread + k) % job.n_participants];
+
+        unsigned long int steal_begin, steal_end;
+        {
+            lock_guard<mutex> lock(victim.mutex);
+            if (victim.begin >= victim.end) continue;
+
+            steal_begin = victim.begin + (victim.end - victim.begin)/2;
+            steal_end   = victim.end;
+            victim.end  = steal_begin;
+        }
+
+        //keep the first stolen chunk to run now, and put the rest in our own range
+        auto& own = job.ranges[i_thread];
+        lock_guard<mutex> lock(own.mutex);
+        own.begin = steal_begin + 1;
+        own.end   = steal_end;
+
+        i_chunk = steal_begin;
+        return true;
+    }
+
+    return false;
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+#ifndef ThreadPool_H
+#define ThreadPool_H
+
+#include <functional>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <exception>
+#include "ExecutionPolicy.hpp"
+
+// A process-wide pool of worker threads, which all of the integrators share, so that we don't
+// create (and join) a fresh set of std::threads on every call.
+//
+// Work is handed to the pool as a number of 'chunks' (see ParallelFor). The chunk indices are
+// first split into one contiguous range per participating thread; once a thread runs out of its
+// own chunks, it steals half of what is left from another thread's range. The calling thread
+// takes part in the work too, so a pool of N threads has N-1 workers.
+//
+// The workers can be pinned to cpus (see ExecutionPolicy.hpp). worker t gets the t-th cpu of the
+// placement, and the 0-th is left free for the calling thread (which isn't pinned, since it belongs to
+// whoever called us). since a thread out of work steals from its neighbours first, pinning them in
+// order keeps most of the stealing inside one NUMA node.
+//
+// for example:
+//
+//  vector<unsigned long int> counts(n_chunks);
+//  ThreadPool::Global().ParallelFor(n_chunks, [&](unsigned long int i_chunk, unsigned int i_thread) {
+//      counts[i_chunk] = ...;
+//  });
+//
+class ThreadPool {
+public:
+
+    // jobs whose total estimated cost (n_chunks * work_per_chunk) is below this are simply run on the
+    // calling thread, since waking up the workers would cost more than it saves.
+    static constexpr double kInlineWork = 2e5;
+
+    // we only hand a job to as many threads as can each get at least this much work
+    static constexpr double kMinWorkPerThread = 5e4;
+
+    // the pool used by all integrators. it is created, with std::thread::hardware_concurrency()
+    // threads, the first time it is asked for. (if the environment variable INTEGRATORS_THREADS
+    // is set, it has that many threads instead.)
+    static ThreadPool& Global();
+
+    static constexpr const char* kThreadsEnvVar = "INTEGRATORS_THREADS";
+
+    explicit ThreadPool(const unsigned int n_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //number of threads in the pool (including the calling thread)
+    unsigned int NumThreads() const { return fNThreads; }
+
+    // runs fcn(i_chunk, i_thread) for every i_chunk in [0, n_chunks), and returns once all of them are done.
+    //  - i_thread is in [0, number of threads used), so it can be used to index per-thread state.
+    //  - policy.n_threads caps the number of threads used (0 means 'all of them'). if the policy asks for
+    //    a different affinity, the workers are re-pinned first (unless this is a nested call).
+    //  - work_per_chunk is a rough estimate of the cost of one chunk (for example, points*dimensions),
+    //    used to decide how many threads are worth waking up.
+    // if 'fcn' throws, the remaining chunks are abandoned, and the (first) exception is rethrown here.
+    // calls made from inside a running job (nested calls) run serially on the calling thread.
+    void ParallelFor(
+        const unsigned long int n_chunks,
+        const std::function<void(unsigned long int, unsigned int)>& fcn,
+        const ExecutionPolicy_t& policy={},
+        const double work_per_chunk=kInlineWork
+    );
+
+    //how many threads a job of this size would use (1 means it would be run inline)
+    unsigned int ThreadsForJob(const unsigned long int n_chunks, const unsigned int n_threads, const double work_per_chunk) const;
+
+    //pins (or unpins) the workers. kAffinityKeep does nothing. returns false if the OS wouldn't let us
+    // (or if pinning isn't supported here). it's safe to call at any time, even while a job is running.
+    bool SetAffinity(const ThreadAffinity_t affinity);
+
+    //the affinity the workers currently have (kAffinityNone, unless SetAffinity has been called)
+    ThreadAffinity_t Affinity() const { return fAffinity.load(); }
+
+private:
+
+    //the range of chunks [begin, end) still owned by one participating thread. aligned to a cache
+    // line, so that threads updating their own ranges don't fight over the same line.
+    struct alignas(64) ChunkRange_t {
+        std::mutex mutex;
+        unsigned long int begin{0}, end{0};
+    };
+
+    struct Job_t {
+        const std::function<void(unsigned long int, unsigned int)>* fcn{nullptr};
+        unsigned int n_participants{0};
+        std::unique_ptr<ChunkRange_t[]> ranges;
+        std::atomic<unsigned int> n_finished{0};
+        std::atomic<bool> abort{false};
+        std::exception_ptr error;
+        std::mutex error_mutex;
+    };
+
+    void WorkerLoop(const unsigned int i_thread);
+
+    //run (and steal) chunks of the current job until there are none left
+    void RunJob(Job_t& job, const unsigned int i_thread);
+
+    //take the next chunk from our own range, or steal from someone else's. returns false if there are none left.
+    bool NextChunk(Job_t& job, const unsigned int i_thread, unsigned long int& i_chunk);
+
+    const unsigned int fNThreads;
+    std::vector<std::thread> fWorkers;
+
+    std::mutex fAffinityMutex;
+    std::atomic<ThreadAffinity_t> fAffinity{kAffinityNone};
+
+    //only one job at a time is run by the pool
+    std::mutex fSubmitMutex;
+
+    std::mutex fMutex;
+    std::condition_variable fWakeWorkers;
+    std::condition_variable fJobDone;
+    Job_t* fJob{nullptr};
+    unsigned long int fJobGeneration{0};
+    bool fStop{false};
+};
+
+#endif
\ No newline at end of file
@@ -2,13 +2,20 @@
 #define ValueWithError_H
 
 #include <limits> 
+#include <memory> 
+
+struct RunTelemetry_t; 
 
 // A very simple struct which returns a value with an error, which can be 
-// implicitly converted to type 'T'.
+// implicitly converted to type 'T'. 
+//
+// if the integrator's instrumentation was on, 'telemetry' holds the record of the run (see RunTelemetry.hpp). 
 
 template<typename T> struct ValueWithError_t { 
     T val  {std::numeric_limits<double>::quiet_NaN()}; 
     T error{std::numeric_limits<double>::quiet_NaN()}; 
+
+    std::shared_ptr<const RunTelemetry_t> telemetry{}; 
     
     operator T() const { return val; }
 };
@@ -0,0 +1,289 @@
+#include "VegasIntegrate.hpp"
+#include "ThreadPool.hpp"
+#include "PhiloxRandom.hpp"
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+    //how strongly the bins are moved towards where the fcn is large, after each iteration. (the usual
+    // choice is between 1 and 2; smaller is more cautious.)
+    constexpr double kVegasAlpha = 1.5;
+
+    //share of each axis' sampling density which stays uniform, however the bins are trained. (without it, an
+    // inside/outside fcn which only a handful of the first points hit can pull the bins in around just those
+    // points, after which the rest of the region is hardly ever sampled.)
+    constexpr double kVegasUniformFraction = 0.2;
+
+    //what one chunk of points contributes to an iteration
+    struct VegasTally_t {
+        double sum_w{0.}, sum_w2{0.};               //sum of the weights (fcn * jacobian * volume), and of their squares
+        vector<double> d;                           //d[i*kVegasBins + b] is the sum of w^2 of the points in bin b of axis i
+    };
+
+    //moves the bin edges of one axis (edges[0] = 0, ..., edges[kVegasBins] = 1, in units of the bounds), so
+    // that the bins with the largest share of 'd_in' get narrower. this is Lepage's prescription: smooth d
+    // over neighboring bins, damp it, and then lay out new bins which each get an equal share of it. the
+    // density this gives is then mixed with the uniform one (see kVegasUniformFraction), so that no bin is
+    // ever narrower than kVegasUniformFraction of a uniform one.
+    void refine_axis(double* edges, const double* d_in)
+    {
+        constexpr int B = kVegasBins;
+
+        double d[B];
+        d[0]   = (d_in[0]   + d_in[1])  /2.;
+        d[B-1] = (d_in[B-2] + d_in[B-1])/2.;
+        for (int b=1; b<B-1; b++) d[b] = (d_in[b-1] + d_in[b] + d_in[b+1])/3.;
+
+        double d_sum=0.;
+        for (int b=0; b<B; b++) d_sum += d[b];
+        if (!(d_sum > 0.)) return;
+
+        double r[B], r_sum=0.;
+        for (int b=0; b<B; b++) {
+            const double x = d[b]/d_sum;
+            r[b] = (x > 0. && x < 1.) ? pow( (x - 1.)/log(x), kVegasAlpha ) : (x >= 1. ? 1. : 0.);
+            r_sum += r[b];
+        }
+        if (!(r_sum > 0.)) return;
+
+        //each old bin gets its share of the trained density, plus its width's share of the uniform one
+        for (int b=0; b<B; b++) r[b] = (1. - kVegasUniformFraction)*r[b]/r_sum + kVegasUniformFraction*(edges[b+1] - edges[b]);
+        r_sum = 1.;
+
+        const double r_per_bin = r_sum / B;
+
+        double new_edges[B+1];
+        new_edges[0] = 0.;
+        new_edges[B] = 1.;
+
+        int i_new=1;
+        double r_acc=0., x_lo=0., x_hi=0.;
+        for (int b=0; b<B && i_new<B; b++) {
+
+            r_acc += r[b];
+            x_lo   = x_hi;
+            x_hi   = edges[b+1];
+
+            while (r_acc > r_per_bin && i_new<B) {
+                r_acc -= r_per_bin;
+                new_edges[i_new++] = x_hi - (x_hi - x_lo)*r_acc/r[b];
+            }
+        }
+        for (; i_new<B; i_new++) new_edges[i_new] = 1.;
+
+        copy(new_edges, new_edges + B+1, edges);
+    }
+
+    //the whole algorithm. 'eval_block(n_block, X, f)' writes the value of the fcn at each point of a (SoA)
+    // block of points (each chunk of points works with its own copy of it).
+    template<typename EvalBlock> ValueWithError_t<double> vegas_integrate(
+        const unsigned long int n_pts,
+        const vector<IntegrationBound_t>& bounds,
+        const EvalBlock& eval_block,
+        const int n_iterations,
+        const optional<uint64_t> seed,
+        const ExecutionPolicy_t& policy
+    )
+    {
+        //dimension of the space we're integrating in
+        const int dim = (int)bounds.size();
+
+        if (n_iterations < 1) {
+            throw invalid_argument("in <VegasIntegrate>: n_iterations must be at least 1.");
+        }
+
+        const unsigned long int n_iter_pts = n_pts / (unsigned long int)n_iterations;
+        if (n_iter_pts < 2) {
+            throw invalid_argument("in <VegasIntegrate>: need at least 2 points per iteration.");
+        }
+
+        const uint64_t stream_seed = Philox::ResolveSeed(seed);
+
+        double total_vol{1.};
+        for (auto bound : bounds) total_vol *= (bound.xmax - bound.xmin);
+
+        //the bin edges of each axis, in units of its bounds (0 = xmin, 1 = xmax): edges[i*(kVegasBins+1) + b].
+        // we start out with all the bins the same width.
+        vector<double> edges(dim * (kVegasBins+1));
+        for (int i=0; i<dim; i++) {
+            for (int b=0; b<=kVegasBins; b++) edges[i*(kVegasBins+1) + b] = ((double)b)/((double)kVegasBins);
+        }
+
+        //the uniform random numbers which are mapped through the bins
+        const vector<IntegrationBound_t> unit_bounds(dim, IntegrationBound_t{0., 1.});
+
+        const unsigned long int n_chunks = (n_iter_pts + kChunkSize - 1) / kChunkSize;
+
+        //only the iterations from this one on go into the result
+        const int n_first_used = n_iterations/2;
+
+        //the estimates, and variances, of the iterations which go into the result
+        vector<double> iter_vals, iter_vars;
+
+        for (int i_iter=0; i_iter<n_iterations; i_iter++) {
+
+            vector<VegasTally_t> chunk_tallies(n_chunks);
+
+            ThreadPool::Global().ParallelFor(n_chunks, [&](unsigned long int i_chunk, unsigned int)
+            {
+                const unsigned long int n_chunk_pts = min<unsigned long int>( kChunkSize, n_iter_pts - i_chunk*kChunkSize );
+
+                auto chunk_eval = eval_block;
+
+                //(filled in here, and moved into chunk_tallies at the end: the tallies of neighbouring chunks share
+                // cache lines, and every point in the region adds to sum_w and sum_w2)
+                VegasTally_t tally;
+                tally.d.assign(dim * kVegasBins, 0.);
+
+                //block of points (SoA): first the uniform random numbers, which are then mapped (in place) onto the bins
+                vector<double> block(dim * kBatchSize);
+                vector<double*> U(dim);
+                for (int i=0; i<dim; i++) U[i] = block.data() + i*kBatchSize;
+
+                vector<int>    bins(dim * kBatchSize);
+                vector<double> jacobian(kBatchSize);
+                vector<double> f(kBatchSize);
+
+                unsigned long int n_done=0;
+                while (n_done < n_chunk_pts) {
+
+                    const unsigned long int n_block = min<unsigned long int>( kBatchSize, n_chunk_pts - n_done );
+
+                    const uint64_t first_pt = ((uint64_t)i_iter)*n_iter_pts + i_chunk*kChunkSize + n_done;
+                    philox_fill_block(stream_seed, first_pt, n_block, unit_bounds, U.data());
+
+                    fill_n(jacobian.begin(), n_block, total_vol);
+
+                    //pick a bin (each is equally likely), and a uniform point inside it
+                    for (int i=0; i<dim; i++) {
+
+                        const double* e = edges.data() + i*(kVegasBins+1);
+                        double* u       = U[i];
+                        int* bin        = bins.data() + i*kBatchSize;
+
+                        for (unsigned long int j=0; j<n_block; j++) {
+
+                            const double z = u[j] * kVegasBins;
+                            const int    b = min<int>( (int)z, kVegasBins-1 );
+                            const double w = e[b+1] - e[b];
+
+                            u[j]         = e[b] + (z - (double)b)*w;
+                            jacobian[j] *= kVegasBins * w;
+                            bin[j]       = b;
+                        }
+                    }
+
+                    //from units of the bounds to the points themselves, and then the fcn at all of them at once
+                    for (int i=0; i<dim; i++) {
+                        double* u = U[i];
+                        for (unsigned long int j=0; j<n_block; j++) u[j] = bounds[i].xmin + (bounds[i].xmax - bounds[i].xmin)*u[j];
+                    }
+                    chunk_eval(n_block, (const double* const*)U.data(), f.data());
+
+                    for (unsigned long int j=0; j<n_block; j++) {
+
+                        if (f[j] == 0.) continue;
+
+                        const double w = jacobian[j]*f[j];
+                        tally.sum_w  += w;
+                        tally.sum_w2 += w*w;
+                        for (int i=0; i<dim; i++) tally.d[i*kVegasBins + bins[i*kBatchSize + j]] += w*w;
+                    }
+
+                    n_done += n_block;
+                }
+                chunk_tallies[i_chunk] = move(tally);
+
+            }, policy, (double)(kChunkSize * dim));
+
+            //add up the chunks (always in the same order, so the result doesn't depend on the threads)
+            double sum_w{0.}, sum_w2{0.};
+            vector<double> d(dim * kVegasBins, 0.);
+            for (const auto& tally : chunk_tallies) {
+                sum_w  += tally.sum_w;
+                sum_w2 += tally.sum_w2;
+                for (int k=0; k<dim*kVegasBins; k++) d[k] += tally.d[k];
+            }
+
+            const double n      = (double)n_iter_pts;
+            const double val    = sum_w / n;
+            const double var    = max<double>( 0., (sum_w2/n - val*val) / (n - 1.) );
+
+            //the first half of the iterations only train the bins. 
+            if (i_iter >= n_first_used) {
+                iter_vals.push_back(val);
+                iter_vars.push_back(var);
+            }
+
+            //move the bins for the next iteration
+            if (i_iter+1 < n_iterations) {
+                for (int i=0; i<dim; i++) refine_axis(edges.data() + i*(kVegasBins+1), d.data() + i*kVegasBins);
+            }
+        }
+
+        //the iterations which are used all count the same. (weighting them by the inverse of their variances, 
+        // as the textbook does, pulls an inside/outside fcn's result down: an iteration which happens to find 
+        // fewer points inside also finds a smaller variance, so it gets more weight.) 
+        const int n_used = (int)iter_vals.size();
+
+        double val{0.}, var{0.};
+        for (int k=0; k<n_used; k++) { val += iter_vals[k]; var += iter_vars[k]; }
+        val /= n_used;
+        var /= (double)n_used*(double)n_used;
+
+        //if the iterations disagree with each other by more than their errors say they should (chi^2 per degree 
+        // of freedom > 1), some of them must have missed part of the region, so their errors are too small: the 
+        // error is scaled up by sqrt(chi^2/dof). (an iteration with no spread at all, no points inside say, has 
+        // nothing to say about this.) 
+        double chi2{0.};
+        int dof = -1;
+        for (int k=0; k<n_used; k++) {
+            if (iter_vars[k] > 0.) { chi2 += (iter_vals[k] - val)*(iter_vals[k] - val)/iter_vars[k]; dof++; }
+        }
+        if (dof > 0 && chi2 > dof) var *= chi2/dof;
+
+        //if no iteration found any spread at all (the fcn was 0 at every point, say), the error is what a single 
+        // point with the fcn = 1 would have added: the region may still be there, too small to be hit. 
+        if (!(var > 0.)) var = pow( total_vol / ((double)n_used * (double)n_iter_pts), 2 );
+
+        return ValueWithError_t<double>{ val, sqrt(var) };
+    }
+}
+//_______________________________________________________________________________
+ValueWithError_t<double> VegasIntegrate(
+    const unsigned long int n_pts,                  //total number of points to use, over all iterations
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.
+    std::function<bool(const double*)> fcn,         //fcn to integrate. returns TRUE if inside region, FALSE if not.
+    const int n_iterations,                         //number of iterations of the adaptive grid
+    const std::optional<uint64_t> seed,             //seed of the random stream (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    const int dim = (int)bounds.size();
+
+    //the fcn is 1 inside, and 0 outside (each chunk gets its own copy of the fcn, and of the point)
+    auto eval_block = [dim, fcn, point = vector<double>(dim)](const unsigned long int n_block, const double* const* X, double* f) mutable
+    {
+        for (unsigned long int j=0; j<n_block; j++) {
+            for (int i=0; i<dim; i++) point[i] = X[i][j];
+            f[j] = fcn(point.data()) ? 1. : 0.;
+        }
+    };
+    return vegas_integrate(n_pts, bounds, eval_block, n_iterations, seed, policy);
+}
+//_______________________________________________________________________________
+ValueWithError_t<double> VegasIntegrate(
+    const unsigned long int n_pts,                  //total number of points to use, over all iterations
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.
+    BatchValueIntegrand_t fcn,                      //fcn to integrate, a whole block of points at a time
+    const int n_iterations,                         //number of iterations of the adaptive grid
+    const std::optional<uint64_t> seed,             //seed of the random stream (if none is given, a random one is used)
+    const ExecutionPolicy_t& policy                 //threads (see ExecutionPolicy.hpp)
+)
+{
+    return vegas_integrate(n_pts, bounds, fcn, n_iterations, seed, policy);
+}
\ No newline at end of file
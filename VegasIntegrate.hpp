@@ -0,0 +1,60 @@
+#ifndef VegasIntegrate_H
+#define VegasIntegrate_H
+
+#include <optional>
+#include <functional>
+#include <vector>
+#include <cstdint>
+#include "ValueWithError.hpp"
+#include "IntegrationBound.hpp"
+#include "BatchIntegrand.hpp"
+#include "ExecutionPolicy.hpp"
+
+// An adaptive importance-sampling monte-carlo integrator (VEGAS; G.P. Lepage, J. Comput. Phys. 27,
+// 192 (1978)).
+//
+// The points are drawn from a separable density: along each axis, the bounds are split into bins of
+// different widths, each of which is equally likely to be picked. After each iteration, the bins are
+// moved so that they are narrower where the fcn contributes the most (though every axis keeps a share
+// of uniform density, so no part of the box is ever left out). The first half of the iterations only
+// train the bins; the estimates of the second half are averaged. For regions which only fill a small
+// part of the box, this puts most of the points where they matter. (the region does have to be found by
+// the uniform points of the first iteration.)
+//
+// if the iterations disagree with each other by more than their errors say they should, the error is
+// scaled up by sqrt(chi^2/dof); if no point hit the region at all, the error is the volume a single hit
+// would have counted for.
+//
+// the points come from the same counter-based random stream as MontecarloIntegrate() (point i of
+// iteration k is point k*(n_pts/n_iterations) + i of the stream), so the same seed always gives the
+// same result, no matter how many threads are used.
+
+//default number of iterations (the points are split evenly between them)
+constexpr int kVegasIterations = 10;
+
+//number of bins along each axis
+constexpr int kVegasBins = 50;
+
+ValueWithError_t<double> VegasIntegrate(
+    const unsigned long int n_pts,                  //total number of points to use, over all iterations
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.
+    std::function<bool(const double*)> fcn,         //fcn to integrate. must accept (CONST) ptr to doubles.
+    const int n_iterations=kVegasIterations,        //number of iterations of the adaptive grid
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the random stream. the same seed always gives the same result.
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+);
+
+// same as above, for a real-valued batch integrand (see BatchIntegrand.hpp): each block of points is mapped
+// through the bins, and then handed to the fcn with a single call. (VEGAS weights each point by its own
+// jacobian, so it needs the value at every point; a BatchIntegrand_t, which only counts the points inside,
+// can't be used. its 0/1 indicator can: see inside_both_spheres_indicator() in SphereKernels.hpp.)
+ValueWithError_t<double> VegasIntegrate(
+    const unsigned long int n_pts,                  //total number of points to use, over all iterations
+    const std::vector<IntegrationBound_t> bounds,   //number of dimensions is given by the number of bounds given.
+    BatchValueIntegrand_t fcn,                      //fcn to integrate. writes the value of the fcn at each point of the block.
+    const int n_iterations=kVegasIterations,        //number of iterations of the adaptive grid
+    const std::optional<uint64_t> seed=std::nullopt,//seed of the random stream (see above)
+    const ExecutionPolicy_t& policy={}              //threads (see ExecutionPolicy.hpp)
+);
+
+#endif
\ No newline at end of file
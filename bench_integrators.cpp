@@ -0,0 +1,179 @@
+#include "MontecarloIntegrate.hpp"
+#include "SobolIntegrate.hpp"
+#include "GridIntegrate.hpp"
+#include "SphereKernels.hpp"
+#include "SimdLevel.hpp"
+#include "ThreadPool.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+using namespace std;
+
+// A throughput benchmark of the integrators: for each integrator, integrand, dimension, and number of
+// threads, the integral is timed a few times (after one untimed warm-up run), and the median and spread of
+// the times are written out as JSON, so that runs (on different commits, or machines) can be compared.
+//
+// usage:
+//
+//  ./bench_integrators [n_reps=5] [n_pts=1e6] [max_dim=20] [affinity=none] > bench.json
+//
+// where 'affinity' is how the pool's threads are pinned: none, compact, or spread (see ExecutionPolicy.hpp).
+// (the progress is printed to stderr, so only the JSON goes to stdout.)
+
+namespace {
+
+    struct Integrand_t {
+        string name;
+        function<BatchIntegrand_t(int dim)> make;  //the integrand, for a given dimension
+    };
+
+    struct Integrator_t {
+        string name;
+        //runs the integral with (about) n_pts points, and returns the number of points actually used
+        function<unsigned long int(unsigned long int n_pts, const vector<IntegrationBound_t>&, BatchIntegrand_t, unsigned int n_threads)> run;
+    };
+
+    //the median, and the smallest and largest, of a list of timings
+    struct TimingStats_t { double median, min, max; };
+
+    TimingStats_t timing_stats(vector<double> times)
+    {
+        sort(times.begin(), times.end());
+        const size_t n = times.size();
+        const double median = (n % 2 == 1) ? times[n/2] : 0.5*(times[n/2 - 1] + times[n/2]);
+        return TimingStats_t{ median, times.front(), times.back() };
+    }
+
+    const char* affinity_name(const ThreadAffinity_t affinity)
+    {
+        switch (affinity) {
+            case (kAffinityCompact) : return "compact";
+            case (kAffinitySpread)  : return "spread";
+            default                 : return "none";
+        }
+    }
+
+    const char* simd_level_name(const SimdLevel level)
+    {
+        switch (level) {
+            case (kSimdAVX512)  : return "avx512";
+            case (kSimdAVX2)    : return "avx2";
+            default             : return "scalar";
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int i_arg=1;
+
+    const int               n_reps  = argc > i_arg ? max<int>(1, atoi(argv[i_arg++])) : 5;
+    const long unsigned int n_pts   = argc > i_arg ? atof(argv[i_arg++])              : 1e6;
+    const int               max_dim = argc > i_arg ? atoi(argv[i_arg++])              : 20;
+    const string            pinning = argc > i_arg ? argv[i_arg++]                    : "none";
+
+    ThreadAffinity_t affinity = kAffinityNone;
+    if      (pinning == "compact") affinity = kAffinityCompact;
+    else if (pinning == "spread")  affinity = kAffinitySpread;
+    else if (pinning != "none") {
+        fprintf(stderr, "unknown affinity '%s' (expected none, compact, or spread)\n", pinning.c_str());
+        return 1;
+    }
+    if (!ThreadPool::Global().SetAffinity(affinity)) fprintf(stderr, "warning: couldn't pin the threads (%s)\n", pinning.c_str());
+
+    //the dimensions, and thread counts, to try
+    vector<int> dims;
+    for (int dim : {2, 3, 5, 10, 15, 20}) if (dim <= max_dim) dims.push_back(dim);
+
+    const unsigned int max_threads = ThreadPool::Global().NumThreads();
+    vector<unsigned int> thread_counts;
+    for (unsigned int n=1; n<max_threads; n *= 2) thread_counts.push_back(n);
+    thread_counts.push_back(max_threads);
+
+    const vector<Integrand_t> integrands{
+        //the unit ball, in the [-1,1]^dim box
+        { "ball",     [](int dim) -> BatchIntegrand_t {
+            return [dim](unsigned long int n, const double* const* X){ return count_inside_ball(n, dim, X, 1.); };
+        }},
+        //the overlap of a unit sphere with one of radius 0.5, a distance of 1 away (along X[0])
+        { "overlap",  [](int dim) -> BatchIntegrand_t {
+            return [dim](unsigned long int n, const double* const* X){ return count_inside_both_spheres(n, dim, X, 1., 0.25, 1.); };
+        }},
+        //every point is inside: this times the integrator itself (making the points, and handing them out)
+        { "constant", [](int)     -> BatchIntegrand_t {
+            return [](unsigned long int n, const double* const*){ return n; };
+        }}
+    };
+
+    const vector<Integrator_t> integrators{
+        { "montecarlo", [](unsigned long int n, const vector<IntegrationBound_t>& bounds, BatchIntegrand_t fcn, unsigned int n_threads) {
+            MontecarloIntegrate(n, bounds, fcn, 12345ul, n_threads);
+            return n;
+        }},
+        { "sobol",      [](unsigned long int n, const vector<IntegrationBound_t>& bounds, BatchIntegrand_t fcn, unsigned int n_threads) {
+            SobolIntegrate(n, bounds, fcn, n_threads);
+            return n;
+        }},
+        //(the grid can only have a whole number of points per side, so it uses as many as it can without going over)
+        { "grid",       [](unsigned long int n, const vector<IntegrationBound_t>& bounds, BatchIntegrand_t fcn, unsigned int n_threads) {
+            const double dim = (double)bounds.size();
+            const unsigned long int n_per_side = max<unsigned long int>( 2, (unsigned long int)floor( pow((double)n, 1./dim) + 1e-9 ) );
+            GridIntegrate(n_per_side, bounds, fcn, n_threads);
+            return (unsigned long int)llround( pow((double)n_per_side, dim) );
+        }}
+    };
+
+    printf("{\n");
+    printf("  \"meta\": { \"n_reps\": %i, \"n_pts\": %lu, \"hardware_threads\": %u, \"affinity\": \"%s\", \"simd_level\": \"%s\", \"batch_size\": %lu, \"chunk_size\": %lu },\n",
+        n_reps, n_pts, max_threads, affinity_name(ThreadPool::Global().Affinity()), simd_level_name(get_simd_level()), kBatchSize, kChunkSize);
+    printf("  \"results\": [\n");
+
+    bool first_result=true;
+    for (const auto& integrator : integrators) {
+        for (const auto& integrand : integrands) {
+            for (const int dim : dims) {
+
+                const vector<IntegrationBound_t> bounds(dim, IntegrationBound_t{ -1., 1. });
+                const BatchIntegrand_t fcn = integrand.make(dim);
+
+                for (const unsigned int n_threads : thread_counts) {
+
+                    fprintf(stderr, "%-10s %-8s dim=%2i threads=%3u ...", integrator.name.c_str(), integrand.name.c_str(), dim, n_threads);
+
+                    //the warm-up run (which also tells us how many points are used)
+                    const unsigned long int n_used = integrator.run(n_pts, bounds, fcn, n_threads);
+
+                    vector<double> times;
+                    for (int rep=0; rep<n_reps; rep++) {
+                        const auto start = chrono::steady_clock::now();
+                        integrator.run(n_pts, bounds, fcn, n_threads);
+                        times.push_back( chrono::duration<double>(chrono::steady_clock::now() - start).count() );
+                    }
+                    const TimingStats_t t = timing_stats(times);
+
+                    fprintf(stderr, " %8.2f ns/pt\n", 1e9 * t.median / (double)n_used);
+
+                    printf("%s    { \"integrator\": \"%s\", \"integrand\": \"%s\", \"dim\": %i, \"threads\": %u, \"n_pts\": %lu, "
+                           "\"median_s\": %.6e, \"min_s\": %.6e, \"max_s\": %.6e, \"spread\": %.4f, \"ns_per_pt\": %.4f, \"pts_per_s\": %.6e }",
+                        first_result ? "" : ",\n",
+                        integrator.name.c_str(), integrand.name.c_str(), dim, n_threads, n_used,
+                        t.median, t.min, t.max,
+                        (t.max - t.min) / t.median,             //(the spread of the times, relative to the median)
+                        1e9 * t.median / (double)n_used,
+                        (double)n_used / t.median
+                    );
+                    first_result = false;
+                }
+            }
+        }
+    }
+    printf("\n  ]\n}\n");
+
+    return 0;
+}
\ No newline at end of file
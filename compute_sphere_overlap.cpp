@@ -5,14 +5,99 @@
 
 #include "compute_sphere_overlap.hpp"
 #include "ValueWithError.hpp"
+#include "SphereKernels.hpp"
+#include "DimDispatch.hpp"
+#include "ControlVariate.hpp"
 
 //integrators we can use
 #include "MontecarloIntegrate.hpp"
 #include "SobolIntegrate.hpp"
 #include "GridIntegrate.hpp"
+#include "AdaptiveGridIntegrate.hpp"
+#include "VegasIntegrate.hpp"
+#include "MiserIntegrate.hpp"
+#include "BallIntegrate.hpp"
+#include "SphereOverlapAnalytic.hpp"
+#include "AxisymmetricIntegrate.hpp"
 
 using namespace std; 
 
+namespace {
+
+    //throws invalid_argument unless the spheres make sense: R1, R2 and sep must all be positive, and R1 >= R2. 
+    // ('label' says which configuration it is, if there's more than one.) 
+    void check_sphere_args(const char* fcn_name, const double R1, const double R2, const double sep, const string& label="")
+    {
+        if (!(R1 > 0. && R2 > 0. && sep >= 0. && R1 >= R2)) {
+            ostringstream oss; 
+            oss << "in <" << fcn_name << ">: " << label << "R1 (" << R1 << "), R2 (" << R2 
+                << "), or sep (" << sep << ") is invalid; they must all be positive, and R1 >= R2!";    
+            throw invalid_argument(oss.str()); 
+        }
+    }
+
+    //the box around the overlap. along x0, it's wherever both spheres are; along the other axes, sphere 1's 
+    // extent. 
+    vector<IntegrationBound_t> overlap_bounds(const int dimenison, const double R1, const double R2, const double sep)
+    {
+        vector<IntegrationBound_t> bounds{
+            { max<double>( -R1, sep - R2 ), min<double>( +R1, sep + R2 )}
+        }; 
+        for (int i=1; i<dimenison; i++) bounds.push_back({ -R1, R1 }); 
+        return bounds; 
+    }
+
+    //the box for the 'conditional' integrands, in the other (dim-1) coordinates: the chord is empty unless the 
+    // point is inside sphere 2, so (as R2 <= R1) they only need to span R2. 
+    vector<IntegrationBound_t> overlap_bounds_perp(const int dimenison, const double R2)
+    {
+        return vector<IntegrationBound_t>(max<int>(0, dimenison-1), IntegrationBound_t{ -R2, R2 }); 
+    }
+
+    //number of points along each side of a grid of (about) N points
+    unsigned long int grid_points_per_side(const long unsigned int N, const unsigned long int n_dims)
+    {
+        return 1 + (unsigned long int)pow(N, 1./((double)n_dims)); 
+    }
+
+    //_______________________________________________________________________________
+    //the integrands, taking sphere 1 to be at the origin, and sphere 2 to have its center at: 
+    //
+    // \vec{R}_2 = {sep,0,...,0}. 
+    //
+    //each is evaluated on a whole block of points at once. for each point, we check the first sphere 
+    // (|X|^2 <= R1^2), then the second, using the fact that the only difference between the distance 
+    // to the two spheres is the X[0] term. see SphereKernels.cpp. 
+
+    //the number of points of the block which are inside both spheres
+    auto make_overlap_counter(const int dimenison, const double R1, const double R2, const double sep)
+    {
+        return [R1_R1 = R1*R1, R2_R2 = R2*R2, sep, dimenison](const unsigned long int n_pts, const double* const* X) 
+        {   
+            return count_inside_both_spheres(n_pts, dimenison, X, R1_R1, R2_R2, sep); 
+        };
+    }
+
+    //the same test, as the value (1 inside, 0 outside) at each point of the block, for the integrators which 
+    // need to know which of the points are inside, not just how many. 
+    auto make_overlap_indicator(const int dimenison, const double R1, const double R2, const double sep)
+    {
+        return [R1_R1 = R1*R1, R2_R2 = R2*R2, sep, dimenison](const unsigned long int n_pts, const double* const* X, double* f) 
+        {
+            inside_both_spheres_indicator(n_pts, dimenison, X, R1_R1, R2_R2, sep, f); 
+        }; 
+    }
+
+    //the length of the chord (along X[0]) inside both spheres, for a block of points in the other (dim-1) coordinates
+    auto make_overlap_chord(const int dimenison, const double R1, const double R2, const double sep)
+    {
+        return [R1_R1 = R1*R1, R2_R2 = R2*R2, sep, dimenison](const unsigned long int n_pts, const double* const* X, double* f) 
+        {
+            lens_chord_lengths(n_pts, dimenison-1, X, R1_R1, R2_R2, sep, f); 
+        }; 
+    }
+    //_______________________________________________________________________________
+}
 
 ValueWithError_t<double> compute_sphere_overlap(
     const int dimenison, 
@@ -20,68 +105,391 @@ ValueWithError_t<double> compute_sphere_overlap(
     const double R1, 
     const double R2, 
     const double sep,
-    IntegratorType integrator_type
+    IntegratorType integrator_type, 
+    const std::optional<uint64_t> seed
 ) 
 {   
     //check some basic constraints
-    if (!(R1 > 0. && R2 > 0. && sep >= 0. && R1 >= R2)) {
-        ostringstream oss; 
-        oss << "in <compute_spheres_overlap>: R1 (" << R1 << "), R1 (" << R2 
-            << "), or sep (" << sep << ") is invalid; they must all be positive, and R1 >= R2!";    
-        throw invalid_argument(oss.str()); 
-        return ValueWithError_t<double>{}; 
-    } 
-
-    //create the function that returns 'true' if a given point is within both spheres 
-    //taking sphere 1 to be at the origin, and sphere 2 to have its center at: 
-    //
-    // \vec{R}_2 = {sep,0,...,0}. 
-    //
+    check_sphere_args("compute_sphere_overlap", R1, R2, sep); 
+
     const double R1_R1 = R1*R1; 
     const double R2_R2 = R2*R2;
-    
-    //_______________________________________________________________________________
-    auto is_inside_both_spheres = [R1_R1,R2_R2,sep,dimenison](const double* X) 
-    {   
-        //check the first sphere
-        double val=0.; 
-        for (int i=0; i<dimenison; i++) val += X[i]*X[i];
-
-        //check if outside of the first sphere
-        if (val > R1_R1) return false; 
-    
-        //compute dist to second sphere
-        // we can do this little trick because this is the only difference between the 
-        // distance to the two spheres 
-        val += (( X[0] - sep )*( X[0] - sep )) - ( X[0]*X[0] ); 
-        
-        //check if outside of the second sphere
-        if (val > R2_R2) return false; 
-
-        //if the code makes it here, it was inside both spheres. 
-        return true;
-    };
-    //_______________________________________________________________________________
-    
+
+    auto is_inside_both_spheres = make_overlap_counter(dimenison, R1, R2, sep); 
+    auto overlap_indicator      = make_overlap_indicator(dimenison, R1, R2, sep); 
 
     //now, make the integration bounds
-    //first, for the x0-axis
-    vector<IntegrationBound_t> bounds{
-        { max<double>( -R1, sep - R2 ), min<double>( +R1, sep + R2 )}
-    }; 
-    
-    //now, add bounds for all other axes
-    for (int i=1; i<dimenison; i++) bounds.push_back({ -R1, R1 }); 
+    const vector<IntegrationBound_t> bounds = overlap_bounds(dimenison, R1, R2, sep); 
 
     //now, we are ready to do the integration 
     ValueWithError_t<double> result; 
 
+    //(the scrambled sobol replicas must all get the same number of points, so the rest of N isn't used)
+    const unsigned long int N_replicas = N - N % kSobolReplicas; 
+
     //check which integrator we're using
     switch (integrator_type) {
-        case (kMontecarlo)  : result = MontecarloIntegrate(N, bounds, is_inside_both_spheres); break;
+        case (kMontecarlo)  : result = MontecarloIntegrate(N, bounds, is_inside_both_spheres, seed); break;
         case (kQuasirandom) : result = SobolIntegrate(N, bounds, is_inside_both_spheres); break; 
-        case (kGrid)        : result = GridIntegrate(1 + (unsigned long int)pow(N, 1./((double)bounds.size())), bounds, is_inside_both_spheres); break; 
+        case (kScrambledQuasirandom) : result = ScrambledSobolIntegrate(N_replicas, bounds, is_inside_both_spheres, kSobolReplicas, seed); break; 
+        case (kGrid)        : {
+            
+            const unsigned long int n_per_side = grid_points_per_side(N, bounds.size()); 
+
+            //for the grid, the fcn evaluation (rather than point generation) is the bottleneck; so use the 
+            // version with the dimension fixed at compile-time, if we have one for this dimension. 
+            const bool dispatched = dispatch_dim(dimenison, [&](auto dim_c) {
+                constexpr int Dim = decltype(dim_c)::value; 
+                result = GridIntegrate<Dim>(n_per_side, bounds, InsideBothSpheres<Dim>{R1_R1, R2_R2, sep}); 
+            });
+            if (!dispatched) result = GridIntegrate(n_per_side, bounds, is_inside_both_spheres); 
+            break; 
+        }
+        case (kAdaptiveGrid) : {
+
+            const int max_depth = max<int>(0, (int)ceil( log2((double)N) / ((double)dimenison) )); 
+
+            //the nearest and farthest any point of a cell can be from a sphere's center tell us if the 
+            // cell is all inside, or all outside, of that sphere. 
+            auto classify_cell = [R1_R1,R2_R2,sep,dimenison](const IntegrationBound_t* cell) 
+            {
+                double near1{0.}, far1{0.}, near2{0.}, far2{0.}; 
+                for (int i=0; i<dimenison; i++) {
+
+                    const double c2 = (i==0) ? sep : 0.; 
+
+                    const double lo1 = cell[i].xmin,      hi1 = cell[i].xmax; 
+                    const double lo2 = cell[i].xmin - c2, hi2 = cell[i].xmax - c2; 
+
+                    if (lo1 > 0.) near1 += lo1*lo1; else if (hi1 < 0.) near1 += hi1*hi1; 
+                    if (lo2 > 0.) near2 += lo2*lo2; else if (hi2 < 0.) near2 += hi2*hi2; 
+
+                    far1 += max<double>( lo1*lo1, hi1*hi1 ); 
+                    far2 += max<double>( lo2*lo2, hi2*hi2 ); 
+                }
+                if (near1 > R1_R1 || near2 > R2_R2) return kCellOutside; 
+                if (far1 <= R1_R1 && far2 <= R2_R2) return kCellInside; 
+                return kCellStraddles; 
+            }; 
+
+            //(only used at the centers of the smallest cells which straddle the boundary)
+            auto is_inside_point = make_point_integrand(dimenison, is_inside_both_spheres); 
+
+            result = AdaptiveGridIntegrate(max_depth, bounds, is_inside_point, classify_cell); 
+            break; 
+        }
+        case (kVegas)       : result = VegasIntegrate(N, bounds, BatchValueIntegrand_t(overlap_indicator), kVegasIterations, seed); break; 
+        case (kMiser)       : result = MiserIntegrate(N, bounds, BatchValueIntegrand_t(overlap_indicator), seed); break; 
+        case (kBall)        : {
+
+            //the overlap is all inside sphere 2 (the smaller one), so we only throw points inside of it, 
+            // and just check them against sphere 1. 
+            vector<double> center2(dimenison, 0.); 
+            center2[0] = sep; 
+
+            auto is_inside_sphere1 = [R1_R1,dimenison](const unsigned long int n_pts, const double* const* X) 
+            {
+                return count_inside_ball(n_pts, dimenison, X, R1_R1); 
+            }; 
+
+            result = BallIntegrate(N, center2, R2, is_inside_sphere1, seed); 
+            break; 
+        }
+        case (kAnalytic)    : result = ValueWithError_t<double>{ sphere_overlap_volume(dimenison, R1, R2, sep), 0. }; break; 
+        case (kMontecarloConditional)  : 
+        case (kQuasirandomConditional) : 
+        case (kGridConditional)        : 
+        case (kScrambledQuasirandomConditional) : {
+
+            auto chord_inside_both_spheres = make_overlap_chord(dimenison, R1, R2, sep); 
+
+            //in 1d, there's nothing left to integrate over
+            if (dimenison == 1) {
+                double length; 
+                chord_inside_both_spheres(1, nullptr, &length); 
+                result = ValueWithError_t<double>{ length, 0. }; 
+                break; 
+            }
+
+            const vector<IntegrationBound_t> bounds_perp = overlap_bounds_perp(dimenison, R2); 
+
+            if (integrator_type == kMontecarloConditional)  result = MontecarloIntegrate(N, bounds_perp, chord_inside_both_spheres, seed); 
+            if (integrator_type == kQuasirandomConditional) result = SobolIntegrate(N, bounds_perp, chord_inside_both_spheres); 
+            if (integrator_type == kScrambledQuasirandomConditional) result = ScrambledSobolIntegrate(N_replicas, bounds_perp, chord_inside_both_spheres, kSobolReplicas, seed); 
+            if (integrator_type == kGridConditional) result = GridIntegrate(grid_points_per_side(N, bounds_perp.size()), bounds_perp, chord_inside_both_spheres); 
+            break; 
+        }
+        case (kMontecarloControlVariate)  : 
+        case (kQuasirandomControlVariate) : {
+
+            vector<ControlVariate_t> controls; 
+
+            //sphere 2 holds all of the overlap. the only part of it outside the bounds is the cap beyond x0 = R1. 
+            vector<double> center2(dimenison, 0.); 
+            center2[0] = sep; 
+            controls.push_back( ball_control_variate(center2, R2) ); 
+            controls.back().integral -= sphere_cap_volume(dimenison, R2, R1 - sep); 
+
+            //the largest ball inside the overlap (centered on the X[0]-axis, where it is as far from both 
+            // spheres' surfaces as it can be) 
+            const double c_in = min<double>( sep, 0.5*(R1 - R2 + sep) ); 
+            const double r_in = min<double>( R1 - fabs(c_in), R2 - fabs(c_in - sep) ); 
+            if (r_in > 0.) {
+                vector<double> center_in(dimenison, 0.); 
+                center_in[0] = c_in; 
+                controls.push_back( ball_control_variate(center_in, r_in) ); 
+            }
+
+            if (integrator_type == kMontecarloControlVariate)  result = MontecarloIntegrateControlVariates(N, bounds, overlap_indicator, controls, seed); 
+            if (integrator_type == kQuasirandomControlVariate) result = SobolIntegrateControlVariates(N, bounds, overlap_indicator, controls); 
+            break; 
+        }
+        case (kAxisymmetric) : {
+
+            //both spheres are centered on the X[0]-axis, so only x0 and the distance from the axis matter
+            auto is_inside_both_axisym = [R1_R1,R2_R2,sep](const double x0, const double r) 
+            {
+                const double r_r = r*r; 
+                return (x0*x0 + r_r <= R1_R1) && ((x0 - sep)*(x0 - sep) + r_r <= R2_R2); 
+            }; 
+
+            if (dimenison < 2) { result = compute_sphere_overlap(dimenison, N, R1, R2, sep, kAnalytic); break; }
+
+            result = AxisymmetricIntegrate(N, dimenison, bounds[0], R2, is_inside_both_axisym); 
+            break; 
+        }
     }
     
     return result; 
+}
+
+TargetResult_t compute_sphere_overlap_to_target(
+    const int dimenison, 
+    const PrecisionTarget_t target, 
+    const double R1, 
+    const double R2, 
+    const double sep,
+    IntegratorType integrator_type, 
+    const std::optional<uint64_t> seed
+) 
+{
+    check_sphere_args("compute_sphere_overlap_to_target", R1, R2, sep); 
+
+    switch (integrator_type) {
+        case (kMontecarlo) : 
+        case (kScrambledQuasirandom) : {
+
+            auto is_inside_both_spheres = make_overlap_counter(dimenison, R1, R2, sep); 
+            const vector<IntegrationBound_t> bounds = overlap_bounds(dimenison, R1, R2, sep); 
+
+            if (integrator_type == kScrambledQuasirandom) {
+                return ScrambledSobolIntegrateToTarget(target, bounds, BatchIntegrand_t(is_inside_both_spheres), kSobolReplicas, seed); 
+            }
+            return MontecarloIntegrateToTarget(target, bounds, BatchIntegrand_t(is_inside_both_spheres), seed); 
+        }
+        case (kMontecarloConditional) : 
+        case (kScrambledQuasirandomConditional) : {
+
+            auto chord_inside_both_spheres = make_overlap_chord(dimenison, R1, R2, sep); 
+
+            //in 1d, the chord is the exact answer
+            if (dimenison == 1) {
+                TargetResult_t result; 
+                chord_inside_both_spheres(1, nullptr, &result.val); 
+                result.reached_target = true; 
+                return result; 
+            }
+
+            const vector<IntegrationBound_t> bounds_perp = overlap_bounds_perp(dimenison, R2); 
+
+            if (integrator_type == kScrambledQuasirandomConditional) {
+                return ScrambledSobolIntegrateToTarget(target, bounds_perp, BatchValueIntegrand_t(chord_inside_both_spheres), kSobolReplicas, seed); 
+            }
+            return MontecarloIntegrateToTarget(target, bounds_perp, BatchValueIntegrand_t(chord_inside_both_spheres), seed); 
+        }
+        default : 
+            throw invalid_argument("in <compute_sphere_overlap_to_target>: only kMontecarlo, kScrambledQuasirandom and their conditional versions have a target-precision mode."); 
+    }
+}
+
+std::vector<ValueWithError_t<double>> compute_sphere_overlap_checkpoints(
+    const int dimenison, 
+    const std::vector<unsigned long int> checkpoints, 
+    const double R1, 
+    const double R2, 
+    const double sep,
+    IntegratorType integrator_type, 
+    const std::optional<uint64_t> seed
+) 
+{
+    check_sphere_args("compute_sphere_overlap_checkpoints", R1, R2, sep); 
+
+    auto is_inside_both_spheres    = make_overlap_counter(dimenison, R1, R2, sep); 
+    auto chord_inside_both_spheres = make_overlap_chord(dimenison, R1, R2, sep); 
+
+    const vector<IntegrationBound_t> bounds      = overlap_bounds(dimenison, R1, R2, sep); 
+    const vector<IntegrationBound_t> bounds_perp = overlap_bounds_perp(dimenison, R2); 
+
+    switch (integrator_type) {
+        case (kMontecarlo)  : return MontecarloIntegrateCheckpoints(checkpoints, bounds, BatchIntegrand_t(is_inside_both_spheres), seed); 
+        case (kQuasirandom) : return SobolIntegrateCheckpoints(checkpoints, bounds, BatchIntegrand_t(is_inside_both_spheres)); 
+
+        //(in 1d, there's nothing left to integrate over; see below)
+        case (kMontecarloConditional)  : 
+            if (dimenison > 1) return MontecarloIntegrateCheckpoints(checkpoints, bounds_perp, BatchValueIntegrand_t(chord_inside_both_spheres), seed); 
+            break; 
+        case (kQuasirandomConditional) : 
+            if (dimenison > 1) return SobolIntegrateCheckpoints(checkpoints, bounds_perp, BatchValueIntegrand_t(chord_inside_both_spheres)); 
+            break; 
+        default : break; 
+    }
+
+    //the rest aren't nested in the number of points (or don't use points at all), so each checkpoint is a run of its own
+    checkpoint_segment_ends(checkpoints);   //(only to check them)
+
+    vector<ValueWithError_t<double>> results; 
+    for (const unsigned long int N : checkpoints) results.push_back( compute_sphere_overlap(dimenison, N, R1, R2, sep, integrator_type, seed) ); 
+    return results; 
+}
+
+std::vector<ValueWithError_t<double>> compute_sphere_overlap_multi(
+    const int dimenison, 
+    const long unsigned int N, 
+    const std::vector<SphereOverlapConfig_t> configs, 
+    IntegratorType integrator_type, 
+    const std::optional<uint64_t> seed
+) 
+{
+    if (configs.empty()) return {}; 
+
+    //the integrators which can't share their points just do one configuration at a time
+    if (integrator_type != kMontecarlo && integrator_type != kQuasirandom) {
+        vector<ValueWithError_t<double>> results; 
+        for (const auto& c : configs) results.push_back( compute_sphere_overlap(dimenison, N, c.R1, c.R2, c.sep, integrator_type, seed) ); 
+        return results; 
+    }
+
+    const unsigned long int n_configs = configs.size(); 
+    vector<double> R1_R1(n_configs), R2_R2(n_configs), sep(n_configs); 
+
+    //the bounding box of all of them: for each, the same box compute_sphere_overlap uses (so with a single 
+    // configuration, the result is the same as compute_sphere_overlap's)
+    IntegrationBound_t x0_bound{ +1.e300, -1.e300 }; 
+    double R1_max = 0.; 
+
+    for (unsigned long int k=0; k<n_configs; k++) {
+
+        const auto& c = configs[k]; 
+        check_sphere_args("compute_sphere_overlap_multi", c.R1, c.R2, c.sep, "configuration "+to_string(k)+": "); 
+
+        R1_R1[k] = c.R1*c.R1; 
+        R2_R2[k] = c.R2*c.R2; 
+        sep[k]   = c.sep; 
+
+        const IntegrationBound_t x0_bound_k = overlap_bounds(1, c.R1, c.R2, c.sep)[0]; 
+
+        x0_bound.xmin = min<double>( x0_bound.xmin, x0_bound_k.xmin ); 
+        x0_bound.xmax = max<double>( x0_bound.xmax, x0_bound_k.xmax ); 
+        R1_max        = max<double>( R1_max, c.R1 ); 
+    }
+
+    vector<IntegrationBound_t> bounds{ x0_bound }; 
+    for (int i=1; i<dimenison; i++) bounds.push_back({ -R1_max, R1_max }); 
+
+    auto is_inside_both_spheres = [=](const unsigned long int n_pts, const double* const* X, unsigned long int* counts) 
+    {
+        count_inside_both_spheres_multi(n_pts, dimenison, X, n_configs, R1_R1.data(), R2_R2.data(), sep.data(), counts); 
+    }; 
+
+    if (integrator_type == kQuasirandom) return SobolIntegrateMulti(N, bounds, n_configs, is_inside_both_spheres); 
+
+    return MontecarloIntegrateMulti(N, bounds, n_configs, is_inside_both_spheres, seed); 
+}
+
+SphereOverlapMoments_t compute_sphere_overlap_moments(
+    const int dimenison, 
+    const long unsigned int N, 
+    const double R1, 
+    const double R2, 
+    const double sep,
+    IntegratorType integrator_type, 
+    const std::optional<uint64_t> seed
+) 
+{
+    check_sphere_args("compute_sphere_overlap_moments", R1, R2, sep); 
+
+    //the outputs: F[0] is 1 inside the overlap (and 0 outside), F[1+i] is that times X[i], and F[1+dim+i] 
+    // is that times X[i]^2 
+    const unsigned long int n_components = 1 + 2*dimenison; 
+
+    auto moments_of_overlap = [overlap_indicator = make_overlap_indicator(dimenison, R1, R2, sep), dimenison]
+        (const unsigned long int n_pts, const double* const* X, double* const* F) 
+    {
+        overlap_indicator(n_pts, X, F[0]); 
+
+        for (int i=0; i<dimenison; i++) {
+            double* first  = F[1 + i]; 
+            double* second = F[1 + dimenison + i]; 
+            for (unsigned long int j=0; j<n_pts; j++) {
+                first[j]  = F[0][j] * X[i][j]; 
+                second[j] = first[j] * X[i][j]; 
+            }
+        }
+    }; 
+
+    //the same bounding box as compute_sphere_overlap
+    const vector<IntegrationBound_t> bounds = overlap_bounds(dimenison, R1, R2, sep); 
+
+    vector<ValueWithError_t<double>> results; 
+
+    switch (integrator_type) {
+        case (kMontecarlo)  : results = MontecarloIntegrateVector(N, bounds, n_components, moments_of_overlap, seed); break; 
+        case (kQuasirandom) : results = SobolIntegrateVector(N, bounds, n_components, moments_of_overlap); break; 
+        case (kGrid)        : results = GridIntegrateVector(grid_points_per_side(N, bounds.size()), bounds, n_components, moments_of_overlap); break; 
+        default : 
+            throw invalid_argument("in <compute_sphere_overlap_moments>: only kMontecarlo, kQuasirandom and kGrid can integrate the moments."); 
+    }
+
+    SphereOverlapMoments_t moments; 
+    moments.volume = results[0]; 
+    moments.first  = vector<ValueWithError_t<double>>(results.begin() + 1,             results.begin() + 1 + dimenison); 
+    moments.second = vector<ValueWithError_t<double>>(results.begin() + 1 + dimenison, results.end()); 
+    return moments; 
+}
+
+ShardRecord_t compute_sphere_overlap_shard(
+    const int dimenison, 
+    const unsigned int i_shard, 
+    const unsigned int n_shards, 
+    const long unsigned int N, 
+    const double R1, 
+    const double R2, 
+    const double sep,
+    IntegratorType integrator_type, 
+    const uint64_t seed
+) 
+{
+    check_sphere_args("compute_sphere_overlap_shard", R1, R2, sep); 
+
+    //(the same integrands, and bounds, as compute_sphere_overlap)
+    auto is_inside_both_spheres    = make_overlap_counter(dimenison, R1, R2, sep); 
+    auto chord_inside_both_spheres = make_overlap_chord(dimenison, R1, R2, sep); 
+
+    const vector<IntegrationBound_t> bounds      = overlap_bounds(dimenison, R1, R2, sep); 
+    const vector<IntegrationBound_t> bounds_perp = overlap_bounds_perp(dimenison, R2); 
+
+    switch (integrator_type) {
+        case (kMontecarlo)  : return MontecarloIntegrateShard(i_shard, n_shards, N, bounds, BatchIntegrand_t(is_inside_both_spheres), seed); 
+        case (kQuasirandom) : return SobolIntegrateShard(i_shard, n_shards, N, bounds, BatchIntegrand_t(is_inside_both_spheres)); 
+
+        case (kMontecarloConditional)  : 
+            if (dimenison > 1) return MontecarloIntegrateShard(i_shard, n_shards, N, bounds_perp, BatchValueIntegrand_t(chord_inside_both_spheres), seed); 
+            break; 
+        case (kQuasirandomConditional) : 
+            if (dimenison > 1) return SobolIntegrateShard(i_shard, n_shards, N, bounds_perp, BatchValueIntegrand_t(chord_inside_both_spheres)); 
+            break; 
+        default : break; 
+    }
+
+    throw invalid_argument("in <compute_sphere_overlap_shard>: only kMontecarlo, kQuasirandom and their conditional versions (with dimenison > 1) can be split into shards."); 
 }
\ No newline at end of file
@@ -1,9 +1,13 @@
 #ifndef compute_sphere_overlap_H
-#define comptue_sphere_overlap_H
+#define compute_sphere_overlap_H
 
 #include "ValueWithError.hpp"
 #include "MontecarloIntegrate.hpp"
+#include "ShardRecord.hpp"
 #include <functional>
+#include <optional>
+#include <cstdint>
+#include <vector>
 
 // args - 
 //  -   dimension dimension of the space the spheres live in 
@@ -11,10 +15,37 @@
 //  -   radius of sphere 1 
 //  -   radius of sphere 2 
 //  -   separation 
+//  -   integrator to use 
+//  -   (optional) seed for the monte-carlo random stream; the same seed always gives the same result. 
 enum IntegratorType { 
     kMontecarlo     = 1,
     kQuasirandom    = 2,
-    kGrid           = 3
+    kGrid           = 3,
+    kAdaptiveGrid   = 4,    //AdaptiveGridIntegrate, with 2^(depth*dim) >= N smallest cells (the error is a hard bound)
+    kVegas          = 5,    //VegasIntegrate, with N points in total
+    kMiser          = 6,    //MiserIntegrate, with N points in total
+    kBall           = 7,    //BallIntegrate: N points drawn uniformly from inside the smaller sphere (sphere 2)
+    kAnalytic       = 8,    //the exact volume (see SphereOverlapAnalytic.hpp); N is ignored, and the error is 0.
+
+    //'conditional' versions of kMontecarlo, kQuasirandom and kGrid: the points only have the coordinates X[1 ... dim-1], 
+    // and each counts the exact length of the chord (along X[0]) through it which is inside both spheres, 
+    // rather than 0 or 1. this is smooth, and has no variance along X[0] at all. 
+    kMontecarloConditional  = 9,
+    kQuasirandomConditional = 10,
+    kGridConditional        = 11,
+
+    kAxisymmetric           = 12,   //AxisymmetricIntegrate, with N fcn evaluations (of x0 and the distance from the X[0]-axis)
+
+    //randomized quasi-monte-carlo (ScrambledSobolIntegrate, N points over kSobolReplicas scrambled replicas), 
+    // for the plain, and the conditional, integrand. the error is the spread of the replicas. (N is rounded 
+    // down to a multiple of kSobolReplicas, so that each replica gets the same number of points.) 
+    kScrambledQuasirandom            = 13, 
+    kScrambledQuasirandomConditional = 14, 
+
+    //kMontecarlo and kQuasirandom, with control variates (see ControlVariate.hpp): the indicators of sphere 2, 
+    // which holds the whole overlap, and of the largest ball which fits inside the overlap. 
+    kMontecarloControlVariate  = 15, 
+    kQuasirandomControlVariate = 16
 };
 
 ValueWithError_t<double> compute_sphere_overlap(
@@ -23,7 +54,94 @@ ValueWithError_t<double> compute_sphere_overlap(
     const double R1, 
     const double R2, 
     const double sep, 
-    IntegratorType integrator_type=kMontecarlo
+    IntegratorType integrator_type=kMontecarlo, 
+    const std::optional<uint64_t> seed=std::nullopt
+); 
+
+// same as above, but in 'target-precision' mode: rather than a fixed N, points are added until the error 
+// reaches the target (see PrecisionTarget.hpp). only kMontecarlo, kScrambledQuasirandom and their conditional 
+// versions can do this. (the quasi-random ones add points to every one of their kSobolReplicas replicas.) 
+TargetResult_t compute_sphere_overlap_to_target(
+    const int dimenison, 
+    const PrecisionTarget_t target, 
+    const double R1, 
+    const double R2, 
+    const double sep, 
+    IntegratorType integrator_type=kMontecarlo, 
+    const std::optional<uint64_t> seed=std::nullopt
+); 
+
+// same as above, but gives the result at each of a (strictly increasing) list of numbers of points, 
+// 'checkpoints'. kMontecarlo, kQuasirandom and their conditional versions do this in a single pass over 
+// checkpoints.back() points (see MontecarloIntegrateCheckpoints); the others are run once per checkpoint. 
+std::vector<ValueWithError_t<double>> compute_sphere_overlap_checkpoints(
+    const int dimenison, 
+    const std::vector<unsigned long int> checkpoints, 
+    const double R1, 
+    const double R2, 
+    const double sep, 
+    IntegratorType integrator_type=kMontecarlo, 
+    const std::optional<uint64_t> seed=std::nullopt
+); 
+
+// one configuration of the two spheres (see compute_sphere_overlap)
+struct SphereOverlapConfig_t {
+    double R1, R2, sep; 
+};
+
+// the overlap for several configurations at once: result k is the overlap for configs[k]. with kMontecarlo 
+// or kQuasirandom, all of them share one bounding box (the union of their own), and one stream of points, 
+// which is made only once; each point is tested against every configuration at once. (their errors are 
+// correlated, so a scan over sep or R2 comes out smooth.) the other integrators are run once per configuration. 
+std::vector<ValueWithError_t<double>> compute_sphere_overlap_multi(
+    const int dimenison, 
+    const long unsigned int N, 
+    const std::vector<SphereOverlapConfig_t> configs, 
+    IntegratorType integrator_type=kMontecarlo, 
+    const std::optional<uint64_t> seed=std::nullopt
+); 
+
+// the volume of the overlap, and its first and second moments: first[i] is the integral of X[i] over the 
+// overlap, and second[i] that of X[i]^2 (the mixed ones, X[i]*X[j], are all 0 by symmetry). they all 
+// come from the same points, in one pass (see MontecarloIntegrateVector). only kMontecarlo, kQuasirandom 
+// and kGrid can do this. 
+struct SphereOverlapMoments_t {
+    ValueWithError_t<double> volume; 
+    std::vector<ValueWithError_t<double>> first, second; 
+
+    //the center of mass of the overlap (first[i] / volume)
+    std::vector<double> Centroid() const 
+    {
+        std::vector<double> centroid; 
+        for (const auto& moment : first) centroid.push_back( moment.val / volume.val ); 
+        return centroid; 
+    }
+};
+
+SphereOverlapMoments_t compute_sphere_overlap_moments(
+    const int dimenison, 
+    const long unsigned int N, 
+    const double R1, 
+    const double R2, 
+    const double sep, 
+    IntegratorType integrator_type=kMontecarlo, 
+    const std::optional<uint64_t> seed=std::nullopt
+); 
+
+// one shard of compute_sphere_overlap(dimenison, N, R1, R2, sep, integrator_type, seed), split between 
+// 'n_shards' processes (see ShardRecord.hpp): MergeShardRecords() of the records of all the shards gives the 
+// same result as the single run. only kMontecarlo, kQuasirandom and their conditional versions (with 
+// dimenison > 1) can do this. (every shard must be given the same seed; it's ignored by the quasi-random ones.)
+ShardRecord_t compute_sphere_overlap_shard(
+    const int dimenison, 
+    const unsigned int i_shard, 
+    const unsigned int n_shards, 
+    const long unsigned int N, 
+    const double R1, 
+    const double R2, 
+    const double sep, 
+    IntegratorType integrator_type, 
+    const uint64_t seed
 ); 
 
 #endif 
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "compute_unitball_volume.hpp"
 #include "MontecarloIntegrate.hpp"
+#include "SphereKernels.hpp"
+#include "SweepScheduler.hpp"
 #include <TGraph.h>
 #include <TCanvas.h>
 #include <TF1.h> 
@@ -14,21 +16,34 @@ void compute_unitball_volume(const int n_dim_min, const int n_dim_max, const cha
 {
     vector<double> pts_dimension, pts_vol;
 
+    //the dimensions are run side by side, except for any which would hold up the rest on a single thread; 
+    // those get all of the threads (see SweepScheduler.hpp) 
+    vector<ValueWithError_t<double>> volumes(n_dim_max - n_dim_min + 1); 
+    vector<SweepJob_t> jobs; 
+
+    for (int dim = n_dim_min; dim<=n_dim_max; dim++) {
+
+        jobs.push_back({ (double)(integration_pts * dim), [&volumes, dim, n_dim_min, integration_pts]{
+
+            //create our bounding box as the 'unit' cube (with s=2)
+            vector<IntegrationBound_t> bounds;
+            for (int d=0; d<dim; d++) bounds.push_back({-1., 1.}); 
+            
+            //define our fcn, which counts the points (in a block) which are inside the unit sphere
+            auto is_in_ball = [dim](const unsigned long int n_pts, const double* const* X) 
+            {
+                return count_inside_ball(n_pts, dim, X, 1.); 
+            };
+            
+            volumes[dim - n_dim_min] = MontecarloIntegrate(integration_pts, bounds, is_in_ball);
+        }}); 
+    }
+
+    RunSweep(jobs); 
+
     for (int dim = n_dim_min; dim<=n_dim_max; dim++) {
 
-        //create our bounding box as the 'unit' cube (with s=2)
-        vector<IntegrationBound_t> bounds;
-        for (int d=0; d<dim; d++) bounds.push_back({-1., 1.}); 
-        
-        //define our fcn, which returns 'true' when inside the unit sphere
-        auto is_in_ball = [dim](const double* X) 
-        {
-            double val=0.; 
-            for (int i=0; i<dim; i++) val += X[i]*X[i]; 
-            return val < 1. ? true : false; 
-        };
-        
-        auto volume = MontecarloIntegrate(integration_pts, bounds, is_in_ball);
+        const auto& volume = volumes[dim - n_dim_min]; 
 
         pts_dimension.push_back((double)dim); 
         pts_vol      .push_back(volume.val); 
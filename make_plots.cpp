@@ -2,6 +2,9 @@
 #include "GridIntegrate.hpp"
 #include "compute_unitball_volume.hpp"
 #include "compute_sphere_overlap.hpp"
+#include "SphereOverlapAnalytic.hpp"
+#include "SweepScheduler.hpp"
+#include "RunTelemetry.hpp"
 #include <cmath> 
 #include <iostream>
 #include <TGraph.h> 
@@ -9,6 +12,7 @@
 #include <TCanvas.h>  
 #include <TPad.h> 
 #include <cstdio> 
+#include <cstdlib> 
 #include <TF1.h> 
 #include <TLegend.h> 
 #include <TH1F.h> 
@@ -17,7 +21,6 @@
 #include <vector> 
 #include <functional> 
 #include <TLegend.h> 
-#include <Math/SpecFuncMathCore.h>
 
 using namespace std; 
 
@@ -70,6 +73,51 @@ void compute_vector_stddev_mean(const vector<double>& vals, double& mean, double
     return; 
 } 
 
+//adds the jobs which evaluate the sphere overlap 'n_trials' times, with each of the numbers of points in 
+// 'checkpoints', to a sweep (see SweepScheduler.hpp). once the sweep is run, level_vals[i][n] is the volume 
+// from trial n with checkpoints[i] points. integrators whose points are nested do all of the checkpoints 
+// of a trial in one pass (see compute_sphere_overlap_checkpoints); the others get a job for each one. 
+// the integrators which don't take a seed give the same volume every time, so they're only run once 
+// (level_vals[i] then has just that one value, and its stddev is 0). 
+void add_sphere_overlap_jobs(
+    vector<SweepJob_t>& jobs, 
+    vector<vector<double>>& level_vals, 
+    const int dim, 
+    const vector<unsigned long int>& checkpoints, 
+    const int n_trials, 
+    const double R1, 
+    const double R2, 
+    const double sep, 
+    IntegratorType type 
+)
+{
+    const bool deterministic = (type == kQuasirandom || type == kGrid || type == kAdaptiveGrid || type == kAnalytic || type == kAxisymmetric
+                                || type == kQuasirandomConditional || type == kGridConditional || type == kQuasirandomControlVariate); 
+
+    const int n_runs = deterministic ? 1 : n_trials; 
+
+    level_vals.assign(checkpoints.size(), vector<double>(n_runs, 0.)); 
+
+    const bool nested = (type == kMontecarlo || type == kQuasirandom || type == kMontecarloConditional || type == kQuasirandomConditional); 
+
+    for (int n=0; n<n_runs; n++) {
+
+        if (nested) {
+            jobs.push_back({ (double)(checkpoints.back() * dim), [=, &level_vals]{
+                const auto results = compute_sphere_overlap_checkpoints(dim, checkpoints, R1, R2, sep, type); 
+                for (size_t i=0; i<checkpoints.size(); i++) level_vals[i][n] = results[i].val; 
+            }}); 
+            continue; 
+        }
+
+        for (size_t i=0; i<checkpoints.size(); i++) {
+            jobs.push_back({ (double)(checkpoints[i] * dim), [=, &level_vals]{
+                level_vals[i][n] = compute_sphere_overlap(dim, checkpoints[i], R1, R2, sep, type).val; 
+            }}); 
+        }
+    }
+}
+
 
 int main(int argc, char* argv[])
 {   
@@ -81,6 +129,10 @@ int main(int argc, char* argv[])
     const char* path_graphic = "test-methods.png"; 
     if (argc > 2) path_graphic = argv[2];  
 
+    //if asked for (see RunTelemetry.hpp), record every integrator call, and write the records out at the end
+    const char* path_telemetry = getenv(kTelemetryEnvVar); 
+    if (path_telemetry) SetTelemetryEnabled(true); 
+
     //
     cout << "making plots: " << plots_to_make << "..." << endl; 
 
@@ -122,24 +174,22 @@ int main(int argc, char* argv[])
             vector<double> graphPts_vol_mean;
             vector<double> graphPts_vol_stdddev;  
 
-            unsigned long int n_integ_pts = n_integ_pts_0; 
-            
-            for (int i=0; i<n_eval_levels; i++) {
+            //the number of points at each level 
+            vector<unsigned long int> checkpoints; 
+            for (int i=0; i<n_eval_levels; i++) checkpoints.push_back( n_integ_pts_0 << i ); 
 
-                //now, actually eval the integral a given number of times
-                vector<double> vals{}; vals.reserve(n_evals_per_pt);  
+            //now, actually eval the integral a given number of times (all the levels and trials side by side). 
+            // level_vals[i] is the list of results with the number of points of level i. 
+            vector<vector<double>> level_vals; 
 
-                for (int n=0; n<n_evals_per_pt; n++) {
+            vector<SweepJob_t> jobs; 
+            add_sphere_overlap_jobs(jobs, level_vals, dim, checkpoints, n_evals_per_pt, sphere_1_rad, sphere_2_rad, sphere_sep, kGrid); 
+            RunSweep(jobs); 
 
-                    double volume = compute_sphere_overlap(
-                        dim, 
-                        n_integ_pts, 
-                        sphere_1_rad, 
-                        sphere_2_rad, 
-                        sphere_sep, kGrid
-                    ); 
-                    vals.push_back(volume); 
-                }
+            for (int i=0; i<n_eval_levels; i++) {
+
+                const unsigned long int n_integ_pts = checkpoints[i]; 
+                const vector<double>& vals = level_vals[i]; 
 
                 //now, compute the stddev and mean
                 double mean, stddev; 
@@ -163,10 +213,6 @@ int main(int argc, char* argv[])
                 max_y = max<double>( mean + stddev, max_y ); 
 
                 max_stddev = max<double>( stddev, max_stddev );
-
-
-                //double the number of stone-throwing tries
-                n_integ_pts *= 2; 
             }
             
             //now we're done evaluating all points. 
@@ -245,6 +291,7 @@ int main(int argc, char* argv[])
         }
 
         canv->SaveAs(path_graphic); 
+        if (path_telemetry && !WriteTelemetryLog(path_telemetry)) printf("couldn't write the telemetry to '%s'\n", path_telemetry); 
         return 0; 
     }   
     //______________________________________________________________________________________
@@ -278,7 +325,8 @@ int main(int argc, char* argv[])
         int i_canv=1; 
         for (const int dim : dims) {
 
-            const double vol_analytical = pow( TMath::Pi(), ((double)dim)/2. ) / ROOT::Math::tgamma( 1. + ((double)dim)/2. ); 
+            //the exact overlap, which the relative errors are taken against
+            const double vol_analytical = sphere_overlap_volume(dim, sphere_1_rad, sphere_2_rad, sphere_sep); 
             
             double min_y{+1.e30}, max_y{-1.e30}; 
             double max_stddev{0.};
@@ -288,53 +336,51 @@ int main(int argc, char* argv[])
             struct GraphPoints_t { vector<double> pts, mean, stddev; };
             
             //_______________________________________________________________________________________________________________
-            auto compute_mean_stddev = [&](double n_integrate_pts, GraphPoints_t& points, IntegratorType type)
-            {
-                vector<double> vals;
-
-                for (int n=0; n<n_evals_per_pt; n++) {
-
-                    double volume = compute_sphere_overlap(
-                        dim, 
-                        n_integrate_pts, 
-                        sphere_1_rad, 
-                        sphere_2_rad, 
-                        sphere_sep, type
-                    ); 
+            //the number of points at each level (each one doubles the number of stone-throwing tries)
+            vector<unsigned long int> checkpoints; 
+            for (int i=0; i<n_eval_levels; i++) checkpoints.push_back( n_integ_pts_0 << i ); 
 
-                    volume = (volume - vol_analytical)/vol_analytical; 
-
-                    vals.push_back(volume); 
+            //_______________________________________________________________________________________________________________
+            auto compute_mean_stddev = [&](GraphPoints_t& points, vector<vector<double>>& level_vals)
+            {
+                for (int i=0; i<n_eval_levels; i++) {
+
+                    //the relative errors of level i
+                    for (double& val : level_vals[i]) val = (val - vol_analytical)/vol_analytical; 
+                    
+                    //now, compute the stddev and mean
+                    double mean, stddev; 
+                    compute_vector_stddev_mean(level_vals[i], mean, stddev);
+
+                    points.pts     .push_back(sqrt(checkpoints[i]));
+                    points.mean    .push_back(mean); 
+                    points.stddev  .push_back(stddev); 
+                    
+                    //find the min and max y-vals in the dataset 
+                    min_y = min<double>( (mean - stddev), min_y ); 
+                    max_y = max<double>( (mean + stddev), max_y ); 
+
+                    max_stddev = max<double>( stddev, max_stddev );
                 }
-                //now, compute the stddev and mean
-                double mean, stddev; 
-                compute_vector_stddev_mean(vals, mean, stddev);
-
-                points.pts     .push_back(sqrt(n_integrate_pts));
-                points.mean    .push_back(mean); 
-                points.stddev  .push_back(stddev); 
-                
-                //find the min and max y-vals in the dataset 
-                min_y = min<double>( (mean - stddev), min_y ); 
-                max_y = max<double>( (mean + stddev), max_y ); 
-
-                max_stddev = max<double>( stddev, max_stddev );
             }; 
             //_______________________________________________________________________________________________________________
             
-            GraphPoints_t pts_pseudo, pts_quasi, pts_grid; 
+            //every trial of every method, at every level, side by side
+            vector<vector<double>> vals_pseudo, vals_quasi, vals_grid; 
 
-            unsigned long int n_integ_pts = n_integ_pts_0; 
-            
-            for (int i=0; i<n_eval_levels; i++) {
+            vector<SweepJob_t> jobs; 
+            add_sphere_overlap_jobs(jobs, vals_pseudo, dim, checkpoints, n_evals_per_pt, sphere_1_rad, sphere_2_rad, sphere_sep, kMontecarlo); 
+            //(the plain sobol sequence is the same every time, so the trials use the scrambled one: each call 
+            // draws a fresh seed, so each trial gets its own independent scrambles)
+            add_sphere_overlap_jobs(jobs, vals_quasi,  dim, checkpoints, n_evals_per_pt, sphere_1_rad, sphere_2_rad, sphere_sep, kScrambledQuasirandom); 
+            add_sphere_overlap_jobs(jobs, vals_grid,   dim, checkpoints, n_evals_per_pt, sphere_1_rad, sphere_2_rad, sphere_sep, kGrid); 
+            RunSweep(jobs); 
 
-                compute_mean_stddev(n_integ_pts, pts_pseudo, kMontecarlo);
-                compute_mean_stddev(n_integ_pts, pts_quasi,  kQuasirandom);
-                compute_mean_stddev(n_integ_pts, pts_grid,   kGrid);
+            GraphPoints_t pts_pseudo, pts_quasi, pts_grid; 
 
-                //double the number of stone-throwing tries
-                n_integ_pts *= 2; 
-            }
+            compute_mean_stddev(pts_pseudo, vals_pseudo);
+            compute_mean_stddev(pts_quasi,  vals_quasi);
+            compute_mean_stddev(pts_grid,   vals_grid);
             
             //now we're done evaluating all points. 
             vector<double> x_errors(n_eval_levels, 0.); 
@@ -369,10 +415,10 @@ int main(int argc, char* argv[])
             );  
 
             hist_frame->SetTitle(Form(
-                "unit %i-ball volume;"     //title
+                "%id (r_{1}= %.1f, r_{2}= %.1f, a= %.1f);"     //title
                 "#sqrt{N. integration pts};"                   //x-axis    
                 "relative error of computed volume (mean & std.dev. of %i trials)",       //y-axis    
-                dim, n_evals_per_pt
+                dim, sphere_1_rad, sphere_2_rad, sphere_sep, n_evals_per_pt
             ));        
             
             //draw the graph of calculated volume values
@@ -402,7 +448,7 @@ int main(int argc, char* argv[])
             auto legend = new TLegend(0.6,0.1, 1.0,0.4); 
             legend->SetHeader("integrator");
             legend->AddEntry(g_pseudo,  "pseudo");
-            legend->AddEntry(g_quasi,   "quasi");
+            legend->AddEntry(g_quasi,   "quasi (scrambled)");
             legend->AddEntry(g_grid,    "grid");
             if (i_canv<2) legend->Draw(); 
 
@@ -410,6 +456,7 @@ int main(int argc, char* argv[])
         }
 
         canv->SaveAs(path_graphic); 
+        if (path_telemetry && !WriteTelemetryLog(path_telemetry)) printf("couldn't write the telemetry to '%s'\n", path_telemetry); 
         return 0; 
     }
 
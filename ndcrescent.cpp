@@ -1,11 +1,14 @@
 #include <MontecarloIntegrate.hpp> 
+#include "PhiloxRandom.hpp"
 #include "compute_unitball_volume.hpp"
 #include "compute_sphere_overlap.hpp"
+#include "RunTelemetry.hpp"
 #include <cmath> 
 #include <iostream>
 #include <TGraph.h> 
 #include <TCanvas.h>  
 #include <cstdio> 
+#include <cstdlib> 
 #include <TF1.h> 
 #include <TLegend.h> 
 #include <TPad.h> 
@@ -25,24 +28,35 @@ int main(int argc, char* argv[])
     double rad1         = argc > i_arg ? atof(argv[i_arg++])    :   1.; 
     double sep          = argc > i_arg ? atof(argv[i_arg++])    :   0.; 
 
+    //the seed of the random stream. if none is given, we pick one (and print it), so that the 
+    // run can be repeated exactly. 
+    uint64_t seed       = argc > i_arg ? strtoull(argv[i_arg++], nullptr, 0) : Philox::ResolveSeed(std::nullopt); 
+
     printf(
         "dim    = %i\n"
         "N pts. = %li\n"
         "r1     = %.5f\n"
         "r0     = %.5f\n"
-        "sep    = %.5f\n",
+        "sep    = %.5f\n"
+        "seed   = %llu\n",
 
-        dim, N, rad0, rad1, sep
+        dim, N, rad0, rad1, sep, (unsigned long long)seed
     );
 
+    //if asked for (see RunTelemetry.hpp), record the integrator call, and write the record out at the end
+    const char* path_telemetry = getenv(kTelemetryEnvVar); 
+    if (path_telemetry) SetTelemetryEnabled(true); 
+
     cout << "computing..." << flush; 
 
-    auto result = compute_sphere_overlap(dim, N, rad0, rad1, sep); 
+    auto result = compute_sphere_overlap(dim, N, rad0, rad1, sep, kMontecarlo, seed); 
 
     double vol = result.val;
     double err = result.error; 
 
     printf("done\nvolume of intersection: %.6e +/- %.3e\n", vol, err);
 
+    if (path_telemetry && !WriteTelemetryLog(path_telemetry)) printf("couldn't write the telemetry to '%s'\n", path_telemetry); 
+
     return 0; 
 }
\ No newline at end of file
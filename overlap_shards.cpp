@@ -0,0 +1,151 @@
+#include "compute_sphere_overlap.hpp"
+#include "ShardRecord.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+// The sphere overlap (see compute_sphere_overlap), split between several processes. each 'worker' runs one
+// shard of the points, and writes the record of its partial result (see ShardRecord.hpp) to stdout; the
+// records are then merged into the result, which is the same as that of a single process.
+//
+// usage:
+//
+//  ./overlap_shards worker <i_shard> <n_shards> <dim> <N> <R1> <R2> <sep> <seed> [type=1] > shard_i.txt
+//  ./overlap_shards merge [shard_0.txt shard_1.txt ...]      (reads the records from stdin if no files are given)
+//  ./overlap_shards run <n_shards> <dim> <N> <R1> <R2> <sep> <seed> [type=1]
+//
+// 'run' starts all the workers at once as child processes (on this machine), reads their records back
+// through pipes, merges them, and checks the result against a single-process run. 'type' is the integrator
+// (1 = kMontecarlo, 2 = kQuasirandom, 9 = kMontecarloConditional, 10 = kQuasirandomConditional).
+
+namespace {
+
+    //the arguments which describe the integration (the same for every shard)
+    struct OverlapArgs_t {
+        int dim;
+        unsigned long int N;
+        double R1, R2, sep;
+        unsigned long long seed;
+        IntegratorType type;
+    };
+
+    //reads the args, starting at argv[i_arg]
+    OverlapArgs_t parse_overlap_args(int argc, char* argv[], int i_arg)
+    {
+        if (argc < i_arg + 6) throw invalid_argument("expected: <dim> <N> <R1> <R2> <sep> <seed> [type=1]");
+
+        OverlapArgs_t args;
+        args.dim  = atoi(argv[i_arg++]);
+        args.N    = (unsigned long int)atof(argv[i_arg++]);
+        args.R1   = atof(argv[i_arg++]);
+        args.R2   = atof(argv[i_arg++]);
+        args.sep  = atof(argv[i_arg++]);
+        args.seed = strtoull(argv[i_arg++], nullptr, 10);
+        args.type = argc > i_arg ? (IntegratorType)atoi(argv[i_arg++]) : kMontecarlo;
+        return args;
+    }
+
+    void print_result(const char* label, const ValueWithError_t<double>& result)
+    {
+        printf("%-8s %.17g +/- %.6g\n", label, result.val, result.error);
+    }
+
+    int usage()
+    {
+        fprintf(stderr,
+            "usage:\n"
+            "  overlap_shards worker <i_shard> <n_shards> <dim> <N> <R1> <R2> <sep> <seed> [type=1]\n"
+            "  overlap_shards merge [files...]\n"
+            "  overlap_shards run <n_shards> <dim> <N> <R1> <R2> <sep> <seed> [type=1]\n");
+        return 1;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) return usage();
+    const string mode = argv[1];
+
+    try {
+
+        if (mode == "worker") {
+            if (argc < 4) return usage();
+            const unsigned int i_shard  = atoi(argv[2]);
+            const unsigned int n_shards = atoi(argv[3]);
+            const OverlapArgs_t a = parse_overlap_args(argc, argv, 4);
+
+            WriteShardRecord(cout, compute_sphere_overlap_shard(a.dim, i_shard, n_shards, a.N, a.R1, a.R2, a.sep, a.type, a.seed));
+            return 0;
+        }
+
+        if (mode == "merge") {
+            vector<ShardRecord_t> records;
+            if (argc == 2) records = ReadShardRecords(cin);
+
+            for (int i=2; i<argc; i++) {
+                ifstream file(argv[i]);
+                if (!file) { fprintf(stderr, "can't open '%s'\n", argv[i]); return 1; }
+                for (auto& record : ReadShardRecords(file)) records.push_back(move(record));
+            }
+
+            print_result("merged", MergeShardRecords(records));
+            return 0;
+        }
+
+        if (mode == "run") {
+            if (argc < 3) return usage();
+            const unsigned int n_shards = atoi(argv[2]);
+            const OverlapArgs_t a = parse_overlap_args(argc, argv, 3);
+
+            //start all the workers, then collect their records (each worker's record is one line on its stdout)
+            vector<FILE*> pipes;
+            for (unsigned int i_shard=0; i_shard<n_shards; i_shard++) {
+                char cmd[1024];
+                snprintf(cmd, sizeof(cmd), "'%s' worker %u %u %i %lu %.17g %.17g %.17g %llu %i",
+                    argv[0], i_shard, n_shards, a.dim, a.N, a.R1, a.R2, a.sep, a.seed, (int)a.type);
+
+                FILE* pipe = popen(cmd, "r");
+                if (!pipe) { fprintf(stderr, "couldn't start worker %u\n", i_shard); return 1; }
+                pipes.push_back(pipe);
+            }
+
+            vector<ShardRecord_t> records;
+            bool ok=true;
+            for (unsigned int i_shard=0; i_shard<n_shards; i_shard++) {
+                string line;
+                char buf[4096];
+                while (fgets(buf, sizeof(buf), pipes[i_shard])) line += buf;
+
+                if (pclose(pipes[i_shard]) != 0 || line.empty()) {
+                    fprintf(stderr, "worker %u failed\n", i_shard);
+                    ok = false;
+                    continue;
+                }
+                records.push_back( ShardRecord_t::FromString(line) );
+            }
+            if (!ok) return 1;
+
+            const ValueWithError_t<double> merged = MergeShardRecords(records);
+            const ValueWithError_t<double> single = compute_sphere_overlap(a.dim, a.N, a.R1, a.R2, a.sep, a.type, a.seed);
+
+            print_result("merged", merged);
+            print_result("single", single);
+
+            const bool same = (merged.val == single.val && merged.error == single.error);
+            printf("%s\n", same ? "identical" : "DIFFERENT");
+            return same ? 0 : 1;
+        }
+
+    } catch (const exception& e) {
+        fprintf(stderr, "error: %s\n", e.what());
+        return 1;
+    }
+
+    return usage();
+}
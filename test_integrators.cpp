@@ -0,0 +1,689 @@
+#include "MontecarloIntegrate.hpp"
+#include "SobolIntegrate.hpp"
+#include "SobolSequence.hpp"
+#include "VegasIntegrate.hpp"
+#include "MiserIntegrate.hpp"
+#include "PhiloxRandom.hpp"
+#include "SphereKernels.hpp"
+#include "ShardRecord.hpp"
+#include "SweepScheduler.hpp"
+#include "SimdLevel.hpp"
+#include "ThreadPool.hpp"
+#include "compute_sphere_overlap.hpp"
+#include "SphereOverlapAnalytic.hpp"
+#include "BallIntegrate.hpp"
+#include "GridIntegrate.hpp"
+#include "RunTelemetry.hpp"
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <thread>
+#include <chrono>
+
+using namespace std;
+
+// Checks of the things which are meant to come out exactly the same, bit for bit: the philox generator
+// (against the published known answers), the sobol sequence (against points from Joe & Kuo's direction
+// numbers), the AVX2 / AVX-512 kernels (against the scalar ones), runs on one thread vs. all of them, and
+// shards of a run merged together vs. the run itself. it also checks the exact sphere overlap (against closed
+// forms and a quadrature), and that the error bars of the integrators cover it (with fixed seeds, so these
+// come out the same every time, too). it needs no ROOT, and is run by ctest. (set INTEGRATORS_THREADS to
+// give the pool more threads than the machine has; the ctest run uses 4.)
+//
+// usage:
+//
+//  ./test_integrators
+//
+// prints one line per check, and returns 1 if any of them failed.
+
+namespace {
+
+    int g_n_checks=0, g_n_failed=0;
+
+    void check(const bool ok, const string& what)
+    {
+        g_n_checks++;
+        if (!ok) g_n_failed++;
+        printf("%s %s\n", ok ? "  ok  " : "  FAIL", what.c_str());
+    }
+
+    //the same bits (so NaN == NaN, and 0. != -0.)
+    bool same_bits(const double a, const double b) { return memcmp(&a, &b, sizeof(double)) == 0; }
+
+    bool same_result(const ValueWithError_t<double>& a, const ValueWithError_t<double>& b)
+    {
+        return same_bits(a.val, b.val) && same_bits(a.error, b.error);
+    }
+
+    const char* level_name(const SimdLevel level)
+    {
+        switch (level) {
+            case (kSimdAVX512)  : return "avx512";
+            case (kSimdAVX2)    : return "avx2";
+            default             : return "scalar";
+        }
+    }
+
+    //every level this cpu can run, narrowest first
+    vector<SimdLevel> available_levels()
+    {
+        vector<SimdLevel> levels;
+        for (int level=kSimdScalar; level<=(int)detect_simd_level(); level++) levels.push_back((SimdLevel)level);
+        return levels;
+    }
+
+    //a SoA block of n points (of 'dim' coordinates), with block[i*n + j] the i-th coordinate of point j
+    struct Block_t {
+        vector<double> data;
+        vector<double*> X;
+
+        Block_t(const int dim, const unsigned long int n) : data(dim * n), X(dim)
+        {
+            for (int i=0; i<dim; i++) X[i] = data.data() + i*n;
+        }
+    };
+
+    //_______________________________________________________________________________
+    //the known-answer vectors of Philox4x32-10, from Random123 (kat_vectors)
+    void test_philox_known_answers()
+    {
+        struct Kat_t { array<uint32_t, 4> ctr; array<uint32_t, 2> key; array<uint32_t, 4> expected; };
+
+        const vector<Kat_t> kats{
+            { {0x00000000, 0x00000000, 0x00000000, 0x00000000}, {0x00000000, 0x00000000}, {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8} },
+            { {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff}, {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd} },
+            { {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0}, {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1} }
+        };
+
+        for (size_t i=0; i<kats.size(); i++) {
+            check(Philox::Block(kats[i].ctr, kats[i].key) == kats[i].expected, "philox4x32-10 known-answer vector "+to_string(i));
+        }
+    }
+
+    //_______________________________________________________________________________
+    //philox_fill_block (vectorized over the points) vs. philox_point (one point at a time), on each level
+    void test_philox_fill_block()
+    {
+        const uint64_t seed = 0x0123456789abcdefull;
+
+        for (const SimdLevel level : available_levels()) {
+            set_simd_level_limit(level);
+
+            bool ok=true;
+            for (int dim=1; dim<=9; dim++) {
+
+                vector<IntegrationBound_t> bounds;
+                for (int i=0; i<dim; i++) bounds.push_back({ -1. - 0.25*i, 0.5 + i });
+
+                //(odd sizes, and starting points, so the vector loops have leftovers at both ends)
+                for (const unsigned long int n : {1ul, 7ul, 8ul, 13ul, 256ul, 301ul}) {
+                    for (const uint64_t first_pt : {0ull, 3ull, 1000003ull, 0xfffffffffull}) {
+
+                        Block_t block(dim, n);
+                        philox_fill_block(seed, first_pt, n, bounds, block.X.data());
+
+                        vector<double> point(dim);
+                        for (unsigned long int j=0; j<n; j++) {
+                            philox_point(seed, first_pt + j, bounds, point.data());
+                            for (int i=0; i<dim; i++) ok = ok && same_bits(point[i], block.X[i][j]);
+                        }
+                    }
+                }
+            }
+            check(ok, string("philox_fill_block == philox_point (")+level_name(level)+")");
+        }
+        set_simd_level_limit(kSimdAVX512);
+    }
+
+    //_______________________________________________________________________________
+    //the sphere kernels vs. plain loops (with the same order of operations), on each level
+    unsigned long int reference_inside_ball(const unsigned long int n, const int dim, const double* const* X, const double R_R)
+    {
+        unsigned long int count=0;
+        for (unsigned long int j=0; j<n; j++) {
+            double val=0.;
+            for (int i=0; i<dim; i++) val += X[i][j]*X[i][j];
+            if (val < R_R) count++;
+        }
+        return count;
+    }
+
+    unsigned long int reference_inside_both(
+        const unsigned long int n, const int dim, const double* const* X, const double R1_R1, const double R2_R2, const double sep
+    )
+    {
+        unsigned long int count=0;
+        for (unsigned long int j=0; j<n; j++) {
+            double val=0.;
+            for (int i=0; i<dim; i++) val += X[i][j]*X[i][j];
+            if (val > R1_R1) continue;
+            const double x0 = X[0][j];
+            val += (( x0 - sep )*( x0 - sep )) - ( x0*x0 );
+            if (val > R2_R2) continue;
+            count++;
+        }
+        return count;
+    }
+
+    void test_sphere_kernels()
+    {
+        const unsigned long int n = 1001;
+        const double R1 = 1., R2 = 0.75, sep = 0.5;
+
+        //a few configurations for the 'multi' kernel (the first is the one above)
+        const vector<double> R1_R1{ R1*R1, 1., 0.81 }, R2_R2{ R2*R2, 0.25, 0.64 }, seps{ sep, 1.1, 0. };
+
+        for (const SimdLevel level : available_levels()) {
+            set_simd_level_limit(level);
+
+            bool ok_ball=true, ok_both=true, ok_multi=true, ok_indicator=true;
+            for (int dim=1; dim<=12; dim++) {
+
+                Block_t block(dim, n);
+                mt19937_64 rng(42 + dim);
+                uniform_real_distribution<double> uniform(-1.1, 1.1);
+                for (double& x : block.data) x = uniform(rng);
+
+                //put some of the points right on the spheres, where the order of operations matters most
+                for (unsigned long int j=0; j<n; j+=17) {
+                    for (int i=0; i<dim; i++) block.X[i][j] = 0.;
+                    block.X[0][j] = (j % 34 == 0) ? R1 : sep - R2;
+                }
+
+                const double* const* X = block.X.data();
+
+                ok_ball = ok_ball && count_inside_ball(n, dim, X, R1*R1) == reference_inside_ball(n, dim, X, R1*R1);
+                ok_both = ok_both && count_inside_both_spheres(n, dim, X, R1*R1, R2*R2, sep) == reference_inside_both(n, dim, X, R1*R1, R2*R2, sep);
+
+                vector<unsigned long int> counts(R1_R1.size(), 0);
+                count_inside_both_spheres_multi(n, dim, X, R1_R1.size(), R1_R1.data(), R2_R2.data(), seps.data(), counts.data());
+                for (size_t k=0; k<counts.size(); k++) {
+                    ok_multi = ok_multi && counts[k] == reference_inside_both(n, dim, X, R1_R1[k], R2_R2[k], seps[k]);
+                }
+
+                vector<double> inside(n);
+                inside_both_spheres_indicator(n, dim, X, R1*R1, R2*R2, sep, inside.data());
+                double sum=0.;
+                for (const double x : inside) sum += x;
+                ok_indicator = ok_indicator && sum == (double)reference_inside_both(n, dim, X, R1*R1, R2*R2, sep);
+            }
+            check(ok_ball,      string("count_inside_ball == scalar reference (")+level_name(level)+")");
+            check(ok_both,      string("count_inside_both_spheres == scalar reference (")+level_name(level)+")");
+            check(ok_multi,     string("count_inside_both_spheres_multi == scalar reference (")+level_name(level)+")");
+            check(ok_indicator, string("inside_both_spheres_indicator == scalar reference (")+level_name(level)+")");
+        }
+        set_simd_level_limit(kSimdAVX512);
+    }
+
+    //_______________________________________________________________________________
+    //points of the unscrambled sequence in high dimensions, vs. those from Joe & Kuo's new-joe-kuo-6.21201 
+    // direction numbers (as generated by an independent implementation, with 32 bits per coordinate)
+    void test_sobol_joe_kuo()
+    {
+        const vector<int> dims{ 14, 500, 1000, 1111 };
+
+        struct Reference_t { uint64_t index; vector<uint32_t> coords; };    //coords[k] is dimension dims[k], times 2^32
+        const vector<Reference_t> references{
+            { 3,       { 3221225472u, 3221225472u, 1073741824u, 1073741824u } },
+            { 100,     { 3657433088u, 2113929216u, 3925868544u, 1979711488u } },
+            { 1999,    { 2833252352u, 2640314368u, 4007657472u, 3328180224u } },
+            { 1000003, { 1216950272u, 3871584256u,  170749952u,  665669632u } }
+        };
+
+        SobolSequence sobol(SobolSequence::kMaxDim);
+        vector<double> point(SobolSequence::kMaxDim);
+
+        for (const auto& reference : references) {
+            sobol.Seek(reference.index);
+            sobol.Next(point.data());
+
+            bool ok=true;
+            for (size_t k=0; k<dims.size(); k++) ok = ok && point[dims[k]-1] == ((double)reference.coords[k]) / 4294967296.;
+            check(ok, "SobolSequence point "+to_string(reference.index)+" == joe-kuo reference (dims 14 ... 1111)");
+        }
+    }
+
+    //_______________________________________________________________________________
+    //SobolSequence::NextBlock (8 points at a time) vs. Next (one at a time), on each level
+    void test_sobol_blocks()
+    {
+        for (const SimdLevel level : available_levels()) {
+            set_simd_level_limit(level);
+
+            bool ok=true;
+            for (const int dim : {1, 2, 5, 13, 40}) {
+                const vector<IntegrationBound_t> bounds(dim, IntegrationBound_t{ -2., 3. });
+
+                for (const uint64_t first : {0ull, 5ull, 4096ull, 1234567ull}) {
+                    const unsigned long int n = 203;
+
+                    SobolSequence by_block(dim), by_point(dim);
+                    by_block.Seek(first);
+                    by_point.Seek(first);
+
+                    Block_t block(dim, n);
+                    by_block.NextBlock(n, bounds, block.X.data());
+
+                    vector<double> point(dim);
+                    for (unsigned long int j=0; j<n; j++) {
+                        by_point.Next(point.data());
+                        for (int i=0; i<dim; i++) ok = ok && same_bits(block.X[i][j], bounds[i].xmin + (bounds[i].xmax - bounds[i].xmin)*point[i]);
+                    }
+                }
+            }
+            check(ok, string("SobolSequence::NextBlock == Next (")+level_name(level)+")");
+        }
+        set_simd_level_limit(kSimdAVX512);
+    }
+
+    //_______________________________________________________________________________
+    //the same result on one thread as on all of them
+    void test_thread_counts()
+    {
+        const unsigned int n_threads = ThreadPool::Global().NumThreads();
+        if (n_threads == 1) printf("  (the pool has only 1 thread; set %s to test more)\n", ThreadPool::kThreadsEnvVar);
+
+        const int dim = 5;
+        const unsigned long int n_pts = 1000003;
+        const double R1_R1 = 1., R2_R2 = 0.5625, sep = 0.5;
+
+        const vector<IntegrationBound_t> bounds(dim, IntegrationBound_t{ -1., 1. });
+        const vector<IntegrationBound_t> bounds_perp(dim-1, IntegrationBound_t{ -0.75, 0.75 });
+
+        const BatchIntegrand_t count_fcn = [=](const unsigned long int n, const double* const* X)
+        {
+            return count_inside_both_spheres(n, dim, X, R1_R1, R2_R2, sep);
+        };
+        const BatchValueIntegrand_t value_fcn = [=](const unsigned long int n, const double* const* X, double* f)
+        {
+            lens_chord_lengths(n, dim-1, X, R1_R1, R2_R2, sep, f);
+        };
+
+        //(for the integrators which take one point at a time)
+        const function<bool(const double*)> point_fcn = [=](const double* x)
+        {
+            const double* X[dim];
+            for (int i=0; i<dim; i++) X[i] = x + i;
+            return reference_inside_both(1, dim, X, R1_R1, R2_R2, sep) == 1;
+        };
+
+        const string threads = " (1 vs. "+to_string(n_threads)+" threads)";
+
+        check(same_result(MontecarloIntegrate(n_pts, bounds,      count_fcn, 7ull, 1), MontecarloIntegrate(n_pts, bounds,      count_fcn, 7ull, 0)), "MontecarloIntegrate, counting"+threads);
+        check(same_result(MontecarloIntegrate(n_pts, bounds_perp, value_fcn, 7ull, 1), MontecarloIntegrate(n_pts, bounds_perp, value_fcn, 7ull, 0)), "MontecarloIntegrate, real-valued"+threads);
+        check(same_result(SobolIntegrate(n_pts, bounds,      count_fcn, 1), SobolIntegrate(n_pts, bounds,      count_fcn, 0)), "SobolIntegrate, counting"+threads);
+        check(same_result(SobolIntegrate(n_pts, bounds_perp, value_fcn, 1), SobolIntegrate(n_pts, bounds_perp, value_fcn, 0)), "SobolIntegrate, real-valued"+threads);
+
+        //(every replica gets the same number of points, so n_pts must be a multiple of the number of replicas)
+        const unsigned long int n_scrambled = n_pts - n_pts % kSobolReplicas;
+        check(same_result(ScrambledSobolIntegrate(n_scrambled, bounds, count_fcn, kSobolReplicas, 7ull, 1), ScrambledSobolIntegrate(n_scrambled, bounds, count_fcn, kSobolReplicas, 7ull, 0)), "ScrambledSobolIntegrate, counting"+threads);
+
+        bool rejected=false;
+        try { ScrambledSobolIntegrate(n_pts, bounds_perp, value_fcn); } catch (const invalid_argument&) { rejected = true; }
+        check(rejected, "ScrambledSobolIntegrate rejects n_pts which isn't a multiple of n_replicas");
+        check(same_result(VegasIntegrate(n_pts, bounds, point_fcn, kVegasIterations, 7ull, 1), VegasIntegrate(n_pts, bounds, point_fcn, kVegasIterations, 7ull, 0)), "VegasIntegrate"+threads);
+    }
+
+    //_______________________________________________________________________________
+    //the integrators which need to know which points are inside: their batch versions (one call per block)
+    // vs. their point-by-point versions, which must give exactly the same result
+    void test_batch_overloads()
+    {
+        const int dim = 5;
+        const unsigned long int n_pts = 300007;
+        const double R1_R1 = 1., R2_R2 = 0.5625, sep = 0.5;
+
+        const vector<IntegrationBound_t> bounds(dim, IntegrationBound_t{ -1., 1. });
+
+        const BatchValueIntegrand_t indicator_fcn = [=](const unsigned long int n, const double* const* X, double* f)
+        {
+            inside_both_spheres_indicator(n, dim, X, R1_R1, R2_R2, sep, f);
+        };
+        const BatchIntegrand_t count_fcn = [=](const unsigned long int n, const double* const* X)
+        {
+            return count_inside_both_spheres(n, dim, X, R1_R1, R2_R2, sep);
+        };
+        const function<bool(const double*)> point_fcn = [=](const double* x)
+        {
+            const double* X[dim];
+            for (int i=0; i<dim; i++) X[i] = x + i;
+            return reference_inside_both(1, dim, X, R1_R1, R2_R2, sep) == 1;
+        };
+
+        const auto vegas = VegasIntegrate(n_pts, bounds, indicator_fcn, kVegasIterations, 7ull);
+        check(same_result(vegas, VegasIntegrate(n_pts, bounds, point_fcn, kVegasIterations, 7ull)), "VegasIntegrate, batch == point by point");
+        check(same_result(vegas, VegasIntegrate(n_pts, bounds, indicator_fcn, kVegasIterations, 7ull, 1)), "VegasIntegrate, batch (1 vs. all threads)");
+
+        const auto miser = MiserIntegrate(n_pts, bounds, indicator_fcn, 7ull);
+        check(same_result(miser, MiserIntegrate(n_pts, bounds, count_fcn, 7ull)), "MiserIntegrate, indicator == counting");
+        check(same_result(miser, MiserIntegrate(n_pts, bounds, point_fcn, 7ull)), "MiserIntegrate, indicator == point by point");
+        check(same_result(miser, MiserIntegrate(n_pts, bounds, indicator_fcn, 7ull, 1)), "MiserIntegrate, indicator (1 vs. all threads)");
+
+        //the point-by-point adapter of a batch fcn (with its coordinate pointers on the stack, and on the heap)
+        for (const int d : { dim, kPointIntegrandStackDim + 6 }) {
+            const auto is_inside_ball = make_point_integrand(d, [d](const unsigned long int n, const double* const* X)
+            {
+                return count_inside_ball(n, d, X, 1.);
+            });
+            vector<double> x(d, 0.);
+            bool ok=true;
+            for (const double x_last : { 0., 0.5, 0.99, 1., 1.5 }) {
+                x[d-1] = x_last;
+                ok = ok && is_inside_ball(x.data()) == (x_last*x_last < 1.);
+            }
+            check(ok, "make_point_integrand (dim "+to_string(d)+")");
+        }
+    }
+
+    //_______________________________________________________________________________
+    //a sweep of jobs vs. the same jobs one after the other, with fewer jobs than threads (each is run on its 
+    // own, with all of the threads), and with many more (side by side, one per thread) 
+    void test_sweep()
+    {
+        const vector<IntegrationBound_t> bounds(4, IntegrationBound_t{ -1., 1. });
+        const BatchIntegrand_t count_fcn = [](const unsigned long int n, const double* const* X)
+        {
+            return count_inside_ball(n, 4, X, 1.);
+        };
+
+        for (const unsigned long int n_jobs : { 2ul, 40ul }) {
+
+            vector<ValueWithError_t<double>> swept(n_jobs);
+            vector<unsigned int> n_threads_seen(n_jobs, 0);
+            vector<SweepJob_t> jobs;
+            for (unsigned long int k=0; k<n_jobs; k++) {
+                jobs.push_back({ (double)(100000 * (k + 1)), [&, k]{
+                    swept[k] = MontecarloIntegrate(100000 * (k + 1), bounds, count_fcn, (uint64_t)k);
+
+                    //(how many of the pool's threads a parallel loop inside the job gets)
+                    vector<char> used(ThreadPool::Global().NumThreads(), 0);
+                    ThreadPool::Global().ParallelFor(64, [&](unsigned long int, unsigned int i_thread)
+                    {
+                        used[i_thread] = 1;
+                        this_thread::sleep_for(chrono::milliseconds(1));   //(so the calling thread can't steal all of them first)
+                    }, {}, 1e6);
+                    for (const char u : used) n_threads_seen[k] += u;
+                }});
+            }
+            RunSweep(jobs);
+
+            bool ok=true;
+            for (unsigned long int k=0; k<n_jobs; k++) ok = ok && same_result(swept[k], MontecarloIntegrate(100000 * (k + 1), bounds, count_fcn, (uint64_t)k));
+            check(ok, "RunSweep == jobs one by one ("+to_string(n_jobs)+" jobs)");
+        
+            if (n_jobs < ThreadPool::Global().NumThreads()) {
+                bool ok_inner=true;
+                for (const unsigned int n : n_threads_seen) ok_inner = ok_inner && n > 1;
+                check(ok_inner, "RunSweep with fewer jobs than threads leaves each job all of the threads");
+            }
+        }
+    }
+
+    //_______________________________________________________________________________
+    //the records of the shards of a run (written out, and read back), merged, vs. the run itself
+    void test_shards()
+    {
+        const int dim = 4;
+        const unsigned long int N = 300001;
+        const double R1 = 1., R2 = 0.6, sep = 0.7;
+        const uint64_t seed = 99;
+
+        const vector<pair<IntegratorType, string>> types{
+            { kMontecarlo,             "kMontecarlo" },
+            { kQuasirandom,            "kQuasirandom" },
+            { kMontecarloConditional,  "kMontecarloConditional" },
+            { kQuasirandomConditional, "kQuasirandomConditional" }
+        };
+
+        for (const auto& type : types) {
+            const auto single = compute_sphere_overlap(dim, N, R1, R2, sep, type.first, seed);
+
+            //(more shards than chunks, too, so that some shards are empty)
+            for (const unsigned int n_shards : {1u, 3u, 64u}) {
+                vector<ShardRecord_t> records;
+                for (unsigned int i_shard=n_shards; i_shard-- > 0; ) {
+                    records.push_back( ShardRecord_t::FromString( compute_sphere_overlap_shard(dim, i_shard, n_shards, N, R1, R2, sep, type.first, seed).ToString() ) );
+                }
+                check(same_result(MergeShardRecords(records), single), "MergeShardRecords == single run ("+type.second+", "+to_string(n_shards)+" shards)");
+            }
+        }
+    }
+
+    //_______________________________________________________________________________
+    //the 'target-precision' runs vs. the fixed-size runs with the number of points they stopped at
+    void test_to_target()
+    {
+        const int dim = 5;
+        const double R1_R1 = 1., R2_R2 = 0.5625, sep = 0.5;
+
+        const vector<IntegrationBound_t> bounds(dim, IntegrationBound_t{ -1., 1. });
+
+        const BatchIntegrand_t count_fcn = [=](const unsigned long int n, const double* const* X)
+        {
+            return count_inside_both_spheres(n, dim, X, R1_R1, R2_R2, sep);
+        };
+        const BatchValueIntegrand_t indicator_fcn = [=](const unsigned long int n, const double* const* X, double* f)
+        {
+            inside_both_spheres_indicator(n, dim, X, R1_R1, R2_R2, sep, f);
+        };
+
+        //(a target which takes a few rounds to reach)
+        PrecisionTarget_t target;
+        target.rel_error = 2e-3;
+
+        const auto mc = MontecarloIntegrateToTarget(target, bounds, count_fcn, 7ull);
+        check(mc.reached_target && mc.val == MontecarloIntegrate(mc.n_pts, bounds, count_fcn, 7ull).val,
+            "MontecarloIntegrateToTarget == MontecarloIntegrate with its n_pts");
+
+        const auto scrambled = ScrambledSobolIntegrateToTarget(target, bounds, count_fcn, kSobolReplicas, 7ull);
+        check(scrambled.reached_target && same_result(scrambled, ScrambledSobolIntegrate(scrambled.n_pts, bounds, count_fcn, kSobolReplicas, 7ull)),
+            "ScrambledSobolIntegrateToTarget == ScrambledSobolIntegrate with its n_pts");
+
+        const auto scrambled_f = ScrambledSobolIntegrateToTarget(target, bounds, indicator_fcn, kSobolReplicas, 7ull);
+        check(scrambled_f.reached_target && same_result(scrambled_f, ScrambledSobolIntegrate(scrambled_f.n_pts, bounds, indicator_fcn, kSobolReplicas, 7ull)),
+            "ScrambledSobolIntegrateToTarget == ScrambledSobolIntegrate with its n_pts (real-valued)");
+    }
+
+    //_______________________________________________________________________________
+    //every entry point hands back a record of its run when the telemetry is on, with all of its points in it
+    void test_telemetry()
+    {
+        const int dim = 3;
+        const unsigned long int N = 40000;
+        const double R1_R1 = 1., R2_R2 = 0.5625, sep = 0.5;
+
+        const vector<IntegrationBound_t> bounds(dim, IntegrationBound_t{ -1., 1. });
+
+        const BatchIntegrand_t count_fcn = [=](const unsigned long int n, const double* const* X)
+        {
+            return count_inside_both_spheres(n, dim, X, R1_R1, R2_R2, sep);
+        };
+        const BatchValueIntegrand_t indicator_fcn = [=](const unsigned long int n, const double* const* X, double* f)
+        {
+            inside_both_spheres_indicator(n, dim, X, R1_R1, R2_R2, sep, f);
+        };
+        const BatchMultiIntegrand_t multi_fcn = [=](const unsigned long int n, const double* const* X, unsigned long int* counts)
+        {
+            counts[0] += count_inside_both_spheres(n, dim, X, R1_R1, R2_R2, sep);
+        };
+        const BatchVectorIntegrand_t vector_fcn = [=](const unsigned long int n, const double* const* X, double* const* F)
+        {
+            inside_both_spheres_indicator(n, dim, X, R1_R1, R2_R2, sep, F[0]);
+        };
+        auto point_fcn = [=](const double* X)
+        {
+            return X[0]*X[0] + X[1]*X[1] + X[2]*X[2] < R1_R1;
+        };
+        const vector<ControlVariate_t> controls{ ball_control_variate(vector<double>(dim, 0.), 0.75) };
+
+        PrecisionTarget_t target;
+        target.rel_error = 2e-2;
+
+        SetTelemetryEnabled(true);
+        TakeTelemetryLog();
+
+        const auto mc_target        = MontecarloIntegrateToTarget(target, bounds, count_fcn, 7ull);
+        const auto scrambled_target = ScrambledSobolIntegrateToTarget(target, bounds, indicator_fcn, kSobolReplicas, 7ull);
+
+        //(the name of each entry point, and its result)
+        const vector<pair<string, ValueWithError_t<double>>> results{
+            { "MontecarloIntegrateToTarget",        mc_target },
+            { "MontecarloIntegrateCheckpoints",     MontecarloIntegrateCheckpoints({N/2, N}, bounds, indicator_fcn, 7ull).back() },
+            { "MontecarloIntegrateMulti",           MontecarloIntegrateMulti(N, bounds, 1, multi_fcn, 7ull)[0] },
+            { "MontecarloIntegrateVector",          MontecarloIntegrateVector(N, bounds, 1, vector_fcn, 7ull)[0] },
+            { "MontecarloIntegrateControlVariates", MontecarloIntegrateControlVariates(N, bounds, indicator_fcn, controls, 7ull) },
+            { "MontecarloIntegrate<Dim>",           MontecarloIntegrate<dim>(N, bounds, point_fcn, 7ull) },
+            { "SobolIntegrateCheckpoints",          SobolIntegrateCheckpoints({N/2, N}, bounds, count_fcn).back() },
+            { "SobolIntegrateMulti",                SobolIntegrateMulti(N, bounds, 1, multi_fcn)[0] },
+            { "SobolIntegrateVector",               SobolIntegrateVector(N, bounds, 1, vector_fcn)[0] },
+            { "SobolIntegrateControlVariates",      SobolIntegrateControlVariates(N, bounds, indicator_fcn, controls) },
+            { "ScrambledSobolIntegrate",            ScrambledSobolIntegrate(N, bounds, count_fcn, kSobolReplicas, 7ull) },
+            { "ScrambledSobolIntegrateToTarget",    scrambled_target },
+            { "GridIntegrateVector",                GridIntegrateVector(35, bounds, 1, vector_fcn)[0] }
+        };
+        const unsigned long int n_pts[] = { mc_target.n_pts, N, N, N, N, N, N, N, N, N, N, scrambled_target.n_pts, 35*35*35 };
+
+        for (size_t i=0; i<results.size(); i++) {
+            const auto& record = results[i].second.telemetry;
+            check(record && record->integrator == results[i].first && record->n_pts == n_pts[i], "telemetry of "+results[i].first);
+        }
+
+        const auto shard = MontecarloIntegrateShard(0, 2, N, bounds, count_fcn, 7ull);
+        const auto log = TakeTelemetryLog();
+        check(!log.empty() && log.back()->integrator == "MontecarloIntegrateShard" && log.back()->n_pts == shard.end - shard.first,
+            "telemetry of MontecarloIntegrateShard (in the log)");
+
+        SetTelemetryEnabled(false);
+    }
+
+    //_______________________________________________________________________________
+    //the exact sphere overlap (see SphereOverlapAnalytic.hpp), against closed forms and a quadrature
+    bool close_to(const double a, const double b, const double rel_tol) { return fabs(a - b) <= rel_tol*fabs(b); }
+
+    //the cap of a ball beyond a plane at 'a' from its center, slice by slice: with a = R cos(theta_a), it's
+    // V_{dim-1}(1) R^dim times the integral of sin^dim(theta) from 0 to theta_a (simpson's rule)
+    double reference_cap_volume(const int dim, const double R, const double a)
+    {
+        const int n = 20000;
+        const double theta_a = acos(a/R), h = theta_a/n;
+
+        double sum = 0.;
+        for (int k=0; k<=n; k++) sum += ((k == 0 || k == n) ? 1. : (k % 2 ? 4. : 2.)) * pow(sin(k*h), dim);
+
+        return ball_volume(dim-1, 1.) * pow(R, dim) * sum*h/3.;
+    }
+
+    void test_sphere_overlap_analytic()
+    {
+        const double R = 1.3;
+
+        //the caps which need no quadrature: the half ball, the whole ball, nothing, and the closed forms of 1d-3d
+        bool ok_simple=true;
+        for (int dim=1; dim<=12; dim++) {
+            ok_simple = ok_simple
+                && close_to(sphere_cap_volume(dim, R,  0.), 0.5*ball_volume(dim, R), 1e-14)
+                && sphere_cap_volume(dim, R, -R) == ball_volume(dim, R)
+                && sphere_cap_volume(dim, R,  R) == 0.;
+        }
+        for (const double a_R : { -0.9, -0.3, 0.2, 0.3, 0.6, 0.9 }) {
+            const double a = a_R*R, h = R - a;
+            ok_simple = ok_simple
+                && close_to(sphere_cap_volume(1, R, a), R - a, 1e-13)
+                && close_to(sphere_cap_volume(2, R, a), R*R*acos(a/R) - a*sqrt(R*R - a*a), 1e-12)
+                && close_to(sphere_cap_volume(3, R, a), M_PI*h*h*(3.*R - h)/3., 1e-12);
+        }
+        check(ok_simple, "sphere_cap_volume: half ball, whole ball, nothing, and the closed forms (1d-3d)");
+
+        //odd and even dims (whole and half-whole p), on both sides of kBetaSeriesMaxX: x = 1 - a^2/R^2 is above
+        // 0.9 for |a|/R = 0.2, 0.3 (the recurrence), and below it for 0.6, 0.9, 0.999 (the series)
+        bool ok_quadrature=true;
+        for (int dim=1; dim<=9; dim++) {
+            for (const double a_R : { -0.6, -0.2, 0.2, 0.3, 0.6, 0.9, 0.999 }) {
+                ok_quadrature = ok_quadrature && close_to(sphere_cap_volume(dim, R, a_R*R), reference_cap_volume(dim, R, a_R*R), 1e-10);
+            }
+        }
+        check(ok_quadrature, "sphere_cap_volume == quadrature (1d-9d, series and recurrence)");
+
+        //concentric, nested and disjoint spheres, and a lens (the cap of each ball, beyond the plane they meet in)
+        bool ok_overlap=true;
+        for (int dim=1; dim<=12; dim++) {
+            const double x_plane = (0.8*0.8 + (1. - 0.75)*(1. + 0.75))/(2.*0.8);
+            ok_overlap = ok_overlap
+                && sphere_overlap_volume(dim, 1., 0.75, 0.)   == ball_volume(dim, 0.75)
+                && sphere_overlap_volume(dim, 0.5, 1., 0.3)   == ball_volume(dim, 0.5)
+                && sphere_overlap_volume(dim, 1., 0.75, 1.75) == 0.
+                && sphere_overlap_volume(dim, 1., 0.75, 2.)   == 0.
+                && close_to(sphere_overlap_volume(dim, 1., 0.75, 0.8),
+                            reference_cap_volume(dim, 1., x_plane) + reference_cap_volume(dim, 0.75, 0.8 - x_plane), 1e-10);
+        }
+        check(ok_overlap, "sphere_overlap_volume: concentric, nested, disjoint, and a lens == quadrature (1d-12d)");
+    }
+
+    //_______________________________________________________________________________
+    //the error bars the integrators give, against the exact volume (see SphereOverlapAnalytic.hpp)
+    void test_error_bars()
+    {
+        const double R1 = 1., R2 = 0.75;
+
+        //the adaptive grid's error is a hard bound, so it must hold for every configuration
+        bool ok_grid=true;
+        for (int dim=2; dim<=6; dim++) {
+            for (const double sep : { 0.5, 1. }) {
+                const auto result = compute_sphere_overlap(dim, 100000, R1, R2, sep, kAdaptiveGrid);
+                ok_grid = ok_grid && fabs(result.val - sphere_overlap_volume(dim, R1, R2, sep)) <= result.error;
+            }
+        }
+        check(ok_grid, "kAdaptiveGrid is within its error bound (2d-6d)");
+
+        //VEGAS on overlaps which only fill a small part of the box, where its bins used to collapse around the 
+        // first few hits (and its error with them). its error is a standard deviation, so 4 of them are allowed.
+        bool ok_vegas=true;
+        for (const uint64_t seed : { 1, 2, 3 }) {
+            const auto r12 = compute_sphere_overlap(12, 1000000, R1, 0.9, 0.9, kVegas, seed);
+            const auto r15 = compute_sphere_overlap(15, 1000000, R1, 0.9, 0.2, kVegas, seed);
+            ok_vegas = ok_vegas
+                && fabs(r12.val - sphere_overlap_volume(12, R1, 0.9, 0.9)) <= 4.*r12.error
+                && fabs(r15.val - sphere_overlap_volume(15, R1, 0.9, 0.2)) <= 4.*r15.error;
+        }
+        check(ok_vegas, "kVegas is within 4 sigma of the exact small-fraction overlap (12d, 15d)");
+
+        //control variates, where the few points which hit the overlap all hit the references the same way, so 
+        // that the fit leaves nothing over (the error used to come out as 0)
+        bool ok_control=true;
+        for (const uint64_t seed : { 1, 2, 3 }) {
+            for (const int dim : { 12, 15 }) {
+                const auto result = compute_sphere_overlap(dim, 1000000, R1, 0.9, 0.2, kMontecarloControlVariate, seed);
+                ok_control = ok_control && fabs(result.val - sphere_overlap_volume(dim, R1, 0.9, 0.2)) <= 4.*result.error;
+            }
+        }
+        const auto quasi = compute_sphere_overlap(15, 1000000, R1, 0.9, 0.2, kQuasirandomControlVariate);
+        ok_control = ok_control && fabs(quasi.val - sphere_overlap_volume(15, R1, 0.9, 0.2)) <= 4.*quasi.error;
+        check(ok_control, "kMontecarloControlVariate, kQuasirandomControlVariate are within 4 sigma of the exact overlap (12d, 15d)");
+    }
+}
+
+int main()
+{
+    printf("simd level: %s, threads: %u\n", level_name(detect_simd_level()), ThreadPool::Global().NumThreads());
+
+    test_philox_known_answers();
+    test_philox_fill_block();
+    test_sphere_kernels();
+    test_sobol_joe_kuo();
+    test_sobol_blocks();
+    test_thread_counts();
+    test_batch_overloads();
+    test_sweep();
+    test_shards();
+    test_to_target();
+    test_telemetry();
+    test_sphere_overlap_analytic();
+    test_error_bars();
+
+    printf("%i of %i checks passed\n", g_n_checks - g_n_failed, g_n_checks);
+    return g_n_failed ? 1 : 0;
+}